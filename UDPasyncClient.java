@@ -0,0 +1,419 @@
+import java.io.IOException;
+import java.net.InetSocketAddress;
+import java.net.PortUnreachableException;
+import java.nio.ByteBuffer;
+import java.nio.channels.DatagramChannel;
+import java.nio.channels.SelectionKey;
+import java.nio.channels.Selector;
+import java.nio.charset.StandardCharsets;
+import java.util.ArrayDeque;
+import java.util.Collection;
+import java.util.HashMap;
+import java.util.Iterator;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.TimeoutException;
+import java.util.concurrent.atomic.AtomicLong;
+
+/*
+ * UDPasyncClient.java
+ *
+ * A non blocking client for the UDP server. Any thread can send a request and gets a
+ * CompletableFuture for its response, one selector thread does all the sending and receiving.
+ * Text requests carry the correlation envelope "#<hex id> " and binary requests the ID in their
+ * header, so responses can arrive in any order and many requests can be in flight at once.
+ * A request that is not answered within the timeout is sent again with the same ID.
+ * Responses larger than one datagram are sent as fragments by the server and are not supported.
+ */
+
+public final class UDPasyncClient implements AutoCloseable {
+	// Constants
+	public static final int DEFAULT_MAX_IN_FLIGHT = 256;
+	public static final int DEFAULT_TIMEOUT_MIL_SEC = 500;
+	public static final int DEFAULT_RETRIES = 2;
+	private static final int MAX_DATAGRAM = 65536;
+	private static final int BINARY_MAGIC = 0xBA;
+	private static final int BINARY_HEADER_SIZE = 16;
+	private static final int BINARY_ID_OFFSET = 8;
+	private static final byte CORRELATION_MARK = '#';
+	private static final int MAX_CORRELATION_ID = 16;
+
+	/**
+	 * A request and the future it completes. Only the selector thread changes it once it was submitted.
+	 */
+	private static final class Request {
+		final long id;
+		final byte[] frame;
+		final CompletableFuture<String> future = new CompletableFuture<String>();
+		int attempts;
+		long deadline;
+		boolean resending; //due again but held back by a full socket buffer
+
+		Request(long id, byte[] frame) {
+			this.id = id;
+			this.frame = frame;
+		}
+	}
+
+	// variables for network connection
+	private final DatagramChannel channel;
+	private final Selector selector;
+	private final SelectionKey key;
+	private final Thread thread;
+	// Settings
+	private final boolean binaryFrames;
+	private final int maxInFlight;
+	private final long timeout; //nano seconds
+	private final int retries;
+	// Buffers, allocated once and reused for every datagram
+	private final ByteBuffer sendBuffer = ByteBuffer.allocateDirect(MAX_DATAGRAM);
+	private final ByteBuffer recvBuffer = ByteBuffer.allocateDirect(MAX_DATAGRAM);
+	private final byte[] recvBytes = new byte[MAX_DATAGRAM];
+	// Requests handed over by the sending threads
+	private final ConcurrentLinkedQueue<Request> submitted = new ConcurrentLinkedQueue<Request>();
+	private final AtomicLong nextId = new AtomicLong(1);
+	private volatile boolean running = true;
+	// Only used by the selector thread
+	private final HashMap<Long, Request> inFlight = new HashMap<Long, Request>();
+	private final ArrayDeque<Request> waiting = new ArrayDeque<Request>();
+	private final ArrayDeque<Request> resending = new ArrayDeque<Request>();
+	private long nextExpire = Long.MAX_VALUE;
+	private long retried;
+	private long timedOut;
+	private long late;
+
+	/**
+	 * Connects a text client with the default number of requests in flight, timeout and retries.
+	 * @param hostAddr the ip or hostname of the server
+	 * @param port the port number of the server
+	 * @throws IOException if the channel cannot be opened or the host is unknown
+	 */
+	public UDPasyncClient(String hostAddr, int port) throws IOException {
+		this(hostAddr, port, false, DEFAULT_MAX_IN_FLIGHT, DEFAULT_TIMEOUT_MIL_SEC, DEFAULT_RETRIES);
+	}
+
+	/**
+	 * Connects a client and starts its selector thread.
+	 * @param hostAddr the ip or hostname of the server
+	 * @param port the port number of the server
+	 * @param binary true to send requests in the binary form of UDPbinary.h
+	 * @param maxInFlight the most requests sent and not yet answered, later requests wait for a free place
+	 * @param timeoutMilSec how long a request waits for its response before it is sent again
+	 * @param retries how often a request is sent again before its future fails with a TimeoutException
+	 * @throws IOException if the channel cannot be opened or the host is unknown
+	 */
+	public UDPasyncClient(String hostAddr, int port, boolean binary, int maxInFlight, int timeoutMilSec, int retries) throws IOException {
+		InetSocketAddress servAddr = new InetSocketAddress(hostAddr, port);
+		if(servAddr.isUnresolved()) {
+			throw new IOException("Unknown host " + hostAddr);
+		}
+		this.binaryFrames = binary;
+		this.maxInFlight = Math.max(1, maxInFlight);
+		this.timeout = Math.max(1, timeoutMilSec) * 1000000L;
+		this.retries = Math.max(0, retries);
+		//connected, so every read and write skips the address and only the server's datagrams arrive
+		channel = DatagramChannel.open();
+		try {
+			channel.configureBlocking(false);
+			channel.connect(servAddr);
+			selector = Selector.open();
+			key = channel.register(selector, SelectionKey.OP_READ);
+		} catch(IOException ex) {
+			channel.close();
+			throw ex;
+		}
+		thread = new Thread(this::run, "UDPasyncClient");
+		thread.setDaemon(true);
+		thread.start();
+	}
+
+	/**
+	 * Sends a request without waiting for the response. Can be called from any thread.
+	 * The future is completed on the selector thread, long work on the response belongs in an
+	 * async stage so the other responses are not held up.
+	 * @param request the request, written as XML also in the binary form
+	 * @return the future of the response, it fails with a TimeoutException when every attempt timed out
+	 */
+	public CompletableFuture<String> send(String request) {
+		long id = nextId.getAndIncrement();
+		byte[] frame;
+		if(binaryFrames) {
+			frame = UDPclient.encodeBinaryRequest(request, id);
+			if(frame == null) {
+				return failed(new IllegalArgumentException("Request has no binary form"));
+			}
+		} else {
+			byte[] tag = ("#" + Long.toHexString(id) + " ").getBytes(StandardCharsets.US_ASCII);
+			byte[] text = request.getBytes(StandardCharsets.UTF_8);
+			frame = new byte[tag.length + text.length];
+			System.arraycopy(tag, 0, frame, 0, tag.length);
+			System.arraycopy(text, 0, frame, tag.length, text.length);
+		}
+		if(frame.length > MAX_DATAGRAM) {
+			return failed(new IllegalArgumentException("Request is too large"));
+		}
+		Request pending = new Request(id, frame);
+		submitted.offer(pending);
+		if(running) {
+			selector.wakeup();
+		} else {
+			//the selector thread may have left before the request was queued
+			failAll(submitted, new IOException("Client is closed"));
+		}
+		return pending.future;
+	}
+
+	/**
+	 * @return the number of requests that were sent again after a timeout, final once the client is closed
+	 */
+	public long getRetried() {
+		return retried;
+	}
+
+	/**
+	 * @return the number of requests whose every attempt timed out, final once the client is closed
+	 */
+	public long getTimedOut() {
+		return timedOut;
+	}
+
+	/**
+	 * @return the number of responses that arrived after their request was answered or gave up
+	 */
+	public long getLate() {
+		return late;
+	}
+
+	/**
+	 * Stops the selector thread and closes the channel, requests still waiting fail with an IOException.
+	 */
+	@Override
+	public void close() {
+		running = false;
+		selector.wakeup();
+		try {
+			thread.join();
+		} catch(InterruptedException ex) {
+			Thread.currentThread().interrupt();
+		}
+	}
+
+	/**
+	 * The selector thread. Waits for responses or the earliest deadline, whichever comes first.
+	 */
+	private void run() {
+		IOException reason = new IOException("Client is closed");
+		try {
+			while(running) {
+				long wait = 0; //no deadline, wait until a response arrives or send wakes the selector
+				if(nextExpire != Long.MAX_VALUE) {
+					wait = Math.max(1, (nextExpire - System.nanoTime()) / 1000000L);
+				}
+				selector.select(wait);
+				selector.selectedKeys().clear();
+				receive();
+				Request request;
+				while((request = submitted.poll()) != null) {
+					waiting.add(request);
+				}
+				flush();
+				expire(System.nanoTime());
+			}
+		} catch(IOException ex) {
+			reason = ex;
+		} finally {
+			running = false;
+			failAll(inFlight.values(), reason);
+			failAll(waiting, reason);
+			failAll(submitted, reason);
+			try {
+				selector.close();
+				channel.close();
+			} catch(IOException ex) {
+				System.err.println("Exception in closing the channel");
+			}
+		}
+	}
+
+	/**
+	 * Sends the retries a full socket buffer held back and then waiting requests while there is
+	 * room in flight and in the socket buffer.
+	 */
+	private void flush() throws IOException {
+		Request request;
+		while((request = resending.peek()) != null) {
+			//answered by an earlier attempt while it waited
+			if(!request.future.isDone()) {
+				if(!transmit(request)) {
+					key.interestOps(SelectionKey.OP_READ | SelectionKey.OP_WRITE);
+					return;
+				}
+				countRetry(request, System.nanoTime());
+			}
+			resending.poll();
+		}
+		while(inFlight.size() < maxInFlight && (request = waiting.peek()) != null) {
+			if(!transmit(request)) {
+				//the socket buffer is full, go on once the channel is writable again
+				key.interestOps(SelectionKey.OP_READ | SelectionKey.OP_WRITE);
+				return;
+			}
+			waiting.poll();
+			request.deadline = System.nanoTime() + timeout;
+			nextExpire = Math.min(nextExpire, request.deadline);
+			inFlight.put(request.id, request);
+		}
+		key.interestOps(SelectionKey.OP_READ);
+	}
+
+	/**
+	 * Writes one request from the reused send buffer.
+	 * @return true if the datagram was sent, false if the socket buffer is full
+	 */
+	private boolean transmit(Request request) throws IOException {
+		sendBuffer.clear();
+		sendBuffer.put(request.frame).flip();
+		try {
+			return channel.write(sendBuffer) > 0;
+		} catch(PortUnreachableException ex) {
+			//reports an earlier datagram nobody received, the request is answered by a retry or times out
+			sendBuffer.rewind();
+			return channel.write(sendBuffer) > 0;
+		}
+	}
+
+	/**
+	 * Reads every datagram queued on the channel and completes the requests they answer.
+	 */
+	private void receive() throws IOException {
+		int length;
+		while(true) {
+			recvBuffer.clear();
+			try {
+				length = channel.read(recvBuffer);
+			} catch(PortUnreachableException ex) {
+				continue; //the server is not running, the requests time out
+			}
+			if(length <= 0) {
+				return;
+			}
+			recvBuffer.flip();
+			recvBuffer.get(recvBytes, 0, length);
+			complete(recvBytes, length);
+		}
+	}
+
+	/**
+	 * Finds the request a response answers by its ID and completes it.
+	 */
+	private void complete(byte[] response, int length) {
+		long id = 0;
+		String text;
+		if(binaryFrames) {
+			if(length < BINARY_HEADER_SIZE || (response[0] & 0xFF) != BINARY_MAGIC) {
+				return;
+			}
+			id = ByteBuffer.wrap(response, BINARY_ID_OFFSET, 8).getLong();
+			text = UDPclient.formatBinaryResponse(response, length);
+		} else {
+			//only the received bytes belong to the reply, a padded reply ends at its first null character
+			int end = 0, start;
+			while(end < length && response[end] != 0) {
+				end++;
+			}
+			if(end < 3 || response[0] != CORRELATION_MARK) {
+				return;
+			}
+			for(start = 1; start < end && start <= MAX_CORRELATION_ID && response[start] != ' '; start++) {
+				int digit = Character.digit(response[start], 16);
+				if(digit < 0) {
+					return;
+				}
+				id = id << 4 | digit;
+			}
+			if(start == 1 || start == end || response[start] != ' ') {
+				return;
+			}
+			start++;
+			text = new String(response, start, end - start, StandardCharsets.UTF_8);
+		}
+		Request request = inFlight.remove(id);
+		if(request == null) {
+			late++;
+			return;
+		}
+		if(text == null) {
+			request.future.completeExceptionally(new IOException("Response is not a valid binary reply"));
+		} else {
+			request.future.complete(text);
+		}
+	}
+
+	/**
+	 * Sends the requests whose deadline passed again or fails them, the requests are only
+	 * looked at once the earliest deadline passed.
+	 */
+	private void expire(long now) throws IOException {
+		if(now < nextExpire) {
+			return;
+		}
+		nextExpire = Long.MAX_VALUE;
+		Iterator<Request> requests = inFlight.values().iterator();
+		while(requests.hasNext()) {
+			Request request = requests.next();
+			if(request.resending) {
+				continue; //flush sends it once the channel is writable
+			}
+			if(request.deadline <= now) {
+				if(request.attempts >= retries) {
+					requests.remove();
+					timedOut++;
+					request.future.completeExceptionally(new TimeoutException("Server not responding"));
+					continue;
+				}
+				//the same ID, whichever attempt is answered first completes the request
+				if(!transmit(request)) {
+					//the socket buffer is full, like flush go on once the channel is writable again
+					request.resending = true;
+					resending.add(request);
+					key.interestOps(SelectionKey.OP_READ | SelectionKey.OP_WRITE);
+					continue;
+				}
+				countRetry(request, now);
+			}
+			nextExpire = Math.min(nextExpire, request.deadline);
+		}
+	}
+
+	/**
+	 * Counts a request that was sent again and gives it a new deadline.
+	 */
+	private void countRetry(Request request, long now) {
+		request.resending = false;
+		request.attempts++;
+		retried++;
+		request.deadline = now + timeout;
+		nextExpire = Math.min(nextExpire, request.deadline);
+	}
+
+	/**
+	 * @return a future that already failed with the reason
+	 */
+	private static CompletableFuture<String> failed(Exception reason) {
+		CompletableFuture<String> future = new CompletableFuture<String>();
+		future.completeExceptionally(reason);
+		return future;
+	}
+
+	/**
+	 * Fails every request of a collection and removes it.
+	 */
+	private static void failAll(Collection<Request> requests, IOException reason) {
+		Iterator<Request> iterator = requests.iterator();
+		while(iterator.hasNext()) {
+			Request request = iterator.next();
+			iterator.remove();
+			request.future.completeExceptionally(reason);
+		}
+	}
+}
@@ -0,0 +1,234 @@
+/**	@file UDPbalance.c
+ * 	@brief Contains the function implementations of spreading the requests of the C client over
+ *	several servers. Each request goes to the better of two servers picked at random, a server
+ *	that stops answering is taken out and probed until it answers again.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPbalance.h"
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Picks a healthy server at random, any server when none is healthy.
+*	@param 	pool is the pool.
+*			other is a server that must not be picked, -1 for none.
+*	@return returns the index of the server.
+*/
+int pick_Endpoint(struct server_pool *pool, int other);
+
+/**	@brief 	Steps the xorshift generator of the pool.
+*	@param 	pool is the pool.
+*	@return returns the next random number.
+*/
+uint32_t next_Random(struct server_pool *pool);
+
+/*
+ **************************************************
+ *		BALANCE FUNCTIONS
+ **************************************************
+ */
+
+/*
+ * Looks up a list of servers and makes one socket to reach them.
+ */
+struct server_pool *createPool(char * servers, int defaultPort){
+	struct server_pool *pool;
+	char *entry, *next, *port;
+	int count = 1, i;
+
+	for(next = servers; *next != '\0'; next++)
+		if(*next == ',')
+			count++;
+	if(count > MAX_SERVERS) {
+		fprintf(stderr, "ERROR: More Than %d Servers\n", MAX_SERVERS);
+		return NULL;
+	}
+	pool = calloc(1, sizeof(struct server_pool));
+	if(pool == NULL)
+		return NULL;
+	pool->endpoints = calloc(count, sizeof(struct server_endpoint));
+	if(pool->endpoints == NULL) {
+		free(pool);
+		return NULL;
+	}
+	pool->sockFD = -1;
+	pool->random = (uint32_t) getpid() * 2654435761U | 1;
+
+	for(i = 0, entry = servers; i < count; i++, entry = next) {
+		next = strchr(entry, ',');
+		if(next != NULL)
+			*next++ = '\0';
+		//an IPv6 address is given as [address]:port, or bare without a port
+		if(*entry == '[' && (port = strchr(entry, ']')) != NULL) {
+			*port++ = '\0';
+			port = *port == ':' ? port + 1 : NULL;
+			entry++;
+		}
+		else if((port = strchr(entry, ':')) != NULL && strchr(port + 1, ':') == NULL)
+			*port++ = '\0';
+		else
+			port = NULL;
+		if(i == 0)
+			pool->sockFD = createSocket(entry, port != NULL ? atoi(port) : defaultPort, &pool->endpoints[i].address);
+		if(i == 0 ? pool->sockFD < 0 : resolveServer(entry, port != NULL ? atoi(port) : defaultPort, &pool->endpoints[i].address) < 0) {
+			if(pool->sockFD >= 0)
+				close(pool->sockFD);
+			freePool(pool);
+			return NULL;
+		}
+		pool->endpoints[i].healthy = 1;
+		pool->endpoints[i].nextProbe = UINT64_MAX;
+	}
+	pool->count = pool->healthyCount = count;
+	return pool;
+}
+
+/*
+ * Chooses the server for the next request.
+ * One is added to the latency so servers that have not answered yet still compare by their requests in flight.
+ */
+int chooseEndpoint(struct server_pool * pool){
+	struct server_endpoint *first, *second;
+	int a, b;
+	if(pool->count == 1)
+		return 0;
+	a = pick_Endpoint(pool, -1);
+	if(pool->healthyCount == 1)
+		return a;
+	b = pick_Endpoint(pool, a);
+	first = &pool->endpoints[a];
+	second = &pool->endpoints[b];
+	return (first->latency + 1) * (first->pending + 1) <= (second->latency + 1) * (second->pending + 1) ? a : b;
+}
+
+/*
+ * Finds the server a datagram came from.
+ */
+int findEndpoint(struct server_pool * pool, struct sockaddr_in6 * from){
+	int i;
+	for(i = 0; i < pool->count; i++)
+		if(pool->endpoints[i].address.sin6_port == from->sin6_port && IN6_ARE_ADDR_EQUAL(&pool->endpoints[i].address.sin6_addr, &from->sin6_addr))
+			return i;
+	return -1;
+}
+
+/*
+ * Counts a response of a server and puts it back when it was taken out.
+ * The average of a server that was out is started over, it was measured before the server failed.
+ */
+void endpointResponded(struct server_pool * pool, int index, uint64_t latency){
+	struct server_endpoint *endpoint = &pool->endpoints[index];
+	endpoint->answered++;
+	endpoint->failures = 0;
+	if(!endpoint->healthy) {
+		endpoint->healthy = 1;
+		endpoint->nextProbe = UINT64_MAX;
+		endpoint->latency = 0;
+		pool->healthyCount++;
+	}
+	if(latency == 0)
+		return;
+	if(endpoint->latency == 0)
+		endpoint->latency = latency;
+	else
+		endpoint->latency += ((int64_t) latency - (int64_t) endpoint->latency) >> BALANCE_EWMA_SHIFT;
+}
+
+/*
+ * Counts a request without a response in time.
+ */
+void endpointFailed(struct server_pool * pool, int index, uint64_t now){
+	struct server_endpoint *endpoint = &pool->endpoints[index];
+	endpoint->timeouts++;
+	if(++endpoint->failures < BALANCE_MAX_FAILURES || !endpoint->healthy)
+		return;
+	endpoint->healthy = 0;
+	endpoint->nextProbe = now + BALANCE_PROBE_MIL_SEC * 1000000ULL;
+	pool->healthyCount--;
+}
+
+/*
+ * Finds a server that was taken out and is due to be probed.
+ */
+int dueProbe(struct server_pool * pool, uint64_t now){
+	int i;
+	for(i = 0; i < pool->count; i++) {
+		if(pool->endpoints[i].nextProbe <= now) {
+			pool->endpoints[i].nextProbe = now + BALANCE_PROBE_MIL_SEC * 1000000ULL;
+			pool->endpoints[i].probes++;
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*
+ * Gets when the next probe is due.
+ */
+uint64_t nextProbe(struct server_pool * pool){
+	uint64_t next = UINT64_MAX;
+	int i;
+	if(pool->healthyCount == pool->count)
+		return next;
+	for(i = 0; i < pool->count; i++)
+		if(pool->endpoints[i].nextProbe < next)
+			next = pool->endpoints[i].nextProbe;
+	return next;
+}
+
+/*
+ * Prints how many requests each server got and answered to stderr.
+ */
+void printPool(struct server_pool * pool){
+	struct server_endpoint *endpoint;
+	char address[INET6_ADDRSTRLEN];
+	int i;
+	for(i = 0; i < pool->count; i++) {
+		endpoint = &pool->endpoints[i];
+		inet_ntop(AF_INET6, &endpoint->address.sin6_addr, address, sizeof(address));
+		fprintf(stderr, "[%s]:%d %s, %lu sent, %lu answered, %lu timed out, %lu probes, latency %.1f us\n",
+		        address, ntohs(endpoint->address.sin6_port), endpoint->healthy ? "healthy" : "down",
+		        endpoint->sent, endpoint->answered, endpoint->timeouts, endpoint->probes, endpoint->latency / 1e3);
+	}
+}
+
+/*
+ * Frees a pool, the socket is left open.
+ */
+void freePool(struct server_pool * pool){
+	if(pool == NULL)
+		return;
+	free(pool->endpoints);
+	free(pool);
+}
+
+/*
+ **************************************************
+ *	Draws until a healthy server comes up, at least one is healthy or any server will do.
+ **************************************************
+ */
+int pick_Endpoint(struct server_pool *pool, int other){
+	int index;
+	do
+		index = next_Random(pool) % pool->count;
+	while(index == other || (pool->healthyCount > 0 && !pool->endpoints[index].healthy));
+	return index;
+}
+
+/*
+ **************************************************
+ **************************************************
+ */
+uint32_t next_Random(struct server_pool *pool){
+	uint32_t x = pool->random;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return pool->random = x;
+}
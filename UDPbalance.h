@@ -0,0 +1,149 @@
+/**	@file UDPbalance.h
+ * 	@brief Contains the function prototypes for spreading the requests of the C client over
+ *	several servers that are implemented in UDPbalance.c
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPBALANCE_H
+#define UDPBALANCE_H
+
+#include "UDPclient.h"	//first, it turns on the GNU extensions the system headers need for sendmmsg
+#include <stdint.h>
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define MAX_SERVERS 64
+#define BALANCE_EWMA_SHIFT 3		//a new latency moves the average an eighth of the way
+#define BALANCE_MAX_FAILURES 3		//timeouts in a row before a server is taken out
+#define BALANCE_PROBE_MIL_SEC 250	//how often a server that was taken out is asked for <loadavg/>
+#define BALANCE_PROBE "<loadavg/>"
+
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+/**	@brief 	One server of a pool. latency is a moving average in nano seconds, 0 until the first
+*			response. pending is the number of requests sent to it that are still in flight.
+*/
+struct server_endpoint {
+	struct sockaddr_in6 address;
+	uint64_t latency;
+	int pending;
+	int failures;
+	int healthy;
+	uint64_t nextProbe;
+	unsigned long sent;
+	unsigned long answered;
+	unsigned long timeouts;
+	unsigned long probes;
+};
+
+/**	@brief 	Servers that answer the same requests, sockFD is the socket made for the first one and
+*			is used to reach all of them.
+*/
+struct server_pool {
+	int sockFD;
+	struct server_endpoint *endpoints;
+	int count;
+	int healthyCount;
+	uint32_t random;
+};
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/*
+ * Looks up a list of servers and makes one socket to reach them.
+ *
+ * servers     - "host[:port],[v6 address]:port,..." the servers given as a string, it is changed while it is read
+ * defaultPort - the port of a server given without one
+ *
+ * return      - the pool, or NULL if a server could not be found
+ */
+struct server_pool *createPool(char * servers, int defaultPort);
+
+/*
+ * Chooses the server for the next request. Two healthy servers are picked at random and the one
+ * with the smaller latency times requests in flight wins, so a slow server gets fewer requests
+ * without every client piling onto the fastest one. When no server is healthy any server is used.
+ *
+ * pool   - the pool
+ *
+ * return - the index of the server
+ */
+int chooseEndpoint(struct server_pool * pool);
+
+/*
+ * Finds the server a datagram came from.
+ *
+ * pool   - the pool
+ * from   - the address the datagram came from
+ *
+ * return - the index of the server, -1 if it is not in the pool
+ */
+int findEndpoint(struct server_pool * pool, struct sockaddr_in6 * from);
+
+/*
+ * Counts a response of a server and puts it back when it was taken out.
+ *
+ * pool    - the pool
+ * index   - the server that answered
+ * latency - the nano seconds the response took, 0 when it is unknown which request was answered
+ */
+void endpointResponded(struct server_pool * pool, int index, uint64_t latency);
+
+/*
+ * Counts a request without a response in time, the server is taken out after
+ * BALANCE_MAX_FAILURES in a row.
+ *
+ * pool  - the pool
+ * index - the server
+ * now   - the current CLOCK_MONOTONIC time in nano seconds
+ */
+void endpointFailed(struct server_pool * pool, int index, uint64_t now);
+
+/*
+ * Finds a server that was taken out and is due to be probed, and schedules its next probe.
+ *
+ * pool   - the pool
+ * now    - the current CLOCK_MONOTONIC time in nano seconds
+ *
+ * return - the index of the server, -1 if no probe is due
+ */
+int dueProbe(struct server_pool * pool, uint64_t now);
+
+/*
+ * Gets when the next probe is due.
+ *
+ * pool   - the pool
+ *
+ * return - the CLOCK_MONOTONIC time in nano seconds, UINT64_MAX when every server is healthy
+ */
+uint64_t nextProbe(struct server_pool * pool);
+
+/*
+ * Prints how many requests each server got and answered to stderr.
+ *
+ * pool - the pool
+ */
+void printPool(struct server_pool * pool);
+
+/*
+ * Frees a pool, the socket is left open.
+ *
+ * pool - the pool returned by createPool
+ */
+void freePool(struct server_pool * pool);
+
+#endif
@@ -0,0 +1,712 @@
+/**	@file UDPbench.c
+ * 	@brief Contains the function implementations of the load generator and latency benchmark
+ *	of the C client. Every thread sends <echo> and <loadavg/> requests over its own socket,
+ *	either as fast as its window of outstanding requests allows or on a fixed rate schedule,
+ *	and counts the latency of every reply in a log linear histogram.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPbench.h"
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Thread entry point, sends and receives until the duration is over and then waits
+*			up to the timeout for the last replies.
+*	@param 	arg is the bench_thread structure.
+*	@return returns NULL.
+*/
+void *bench_Thread(void *arg);
+
+/**	@brief 	Sets up the socket, the request slots and the echo payloads of a thread.
+*	@param 	thread is the thread to set up.
+*	@return returns 0 on success, -1 on error.
+*/
+int init_Bench_Thread(struct bench_thread *thread);
+
+/**	@brief 	Frees what init_Bench_Thread set up.
+*	@param 	thread is the thread to free.
+*	@return returns nothing.
+*/
+void free_Bench_Thread(struct bench_thread *thread);
+
+/**	@brief 	Sends the next request of the mix if a request slot is free.
+*	@param 	thread is the sending thread.
+*			scheduled is the time the request was due.
+*	@return returns 1 if a request was sent, 0 if every slot is taken or the send failed.
+*/
+int send_Bench_Request(struct bench_thread *thread, uint64_t scheduled);
+
+/**	@brief 	Reads every reply that is waiting on the socket and matches it to its request.
+*	@param 	thread is the receiving thread.
+*	@return returns nothing.
+*/
+void receive_Bench_Replies(struct bench_thread *thread);
+
+/**	@brief 	Counts the requests that have been outstanding longer than the timeout as lost.
+*	@param 	thread is the thread to check.
+*			now is the current bench_Clock time.
+*			timeout is the time in nano seconds after which a request is lost.
+*	@return returns nothing.
+*/
+void expire_Bench_Requests(struct bench_thread *thread, uint64_t now, uint64_t timeout);
+
+/**	@brief 	Completes a request and frees its slot.
+*	@param 	thread is the thread that sent the request.
+*			slot is the slot of the request.
+*			now is the time the reply arrived.
+*	@return returns nothing.
+*/
+void complete_Bench_Request(struct bench_thread *thread, int slot, uint64_t now);
+
+/**	@brief 	Writes the results of every thread as one JSON object.
+*	@param 	out is the stream to write to.
+*			config is the benchmark that ran.
+*			total is the merged results of every thread.
+*			elapsed is the time the benchmark ran in nano seconds.
+*	@return returns nothing.
+*/
+void print_Bench_Json(FILE *out, struct bench_config *config, struct bench_thread *total, uint64_t elapsed);
+
+/**	@brief 	Times formatting and parsing one echo size or <loadavg/> in both forms and prints the result.
+*	@param 	size is the echo payload size, 0 for <loadavg/>.
+*			iterations is the number of messages timed per form.
+*			request and reply are buffers of BENCH_MAX_PAYLOAD + MAX_MESSAGE bytes.
+*	@return returns nothing.
+*/
+void time_Codec(int size, int iterations, char *request, char *reply);
+
+/**	@brief 	Current CLOCK_MONOTONIC time.
+*	@param 	no parameter is passed.
+*	@return returns the time in nano seconds.
+*/
+uint64_t bench_Clock(void);
+
+/*
+ **************************************************
+ *		BENCH FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ **************************************************
+ */
+int parse_Bench_Sizes(char *list, struct bench_config *config){
+	char *next = list, *end;
+	long size;
+	config->sizeCount = 0;
+	while(*next != '\0') {
+		size = strtol(next, &end, 10);
+		if(end == next || size < BENCH_MIN_PAYLOAD || size > BENCH_MAX_PAYLOAD || config->sizeCount == BENCH_MAX_SIZES)
+			return -1;
+		config->sizes[config->sizeCount++] = size;
+		next = *end == ',' ? end + 1 : end;
+		if(*end != ',' && *end != '\0')
+			return -1;
+	}
+	return config->sizeCount > 0 ? 0 : -1;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int bench_Address(char *serverName, int serverPort, struct bench_config *config){
+	if(resolveAddress(serverName, serverPort, &config->dest) < 0) {
+		fprintf(stderr, "ERROR: Cannot Resolve %s\n", serverName);
+		return -1;
+	}
+	return 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int run_Bench(struct bench_config *config){
+	int i, started = 0;
+	uint64_t begin, elapsed;
+	struct bench_thread *threads, *total;
+	FILE *out = stdout;
+
+	threads = calloc(config->threads, sizeof(struct bench_thread));
+	total = calloc(1, sizeof(struct bench_thread));
+	if(threads == NULL || total == NULL) {
+		free(threads);
+		free(total);
+		fprintf(stderr, "ERROR: Cannot Allocate Benchmark Threads\n");
+		return -1;
+	}
+	for(i = 0; i < config->threads; i++) {
+		threads[i].id = i;
+		threads[i].config = config;
+		if(init_Bench_Thread(&threads[i]) == -1)
+			break;
+	}
+
+	begin = bench_Clock();
+	if(i == config->threads)
+		for(started = 0; started < config->threads; started++)
+			if(pthread_create(&threads[started].thread, NULL, bench_Thread, &threads[started]) != 0)
+				break;
+	for(i = 0; i < started; i++) {
+		pthread_join(threads[i].thread, NULL);
+		total->sent += threads[i].sent;
+		total->received += threads[i].received;
+		total->lost += threads[i].lost;
+		total->errors += threads[i].errors;
+		total->late += threads[i].late;
+		total->bytesSent += threads[i].bytesSent;
+		total->bytesReceived += threads[i].bytesReceived;
+		merge_Latency(&total->histogram, &threads[i].histogram);
+	}
+	elapsed = bench_Clock() - begin;
+	for(i = 0; i < config->threads; i++)
+		free_Bench_Thread(&threads[i]);
+	free(threads);
+	if(started < config->threads) {
+		free(total);
+		fprintf(stderr, "ERROR: Cannot Start The Benchmark Threads\n");
+		return -1;
+	}
+
+	fprintf(stderr, "sent %llu received %llu lost %llu errors %llu in %.2f s, %.0f requests/s\n",
+	        (unsigned long long) total->sent, (unsigned long long) total->received, (unsigned long long) total->lost,
+	        (unsigned long long) total->errors, elapsed / 1e9, total->received / (elapsed / 1e9));
+	fprintf(stderr, "latency us p50 %.1f p99 %.1f p999 %.1f max %.1f\n",
+	        latency_Percentile(&total->histogram, 50.0) / 1e3, latency_Percentile(&total->histogram, 99.0) / 1e3,
+	        latency_Percentile(&total->histogram, 99.9) / 1e3, total->histogram.max / 1e3);
+	if(config->jsonPath != NULL && (out = fopen(config->jsonPath, "w")) == NULL) {
+		free(total);
+		fprintf(stderr, "ERROR: Cannot Open %s\n", config->jsonPath);
+		return -1;
+	}
+	print_Bench_Json(out, config, total, elapsed);
+	if(out != stdout)
+		fclose(out);
+	free(total);
+	return 0;
+}
+
+
+/*
+ **************************************************
+ *	The echo payloads are built once, a send only writes the slot and sequence number into them.
+ *	MODIFIED ON 10/17/2026
+ *	Binary echoes are a header followed by the payload, the header is written on every send
+ **************************************************
+ */
+int init_Bench_Thread(struct bench_thread *thread){
+	int i, size, inflight = thread->config->inflight;
+	thread->sockfd = socket(AF_INET6, SOCK_DGRAM, 0);
+	//a connected socket lets the kernel skip the route lookup on every send
+	if(thread->sockfd == -1 || connect(thread->sockfd, (struct sockaddr *) &thread->config->dest, sizeof(thread->config->dest)) == -1) {
+		fprintf(stderr, "ERROR: Cannot Open the Benchmark Socket\n");
+		return -1;
+	}
+
+	thread->requests = calloc(inflight, sizeof(struct bench_request));
+	thread->freeSlots = malloc(inflight * sizeof(int));
+	thread->orderedQueue = malloc(inflight * sizeof(int));
+	thread->echoes = calloc(thread->config->sizeCount, sizeof(char *));
+	thread->repeats = calloc(thread->config->sizeCount, sizeof(char *));
+	if(thread->requests == NULL || thread->freeSlots == NULL || thread->orderedQueue == NULL || thread->echoes == NULL
+	   || thread->repeats == NULL) {
+		fprintf(stderr, "ERROR: Cannot Allocate Benchmark Requests\n");
+		return -1;
+	}
+	for(i = 0; i < inflight; i++)
+		thread->freeSlots[i] = inflight - 1 - i;
+	thread->freeCount = inflight;
+
+	for(i = 0; i < thread->config->sizeCount; i++) {
+		size = thread->config->sizes[i];
+		thread->echoes[i] = malloc(size + (thread->config->binary ? BINARY_HEADER_SIZE : sizeof("<echo></echo>")));
+		thread->repeats[i] = malloc(size + sizeof("<echo></echo>"));
+		if(thread->echoes[i] == NULL || thread->repeats[i] == NULL) {
+			fprintf(stderr, "ERROR: Cannot Allocate Benchmark Requests\n");
+			return -1;
+		}
+		if(thread->config->binary) {
+			memset(thread->echoes[i] + BINARY_HEADER_SIZE, 'x', size);
+			continue;
+		}
+		memcpy(thread->echoes[i], "<echo>", 6);
+		memset(thread->echoes[i] + 6, 'x', size);
+		memcpy(thread->echoes[i] + 6 + size, "</echo>", 8);
+		memcpy(thread->repeats[i], thread->echoes[i], size + sizeof("<echo></echo>")); //never gets an ID written into it
+	}
+	thread->histogram.min = UINT64_MAX;
+	return 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void free_Bench_Thread(struct bench_thread *thread){
+	int i;
+	for(i = 0; i < thread->config->sizeCount; i++) {
+		if(thread->echoes != NULL)
+			free(thread->echoes[i]);
+		if(thread->repeats != NULL)
+			free(thread->repeats[i]);
+	}
+	free(thread->echoes);
+	free(thread->repeats);
+	free(thread->requests);
+	free(thread->freeSlots);
+	free(thread->orderedQueue);
+	if(thread->sockfd > 0)
+		close(thread->sockfd);
+}
+
+
+/*
+ **************************************************
+ *	On the open loop schedule a request that finds every slot taken stays due and is sent
+ *	as soon as a slot frees up, its latency still counts from when it was due.
+ **************************************************
+ */
+void *bench_Thread(void *arg){
+	struct bench_thread *thread = arg;
+	struct bench_config *config = thread->config;
+	struct pollfd readable = { thread->sockfd, POLLIN, 0 };
+	struct timespec wait;
+	uint64_t now = bench_Clock(), end, next, interval = 0, timeout, nextExpire, waitFor;
+
+	end = now + (uint64_t) config->duration * 1000000000ULL;
+	timeout = (uint64_t) config->timeout * 1000000ULL;
+	next = now + thread->id * 1000ULL; //spread the first sends of the threads a little
+	nextExpire = now + BENCH_EXPIRE_MIL_SEC * 1000000ULL;
+	if(config->rate > 0)
+		interval = (uint64_t) (1e9 * config->threads / config->rate);
+
+	while(now < end || (thread->freeCount < config->inflight && now < end + timeout)) {
+		if(now < end) {
+			if(interval == 0)
+				while(send_Bench_Request(thread, bench_Clock()));
+			else
+				for(; next <= now && next < end && send_Bench_Request(thread, next); next += interval);
+		}
+
+		//sleep until a reply arrives, the next request is due or it is time to look for lost requests
+		waitFor = nextExpire > now ? nextExpire - now : 0;
+		if(interval != 0 && now < end && thread->freeCount > 0)
+			waitFor = next > now ? (next - now < waitFor ? next - now : waitFor) : 0;
+		wait.tv_sec = waitFor / 1000000000ULL;
+		wait.tv_nsec = waitFor % 1000000000ULL;
+		if(ppoll(&readable, 1, &wait, NULL) > 0)
+			receive_Bench_Replies(thread);
+
+		now = bench_Clock();
+		if(now >= nextExpire) {
+			expire_Bench_Requests(thread, now, timeout);
+			nextExpire = now + BENCH_EXPIRE_MIL_SEC * 1000000ULL;
+		}
+	}
+	//whatever is still outstanding after the timeout is lost
+	expire_Bench_Requests(thread, UINT64_MAX, 0);
+	return NULL;
+}
+
+
+/*
+ **************************************************
+ *	MODIFIED ON 10/17/2026
+ *	A share of the requests follows a datagram the server rejects, to mix both into its batches
+ *	A padded frame is the request followed by null characters gathered from a static buffer
+ **************************************************
+ */
+int send_Bench_Request(struct bench_thread *thread, uint64_t scheduled){
+	static const char hex[] = "0123456789abcdef", oversized[BENCH_OVERSIZED], padding[MAX_MESSAGE];
+	struct bench_config *config = thread->config;
+	struct bench_request *request;
+	struct iovec frame[2];
+	struct msghdr header = { .msg_iov = frame, .msg_iovlen = 2 };
+	char *message;
+	int slot, length, loadavg, repeat = 0, i, sent;
+	uint64_t id;
+
+	if(thread->freeCount == 0)
+		return 0;
+	slot = thread->freeSlots[--thread->freeCount];
+	request = &thread->requests[slot];
+	request->seq = thread->nextSeq++;
+	request->scheduled = scheduled;
+	request->active = 1;
+	//spread the loadavg requests evenly through the sequence, and the repeated echoes through the echoes
+	loadavg = ((uint64_t) request->seq * config->loadavgPercent) % 100 + config->loadavgPercent >= 100;
+	if(!loadavg) {
+		repeat = ((uint64_t) thread->nextEcho * config->repeatPercent) % 100 + config->repeatPercent >= 100;
+		thread->nextEcho++;
+	}
+	request->ordered = !config->binary && (loadavg || repeat);
+	id = (uint64_t) slot << 32 | request->seq;
+
+	if(config->binary) {
+		message = loadavg ? (char *) &thread->loadavgRequest : thread->echoes[thread->nextSize];
+		length = loadavg ? 0 : config->sizes[thread->nextSize];
+		if(!loadavg)
+			thread->nextSize = (thread->nextSize + 1) % config->sizeCount;
+		write_Binary_Header((struct binary_header *) message, loadavg ? BINARY_LOADAVG : BINARY_ECHO, 0, id, length);
+		length += BINARY_HEADER_SIZE;
+	}
+	else if(loadavg) {
+		message = "<loadavg/>";
+		length = sizeof("<loadavg/>") - 1;
+	}
+	else {
+		message = repeat ? thread->repeats[thread->nextSize] : thread->echoes[thread->nextSize];
+		length = config->sizes[thread->nextSize] + sizeof("<echo></echo>") - 1;
+		thread->nextSize = (thread->nextSize + 1) % config->sizeCount;
+		for(i = BENCH_ID_DIGITS - 1; i >= 0 && !repeat; i--, id >>= 4)
+			message[6 + i] = hex[id & 0xF];
+	}
+	if(request->ordered)
+		thread->orderedQueue[thread->queueTail++ % config->inflight] = slot;
+	if(((uint64_t) request->seq * config->rejectPercent) % 100 + config->rejectPercent >= 100)
+		send(thread->sockfd, oversized, sizeof(oversized), 0); //only its error reply comes back, it has no slot
+	frame[0].iov_base = message;
+	frame[0].iov_len = length;
+	frame[1].iov_base = (void *) padding;
+	frame[1].iov_len = config->padded && !config->binary && length < MAX_MESSAGE ? MAX_MESSAGE - length : 0;
+	if((sent = sendmsg(thread->sockfd, &header, 0)) == -1) {
+		if(request->ordered)
+			thread->queueTail--;
+		request->active = 0;
+		thread->freeSlots[thread->freeCount++] = slot;
+		thread->errors++;
+		return 0;
+	}
+	thread->sent++;
+	thread->bytesSent += sent;
+	return 1;
+}
+
+
+/*
+ **************************************************
+ *	A reply that matches no outstanding request arrived after its request was counted as lost.
+ *	MODIFIED ON 10/17/2026
+ *	A binary reply is matched by the ID in its header
+ **************************************************
+ */
+void receive_Bench_Replies(struct bench_thread *thread){
+	char reply[BENCH_MAX_PAYLOAD + MAX_MESSAGE];
+	struct bench_request *request;
+	struct binary_header header;
+	int received, slot, i, inflight = thread->config->inflight;
+	uint64_t id, now;
+
+	while((received = recv(thread->sockfd, reply, sizeof(reply), MSG_DONTWAIT)) > 0) {
+		now = bench_Clock();
+		thread->bytesReceived += received;
+		if(is_Binary(reply, received)) {
+			if(read_Binary_Header(reply, received, &header) == -1 || (header.flags & (BINARY_FLAG_ERROR | BINARY_FLAG_TEXT))) {
+				thread->errors++;
+				continue;
+			}
+			slot = header.id >> 32;
+			if(slot < inflight && thread->requests[slot].active && thread->requests[slot].seq == (uint32_t) header.id)
+				complete_Bench_Request(thread, slot, now);
+			else
+				thread->late++;
+		}
+		else if(received >= 7 + BENCH_ID_DIGITS && !strncmp(reply, "<reply>", 7) && reply[7] != 'x') {
+			for(i = 0, id = 0; i < BENCH_ID_DIGITS; i++)
+				id = id << 4 | (reply[7 + i] <= '9' ? reply[7 + i] - '0' : reply[7 + i] - 'a' + 10);
+			slot = id >> 32;
+			if(slot < inflight && thread->requests[slot].active && !thread->requests[slot].ordered
+			   && thread->requests[slot].seq == (uint32_t) id)
+				complete_Bench_Request(thread, slot, now);
+			else
+				thread->late++;
+		}
+		else if(!strncmp(reply, "<replyLoadAvg", 13) || !strncmp(reply, "<reply>", 7)) {
+			//replies come back in order, skip the requests in front that were already counted as lost
+			for(slot = -1; thread->queueHead != thread->queueTail && slot == -1; thread->queueHead++) {
+				request = &thread->requests[thread->orderedQueue[thread->queueHead % inflight]];
+				if(request->active && request->ordered)
+					slot = thread->orderedQueue[thread->queueHead % inflight];
+			}
+			if(slot == -1)
+				thread->late++;
+			else
+				complete_Bench_Request(thread, slot, now);
+		}
+		else
+			thread->errors++;
+	}
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void complete_Bench_Request(struct bench_thread *thread, int slot, uint64_t now){
+	struct bench_request *request = &thread->requests[slot];
+	record_Latency(&thread->histogram, now > request->scheduled ? now - request->scheduled : 0);
+	request->active = 0;
+	thread->freeSlots[thread->freeCount++] = slot;
+	thread->received++;
+}
+
+
+/*
+ **************************************************
+ *	Lost <loadavg/> and repeated echo requests are taken out of the queue before their slots can be reused,
+ *	so the queue only ever holds outstanding requests in the order they were sent.
+ **************************************************
+ */
+void expire_Bench_Requests(struct bench_thread *thread, uint64_t now, uint64_t timeout){
+	int slot, inflight = thread->config->inflight;
+	uint64_t kept, i;
+	struct bench_request *request;
+	for(slot = 0; slot < inflight; slot++) {
+		request = &thread->requests[slot];
+		if(request->active && now - request->scheduled >= timeout) {
+			request->active = 0;
+			thread->freeSlots[thread->freeCount++] = slot;
+			thread->lost++;
+		}
+	}
+	for(i = kept = thread->queueHead; i != thread->queueTail; i++) {
+		slot = thread->orderedQueue[i % inflight];
+		if(thread->requests[slot].active)
+			thread->orderedQueue[kept++ % inflight] = slot;
+	}
+	thread->queueTail = kept;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void print_Bench_Json(FILE *out, struct bench_config *config, struct bench_thread *total, uint64_t elapsed){
+	int i;
+	struct latency_histogram *histogram = &total->histogram;
+	char server[INET6_ADDRSTRLEN];
+	inet_ntop(AF_INET6, &config->dest.sin6_addr, server, sizeof(server));
+	fprintf(out, "{\"server\": \"[%s]:%d\", \"threads\": %d, \"inflight\": %d, \"rate\": %.0f, \"duration_sec\": %d, ",
+	        server, ntohs(config->dest.sin6_port), config->threads, config->inflight,
+	        config->rate, config->duration);
+	fprintf(out, "\"binary\": %s, \"padded\": %s, \"loadavg_percent\": %d, \"repeat_percent\": %d, \"reject_percent\": %d, \"echo_sizes\": [",
+	        config->binary ? "true" : "false", config->padded ? "true" : "false", config->loadavgPercent, config->repeatPercent, config->rejectPercent);
+	for(i = 0; i < config->sizeCount; i++)
+		fprintf(out, i == 0 ? "%d" : ", %d", config->sizes[i]);
+	fprintf(out, "], \"elapsed_sec\": %.3f, \"sent\": %llu, \"received\": %llu, \"lost\": %llu, \"errors\": %llu, \"late\": %llu, ",
+	        elapsed / 1e9, (unsigned long long) total->sent, (unsigned long long) total->received,
+	        (unsigned long long) total->lost, (unsigned long long) total->errors, (unsigned long long) total->late);
+	fprintf(out, "\"request_bytes\": %.1f, \"reply_bytes\": %.1f, ",
+	        total->sent > 0 ? (double) total->bytesSent / total->sent : 0.0,
+	        total->received > 0 ? (double) total->bytesReceived / total->received : 0.0);
+	fprintf(out, "\"loss_percent\": %.3f, \"throughput_rps\": %.1f, ",
+	        total->sent > 0 ? 100.0 * total->lost / total->sent : 0.0, total->received / (elapsed / 1e9));
+	fprintf(out, "\"latency_us\": {\"min\": %.1f, \"mean\": %.1f, \"p50\": %.1f, \"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f}}\n",
+	        histogram->count > 0 ? histogram->min / 1e3 : 0.0, histogram->count > 0 ? (double) histogram->sum / histogram->count / 1e3 : 0.0,
+	        latency_Percentile(histogram, 50.0) / 1e3, latency_Percentile(histogram, 99.0) / 1e3,
+	        latency_Percentile(histogram, 99.9) / 1e3, histogram->max / 1e3);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+int run_Codec_Bench(struct bench_config *config, int iterations){
+	char *request = malloc(BENCH_MAX_PAYLOAD + MAX_MESSAGE), *reply = malloc(BENCH_MAX_PAYLOAD + MAX_MESSAGE);
+	int i;
+	if(request == NULL || reply == NULL) {
+		free(request);
+		free(reply);
+		fprintf(stderr, "ERROR: Cannot Allocate Codec Buffers\n");
+		return -1;
+	}
+	printf("nano seconds per message        text format  binary format   text parse  binary parse\n");
+	for(i = 0; i < config->sizeCount; i++)
+		time_Codec(config->sizes[i], iterations, request, reply);
+	time_Codec(0, iterations, request, reply);
+	free(request);
+	free(reply);
+	return 0;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Formatting an echo is writing the request, parsing it is finding the payload of the reply.
+ *	For <loadavg/> the request is a constant, so formatting is what the server does with a sample
+ *	and parsing is reading the three figures back out of the reply.
+ **************************************************
+ */
+void time_Codec(int size, int iterations, char *request, char *reply){
+	static const double loadAvg[3] = { 0.52, 1.25, 10.5 };
+	struct binary_header header;
+	double parsed[3];
+	uint64_t start, elapsed[4];
+	int i, length, textLength, binaryLength;
+	volatile int sink = 0;
+	char *payload = reply + BINARY_HEADER_SIZE + MAX_MESSAGE;
+
+	memset(payload, 'x', size);
+	start = bench_Clock();
+	for(i = 0; i < iterations; i++) {
+		if(size == 0)
+			length = snprintf(reply, MAX_MESSAGE, "<replyLoadAvg>%f:%f:%f</replyLoadAvg>", loadAvg[0], loadAvg[1], loadAvg[2]);
+		else {
+			memcpy(request, "<echo>", 6);
+			memcpy(request + 6, payload, size);
+			memcpy(request + 6 + size, "</echo>", 7);
+			length = size + 13;
+		}
+		sink += length;
+	}
+	elapsed[0] = bench_Clock() - start;
+	textLength = size == 0 ? length : size + 15;
+
+	start = bench_Clock();
+	for(i = 0; i < iterations; i++) {
+		if(size == 0) {
+			write_Binary_Loadavg(reply + BINARY_HEADER_SIZE, loadAvg, 0);
+			length = BINARY_LOADAVG_SIZE;
+		}
+		else {
+			write_Binary_Header((struct binary_header *) request, BINARY_ECHO, 0, i, size);
+			memcpy(request + BINARY_HEADER_SIZE, payload, size);
+			length = size;
+		}
+		sink += length;
+	}
+	elapsed[1] = bench_Clock() - start;
+
+	//the replies are built once, the loops below only read them
+	if(size != 0) {
+		memcpy(reply, "<reply>", 7);
+		memcpy(reply + 7, payload, size);
+		memcpy(reply + 7 + size, "</reply>", 9);
+	}
+	start = bench_Clock();
+	for(i = 0; i < iterations; i++) {
+		if(size == 0)
+			sink += sscanf(reply, "<replyLoadAvg>%lf:%lf:%lf", &parsed[0], &parsed[1], &parsed[2]);
+		else if(!strncmp(reply, "<reply>", 7) && !strncmp(reply + textLength - 8, "</reply>", 8))
+			memcpy(request, reply + 7, textLength - 15);
+	}
+	elapsed[2] = bench_Clock() - start;
+
+	write_Binary_Header((struct binary_header *) reply, size == 0 ? BINARY_LOADAVG : BINARY_ECHO, BINARY_FLAG_REPLY, 1,
+	                    size == 0 ? BINARY_LOADAVG_SIZE : size);
+	if(size != 0)
+		memcpy(reply + BINARY_HEADER_SIZE, payload, size);
+	binaryLength = BINARY_HEADER_SIZE + (size == 0 ? BINARY_LOADAVG_SIZE : size);
+	start = bench_Clock();
+	for(i = 0; i < iterations; i++) {
+		if(read_Binary_Header(reply, binaryLength, &header) == -1)
+			continue;
+		if(size == 0)
+			sink += read_Binary_Loadavg(reply + BINARY_HEADER_SIZE, header.length, parsed, NULL);
+		else
+			memcpy(request, reply + BINARY_HEADER_SIZE, header.length);
+	}
+	elapsed[3] = bench_Clock() - start;
+
+	if(size == 0)
+		printf("loadavg                     ");
+	else
+		printf("echo %4d bytes              ", size);
+	for(i = 0; i < 4; i++)
+		printf(" %12.1f", (double) elapsed[i] / iterations);
+	printf("\n");
+}
+
+
+/*
+ **************************************************
+ *	The counter of a value is its top HISTOGRAM_SUB_BITS significant bits, so each counter
+ *	covers under 1/64 of the values it stands for.
+ **************************************************
+ */
+void record_Latency(struct latency_histogram *histogram, uint64_t value){
+	int bucket = 63 - __builtin_clzll(value | (2 * HISTOGRAM_HALF - 1)) - (HISTOGRAM_SUB_BITS - 1);
+	int index;
+	if(bucket > HISTOGRAM_BUCKETS)
+		index = HISTOGRAM_SIZE - 1;
+	else
+		index = bucket * HISTOGRAM_HALF + (int) (value >> bucket);
+	histogram->counts[index]++;
+	histogram->count++;
+	histogram->sum += value;
+	if(value < histogram->min)
+		histogram->min = value;
+	if(value > histogram->max)
+		histogram->max = value;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void merge_Latency(struct latency_histogram *into, struct latency_histogram *from){
+	int i;
+	if(from->count == 0)
+		return;
+	if(into->count == 0 || from->min < into->min)
+		into->min = from->min;
+	if(from->max > into->max)
+		into->max = from->max;
+	into->count += from->count;
+	into->sum += from->sum;
+	for(i = 0; i < HISTOGRAM_SIZE; i++)
+		into->counts[i] += from->counts[i];
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+uint64_t latency_Percentile(struct latency_histogram *histogram, double percentile){
+	uint64_t target, seen = 0, highest;
+	int index, bucket;
+	if(histogram->count == 0)
+		return 0;
+	target = (uint64_t) (percentile / 100.0 * histogram->count + 0.5);
+	if(target < 1)
+		target = 1;
+	for(index = 0; index < HISTOGRAM_SIZE; index++) {
+		seen += histogram->counts[index];
+		if(seen >= target)
+			break;
+	}
+	if(index == HISTOGRAM_SIZE)
+		index--;
+	bucket = index < 2 * HISTOGRAM_HALF ? 0 : index / HISTOGRAM_HALF - 1;
+	highest = (((uint64_t) (index - bucket * HISTOGRAM_HALF) + 1) << bucket) - 1;
+	return highest < histogram->max ? highest : histogram->max;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+uint64_t bench_Clock(void){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
@@ -0,0 +1,190 @@
+/**	@file UDPbench.h
+ * 	@brief Contains the function prototypes for the load generator and latency benchmark 
+ *	of the C client that are implemented in UDPbench.c
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPBENCH_H
+#define UDPBENCH_H
+
+#include "UDPclient.h"	//first, it turns on the GNU extensions the system headers need for ppoll
+#include <stdint.h>
+#include <pthread.h>
+#include <poll.h>
+#include <errno.h>
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define BENCH_MAX_THREADS 64
+#define BENCH_MAX_INFLIGHT 4096		//requests outstanding per thread
+#define BENCH_MAX_SIZES 16
+#define BENCH_ID_DIGITS 16		//slot and sequence number carried in every echo as hex
+#define BENCH_MIN_PAYLOAD BENCH_ID_DIGITS
+#define BENCH_MAX_PAYLOAD 1400		//an echo and its reply fit one datagram of the default MTU
+#define BENCH_OVERSIZED 1024		//datagram a server with the default maximum message size rejects
+#define BENCH_MAX_DURATION_SEC 3600
+#define DEFAULT_BENCH_THREADS 1
+#define DEFAULT_BENCH_INFLIGHT 16
+#define DEFAULT_BENCH_DURATION_SEC 5
+#define DEFAULT_BENCH_TIMEOUT_MIL_SEC 1000
+#define DEFAULT_BENCH_SIZES "16,64,200"
+#define BENCH_EXPIRE_MIL_SEC 10		//how often outstanding requests are checked for a timeout
+#define HISTOGRAM_SUB_BITS 7		//64 counters per power of two, a percentile is at most 1/64 too high
+#define HISTOGRAM_HALF (1 << (HISTOGRAM_SUB_BITS - 1))
+#define HISTOGRAM_BUCKETS 40		//values up to 2^46 ns
+#define HISTOGRAM_SIZE ((HISTOGRAM_BUCKETS + 1) * HISTOGRAM_HALF)
+#define CODEC_ITERATIONS 1000000	//messages formatted and parsed per form by the codec benchmark
+
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+/**	@brief 	Log linear latency histogram in the style of HdrHistogram. Values below 128 ns have
+*			their own counter, above that every power of two is split into 64 equal counters.
+*/
+struct latency_histogram {
+	uint64_t count;
+	uint64_t min;
+	uint64_t max;
+	uint64_t sum;
+	uint64_t counts[HISTOGRAM_SIZE];
+};
+
+/**	@brief 	What the benchmark runs, chosen on the command line.
+*			rate is the total requests per second of the open loop schedule, 0 runs closed loop 
+*			and keeps inflight requests outstanding on every thread.
+*			loadavgPercent is the share of requests that are <loadavg/>, the rest are echoes 
+*			whose payload sizes are picked in turn from sizes.
+*			repeatPercent is the share of the echoes that carry the same payload every time, like health
+*			checks do.
+*			binary sends every request in the binary form with its slot and sequence number as the header ID.
+*			rejectPercent is the share of requests sent right after a datagram the server rejects as too long,
+*			so the server receives both in the same batch.
+*			padded sends every text request as a null padded MAX_MESSAGE byte frame, like old clients do.
+*/
+struct bench_config {
+	int threads;
+	int inflight;
+	double rate;
+	int duration;
+	int timeout;
+	int loadavgPercent;
+	int repeatPercent;
+	int rejectPercent;
+	int binary;
+	int padded;
+	int sizes[BENCH_MAX_SIZES];
+	int sizeCount;
+	char *jsonPath;
+	struct sockaddr_in6 dest;
+};
+
+/**	@brief 	One outstanding request. scheduled is the time the request should have been sent,
+*			latency is measured from it so a slow server is not hidden by a late send.
+*			ordered is set for a request whose reply carries no ID, a text <loadavg/> or repeated echo.
+*/
+struct bench_request {
+	uint32_t seq;
+	int active;
+	int ordered;
+	uint64_t scheduled;
+};
+
+/**	@brief 	One sending thread with its own connected socket and outstanding requests.
+*			Echo replies carry their slot and sequence number, <loadavg/> and repeated echo replies
+*			are matched in the order the requests were sent through the ordered queue.
+*			loadavgRequest is the binary <loadavg/> request.
+*/
+struct bench_thread {
+	int id;
+	int sockfd;
+	pthread_t thread;
+	struct bench_config *config;
+	struct bench_request *requests;
+	int *freeSlots;
+	int freeCount;
+	int *orderedQueue;
+	uint64_t queueHead;
+	uint64_t queueTail;
+	uint32_t nextSeq;
+	int nextSize;
+	char **echoes;
+	char **repeats;
+	uint32_t nextEcho;
+	struct binary_header loadavgRequest;
+	uint64_t sent;
+	uint64_t received;
+	uint64_t lost;
+	uint64_t errors;
+	uint64_t late;
+	uint64_t bytesSent;
+	uint64_t bytesReceived;
+	struct latency_histogram histogram;
+};
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Reads a comma separated list of echo payload sizes into the configuration.
+*	@param 	list is the list, for example 16,64,200.
+*			config is the configuration the sizes are written to.
+*	@return returns 0 on success, -1 when a size is out of range or there are too many.
+*/
+int parse_Bench_Sizes(char *list, struct bench_config *config);
+
+/**	@brief 	Finds the IPv4 address of the server the benchmark sends to.
+*	@param 	serverName is the name or address of the server.
+*			serverPort is the port the server listens on.
+*			config is the configuration the address is written to.
+*	@return returns 0 on success, -1 when the name cannot be resolved.
+*/
+int bench_Address(char *serverName, int serverPort, struct bench_config *config);
+
+/**	@brief 	Runs the benchmark threads for the configured duration, prints a summary to stderr
+*			and writes the results as JSON to the configured file or stdout.
+*	@param 	config is the benchmark to run.
+*	@return returns 0 on success, -1 when the benchmark could not be started.
+*/
+int run_Bench(struct bench_config *config);
+
+/**	@brief 	Times formatting every request and parsing every reply of the benchmark mix in the text and
+*			the binary form without sending them, and prints the nano seconds per message to stdout.
+*	@param 	config is the benchmark, the echoes of its sizes and <loadavg/> are timed.
+*			iterations is the number of messages timed per form.
+*	@return returns 0 on success, -1 when the buffers cannot be allocated.
+*/
+int run_Codec_Bench(struct bench_config *config, int iterations);
+
+/**	@brief 	Counts one latency in a histogram.
+*	@param 	histogram is the histogram to count in.
+*			value is the latency in nano seconds.
+*	@return returns nothing.
+*/
+void record_Latency(struct latency_histogram *histogram, uint64_t value);
+
+/**	@brief 	Adds the counts of one histogram to another.
+*	@param 	into is the histogram that is added to.
+*			from is the histogram that is added.
+*	@return returns nothing.
+*/
+void merge_Latency(struct latency_histogram *into, struct latency_histogram *from);
+
+/**	@brief 	Finds the latency at a percentile.
+*	@param 	histogram is the histogram to look in.
+*			percentile is between 0 and 100.
+*	@return returns the highest latency in the counter the percentile falls in, 0 when empty.
+*/
+uint64_t latency_Percentile(struct latency_histogram *histogram, double percentile);
+
+#endif
@@ -0,0 +1,93 @@
+/**	@file UDPbinary.c
+ * 	@brief Contains the function implementations of the binary form of the requests and replies.
+ *	A binary message is a fixed header followed by the payload, so the receiver reads the command
+ *	from one byte instead of parsing a tag, and numbers are sent as fixed point values instead of text.
+ *	Text and binary messages are told apart by their first byte and are accepted on the same port.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPbinary.h"
+
+/*
+ **************************************************
+ *		BINARY FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ **************************************************
+ */
+int is_Binary(const char *message, int length){
+  return length >= BINARY_HEADER_SIZE && (uint8_t) message[0] == BINARY_MAGIC;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void write_Binary_Header(struct binary_header *header, int opcode, int flags, uint64_t id, uint32_t length){
+  header->magic = BINARY_MAGIC;
+  header->opcode = opcode;
+  header->flags = htons(flags);
+  header->length = htonl(length);
+  header->id = htobe64(id);
+}
+
+
+/*
+ **************************************************
+ *	The message may not be aligned, the header is copied out before its fields are read.
+ **************************************************
+ */
+int read_Binary_Header(const char *message, int length, struct binary_header *header){
+  if(!is_Binary(message, length))
+    return -1;
+  memcpy(header, message, BINARY_HEADER_SIZE);
+  header->flags = ntohs(header->flags);
+  header->length = ntohl(header->length);
+  header->id = be64toh(header->id);
+  return header->length == (uint32_t) (length - BINARY_HEADER_SIZE) ? 0 : -1;
+}
+
+
+/*
+ **************************************************
+ *	Load averages above BINARY_LOADAVG_MAX are sent as the largest value.
+ **************************************************
+ */
+void write_Binary_Loadavg(char *payload, const double loadAvg[3], uint64_t sampled){
+  uint32_t fixed;
+  int i;
+  for(i = 0; i < 3; i++) {
+    fixed = loadAvg[i] >= BINARY_LOADAVG_MAX ? UINT32_MAX : (uint32_t) (loadAvg[i] * (1 << BINARY_LOADAVG_SHIFT) + 0.5);
+    fixed = htonl(fixed);
+    memcpy(payload + i * sizeof(fixed), &fixed, sizeof(fixed));
+  }
+  sampled = htobe64(sampled);
+  memcpy(payload + 3 * sizeof(fixed), &sampled, sizeof(sampled));
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int read_Binary_Loadavg(const char *payload, int length, double loadAvg[3], uint64_t *sampled){
+  uint32_t fixed;
+  uint64_t time;
+  int i;
+  if(length != BINARY_LOADAVG_SIZE)
+    return -1;
+  for(i = 0; i < 3; i++) {
+    memcpy(&fixed, payload + i * sizeof(fixed), sizeof(fixed));
+    loadAvg[i] = (double) ntohl(fixed) / (1 << BINARY_LOADAVG_SHIFT);
+  }
+  memcpy(&time, payload + 3 * sizeof(fixed), sizeof(time));
+  if(sampled != NULL)
+    *sampled = be64toh(time);
+  return 0;
+}
@@ -0,0 +1,107 @@
+/**	@file UDPbinary.h
+ * 	@brief Contains the function prototypes for encoding and decoding the binary form of the
+ *	requests and replies, implemented in UDPbinary.c and used by both the UDP server and the C client.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPBINARY_H
+#define UDPBINARY_H
+
+#include "UDPfragment.h"
+#include <stdint.h>
+#include <string.h>
+#include <endian.h>
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define BINARY_MAGIC 0xBA		//first byte of a binary message, text starts with '<' or '#' and fragments with FRAGMENT_MAGIC
+#define BINARY_HEADER_SIZE 16
+#define BINARY_ERROR 0			//opcodes, the same numbers as the message_opcode of the server
+#define BINARY_ECHO 1
+#define BINARY_LOADAVG 2
+#define BINARY_SHUTDOWN 3
+#define BINARY_LIMITS 4
+#define BINARY_STATS 5
+#define BINARY_FLAG_REPLY 0x1
+#define BINARY_FLAG_ERROR 0x2		//the payload is the error text
+#define BINARY_FLAG_TEXT 0x4		//the command has no binary form, the payload is its text reply
+#define BINARY_LOADAVG_SHIFT 16		//load averages are unsigned 16.16 fixed point numbers
+#define BINARY_LOADAVG_SIZE 20		//three load averages and the sample time
+#define BINARY_LOADAVG_MAX 65535.0
+
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+/**	@brief 	Starts every binary request and reply, all fields after magic and opcode are in network byte order
+*			on the wire. id is chosen by the client and returned in the reply, length is the number of payload
+*			bytes that follow the header.
+*			The payload of an echo is the text to echo and the reply returns it unchanged. A <loadavg/> reply
+*			holds the 1, 5 and 15 minute load averages as 32 bit fixed point numbers followed by the 64 bit
+*			CLOCK_REALTIME milli seconds they were sampled. Other commands reply with BINARY_FLAG_TEXT.
+*/
+struct binary_header {
+  uint8_t magic;
+  uint8_t opcode;
+  uint16_t flags;
+  uint32_t length;
+  uint64_t id;
+};
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Checks if a message is in the binary form.
+*	@param 	message is the received message.
+*			length is the number of bytes received.
+*	@return returns 1 if the message starts with BINARY_MAGIC, 0 otherwise.
+*/
+int is_Binary(const char *message, int length);
+
+/**	@brief 	Fills in a header in network byte order.
+*	@param 	header is the header to write.
+*			opcode is the command.
+*			flags are the BINARY_FLAG bits.
+*			id is the request ID.
+*			length is the payload length.
+*	@return returns nothing.
+*/
+void write_Binary_Header(struct binary_header *header, int opcode, int flags, uint64_t id, uint32_t length);
+
+/**	@brief 	Reads the header of a binary message and converts it to host byte order.
+*	@param 	message is the message.
+*			length is the length of the message.
+*			header is where the fields are written.
+*	@return returns 0 on success, -1 if the message is not a binary message or its length field does not match.
+*/
+int read_Binary_Header(const char *message, int length, struct binary_header *header);
+
+/**	@brief 	Writes the payload of a binary <loadavg/> reply.
+*	@param 	payload is where the BINARY_LOADAVG_SIZE bytes are written.
+*			loadAvg is the 1, 5 and 15 minute load averages.
+*			sampled is the CLOCK_REALTIME time in milli seconds they were read.
+*	@return returns nothing.
+*/
+void write_Binary_Loadavg(char *payload, const double loadAvg[3], uint64_t sampled);
+
+/**	@brief 	Reads the payload of a binary <loadavg/> reply.
+*	@param 	payload is the payload.
+*			length is the payload length.
+*			loadAvg is where the 1, 5 and 15 minute load averages are written.
+*			sampled is where the sample time is written, may be NULL.
+*	@return returns 0 on success, -1 if the payload has the wrong length.
+*/
+int read_Binary_Loadavg(const char *payload, int length, double loadAvg[3], uint64_t *sampled);
+
+#endif
@@ -0,0 +1,164 @@
+/**	@file UDPbuffer.c
+ * 	@brief Contains the function implementations of sizing the socket buffers.
+ *	A burst larger than the receive buffer of a socket is dropped by the kernel before a server loop
+ *	can read it. SO_RXQ_OVFL makes the kernel hand the number of datagrams a socket dropped so far to
+ *	every datagram it receives, the server loops count the difference into their statistics and
+ *	can double the receive buffer of a socket whenever it dropped datagrams, up to a set size.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPbuffer.h"
+#include "UDPstats.h"
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Sets the size of a socket buffer, forced past the system limit when the server may.
+*	@param 	sockfd is the socket.
+*			option is SO_RCVBUF or SO_SNDBUF.
+*			force is SO_RCVBUFFORCE or SO_SNDBUFFORCE.
+*			size is the size in bytes.
+*	@return returns 0 on success, -1 if the size cannot be set.
+*/
+int set_Buffer(int sockfd, int option, int force, int size);
+
+/**	@brief 	Doubles the receive buffer of a socket that dropped datagrams, up to the largest size allowed.
+*	@param 	worker is the server loop.
+*			index is the number of the socket in the loop.
+*			drops is the number of datagrams it dropped since the last time.
+*	@return returns nothing.
+*/
+void grow_Receive_Buffer(struct server_worker *worker, int index, uint32_t drops);
+
+/*
+ **************************************************
+ *		BUFFER FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+int set_Socket_Buffers(int sockfd, struct server_config *config){
+  int on = 1;
+  if(config->receiveBuffer > 0 && set_Buffer(sockfd, SO_RCVBUF, SO_RCVBUFFORCE, config->receiveBuffer) == -1)
+	return printErrorMessage("Cannot Set SO_RCVBUF for socket");
+  if(config->sendBuffer > 0 && set_Buffer(sockfd, SO_SNDBUF, SO_SNDBUFFORCE, config->sendBuffer) == -1)
+	return printErrorMessage("Cannot Set SO_SNDBUF for socket");
+  if(setsockopt(sockfd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) == -1)
+	return printErrorMessage("Cannot Set SO_RXQ_OVFL for socket");
+  return 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int control_Size(struct server_config *config){
+  return trace_Control_Size(config->timestamps) + BUFFER_CONTROL_SIZE;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int socket_Index(struct server_worker *worker, int sockfd){
+  int i;
+  for(i = 0; i < worker->socketCount - 1 && worker->sockets[i] != sockfd; i++)
+    ;
+  return i;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The kernel only adds the control message once the socket dropped something, and the count it
+ *	carries is the total of the socket, the 32 bit difference is right across a wrap.
+ **************************************************
+ */
+void count_Overflow(struct server_worker *worker, int index, void *control, size_t controlLength){
+  struct msghdr header = { .msg_control = control, .msg_controllen = controlLength };
+  struct cmsghdr *message;
+  uint32_t total, drops;
+  if(control == NULL)
+    return;
+  for(message = CMSG_FIRSTHDR(&header); message != NULL; message = CMSG_NXTHDR(&header, message)) {
+    if(message->cmsg_level != SOL_SOCKET || message->cmsg_type != SO_RXQ_OVFL)
+      continue;
+    memcpy(&total, CMSG_DATA(message), sizeof(total));
+    drops = total - worker->overflows[index];
+    if(drops == 0)
+      return;
+    worker->overflows[index] = total;
+    count_Overflows(worker, drops);
+    if(worker->config->maxReceiveBuffer > 0)
+      grow_Receive_Buffer(worker, index, drops);
+    return;
+  }
+}
+
+
+/*
+ **************************************************
+ *	getsockopt reports twice the size that was set, the kernel keeps the other half for its bookkeeping.
+ *	The kernel default is reported as it is, so it comes back as half of net.core.rmem_default.
+ **************************************************
+ */
+int receive_Buffer(int sockfd){
+  int size;
+  socklen_t length = sizeof(size);
+  if(getsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &size, &length) == -1)
+    return -1;
+  return size / 2;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Without CAP_NET_ADMIN the forced option fails and the kernel caps the size at its limit,
+ *	which is printed the first time so the limit can be raised.
+ **************************************************
+ */
+int set_Buffer(int sockfd, int option, int force, int size){
+  static atomic_int capped;
+  int actual;
+  socklen_t length = sizeof(actual);
+  if(setsockopt(sockfd, SOL_SOCKET, force, &size, sizeof(size)) == 0)
+    return 0;
+  if(setsockopt(sockfd, SOL_SOCKET, option, &size, sizeof(size)) == -1)
+    return -1;
+  if(getsockopt(sockfd, SOL_SOCKET, option, &actual, &length) == 0 && actual / 2 < size && atomic_exchange(&capped, 1) == 0)
+    printf("Socket buffer capped at %d bytes, raise net.core.%s to use %d\n", actual / 2,
+           option == SO_RCVBUF ? "rmem_max" : "wmem_max", size);
+  return 0;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Every socket of every loop grows on its own, SO_REUSEPORT spreads a burst unevenly.
+ **************************************************
+ */
+void grow_Receive_Buffer(struct server_worker *worker, int index, uint32_t drops){
+  int size = worker->receiveBuffer[index] * 2, limit = worker->config->maxReceiveBuffer;
+  if(worker->receiveBuffer[index] >= limit)
+    return;
+  if(size > limit || size <= 0)
+    size = limit;
+  if(set_Buffer(worker->sockets[index], SO_RCVBUF, SO_RCVBUFFORCE, size) == -1)
+    return;
+  worker->receiveBuffer[index] = size;
+  printf("Worker %d dropped %u datagram(s) on socket %d, SO_RCVBUF doubled to %d bytes\n", worker->id, drops, index, size);
+}
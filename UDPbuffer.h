@@ -0,0 +1,69 @@
+/**	@file UDPbuffer.h
+ * 	@brief Contains the function prototypes for sizing the socket buffers of the UDP server and
+ *	counting the datagrams the kernel dropped because they were full, implemented in UDPbuffer.c
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPBUFFER_H
+#define UDPBUFFER_H
+
+#include "UDPserver.h"
+#include "UDPtrace.h"
+#include <stdint.h>
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define MIN_SOCKET_BUFFER 4096		//bytes, 0 keeps the size the kernel picks
+#define MAX_SOCKET_BUFFER (256 << 20)
+#define BUFFER_CONTROL_SIZE CMSG_SPACE(sizeof(uint32_t))	//room for the SO_RXQ_OVFL control message
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Sets the receive and send buffer sizes of a socket and asks the kernel to report the datagrams
+*			it dropped with every datagram received. A size larger than net.core.rmem_max or wmem_max is
+*			forced when the server may, otherwise the kernel caps it and the cap is printed once.
+*	@param 	sockfd is the socket.
+*			config holds the buffer sizes, 0 keeps the size the kernel picks.
+*	@return returns 0 on success, -1 if a socket option cannot be set.
+*/
+int set_Socket_Buffers(int sockfd, struct server_config *config);
+
+/**	@brief 	Get the room a receive needs for the control messages the server asked for.
+*	@param 	config is the shared configuration.
+*	@return returns the bytes of control messages per datagram.
+*/
+int control_Size(struct server_config *config);
+
+/**	@brief 	Get the number of a socket of a server loop.
+*	@param 	worker is the server loop.
+*			sockfd is one of its sockets.
+*	@return returns the index of the socket in the sockets of the loop.
+*/
+int socket_Index(struct server_worker *worker, int sockfd);
+
+/**	@brief 	Counts the datagrams a socket dropped since the last one it reported, and grows its receive
+*			buffer when the server adapts the buffers to the drops.
+*	@param 	worker is the server loop.
+*			index is the number of the socket in the loop.
+*			control and controlLength are the control messages received with a datagram, may be NULL.
+*	@return returns nothing.
+*/
+void count_Overflow(struct server_worker *worker, int index, void *control, size_t controlLength);
+
+/**	@brief 	Reads the receive buffer size the kernel gave a socket.
+*	@param 	sockfd is the socket.
+*	@return returns the size in bytes as set, not the doubled size the kernel reports, -1 on error.
+*/
+int receive_Buffer(int sockfd);
+
+#endif
@@ -16,6 +16,33 @@
  **************************************************
  */
  
+/*
+ * When set every request is sent as a null padded MAX_MESSAGE byte frame
+ */
+static int paddedFrames = 0;
+
+/*
+ * Path MTU to the server found by createSocket, requests larger than one datagram are fragmented
+ */
+static int pathMtu = DEFAULT_MTU;
+static uint32_t nextMessageId = 0;
+
+/*
+ * Milli seconds a receive waits for a response, set on every socket createSocket makes
+ */
+static int receiveTimeout = RECEIVE_WAIT_TIME;
+
+/*
+ * Addresses looked up by resolveAddress, kept for RESOLVE_CACHE_SEC so a name is not looked up for every request
+ */
+static struct resolved_name resolveCache[RESOLVE_CACHE_SIZE];
+
+/*
+ * Fragmented responses being reassembled, set up on first use
+ */
+static struct reassembly_table reassembly;
+static int reassemblyReady = 0;
+
 /**	@brief 	Is a function that takes in a error message and outputs the message to the display
 *			and stops the server from running. 
 *	@param 	Is the error message that should be outputted to the screen.
@@ -28,19 +55,37 @@ int printErrorMessage( char *message );
 */
 int create_TCP_Socket(void);
 
-/**	@brief 	get IP address of the server that the client will send messages to. 
+/**	@brief 	Looks up the address of a server with getaddrinfo, IPv4 addresses are returned as
+*			IPv4 mapped IPv6 addresses for the dual stack socket.
 *	@param 	serverName is the name of the server. 
-*	@return returns a structure hostent that contains IP information about server. 
+*			address is filled in with the address of the server.
+*			scope is filled in with the scope of a link local address.
+*	@return returns 0 on success, -1 if the server cannot be found.
 */
-struct hostent *info_Host(char * serverName);
+int lookup_Address(char *serverName, struct in6_addr *address, uint32_t *scope);
 
-/**	@brief Set the destination address and port of the server. 
-*	@param 	hostptr is the structure containing information about the server 
-*			port is the port number to connect to the server 
+/**	@brief 	Asks the kernel for the path MTU to the server by connecting a throwaway socket to it.
+*	@param 	dest contains the destination IP address information. 
+*	@return returns the path MTU or DEFAULT_MTU if it cannot be found.
+*/
+int discover_Mtu(struct sockaddr_in6 *dest);
+
+/**	@brief 	Sends one request as it is, as fragments when it does not fit one datagram of the path MTU.
+*	@param 	sockFD is the socket identifier.
+*			request is the request.
+*			length is the length of the request.
 *			dest contains the destination IP address information. 
-*	@return returns nothing.
+*	@return returns 0 on success, -1 on error.
+*/
+int send_Message(int sockFD, char *request, int length, struct sockaddr_in6 *dest);
+
+/**	@brief 	Receives one reply and reassembles it when it arrives as fragments.
+*	@param 	sockFD is the socket identifier.
+*			response is the buffer the reply is copied to, it is null terminated after the reply.
+*			size is the size of the buffer.
+*	@return returns the length of the reply in bytes, -1 on error.
 */
-void setDestination(struct hostent *hostptr, int port, struct sockaddr_in *dest);
+int receive_Message(int sockFD, char *response, int size);
 
 /*
  **************************************************
@@ -72,40 +117,87 @@ int printErrorMessage( char *message ) {
   *	MODIFIED ON 2/6/2014
   *	REMOVED the connect function call
   */
-int createSocket(char * serverName, int serverPort, struct sockaddr_in * dest) {
+int createSocket(char * serverName, int serverPort, struct sockaddr_in6 * dest) {
 	int sockfd = 0;
-	struct hostent *hostptr; 
 	printf("***************************************************\n");
 	
 	//create the socket
 	sockfd = create_TCP_Socket();
 	if(sockfd == -1) return -1;
 
-	//get client host information
-	hostptr = info_Host(serverName);
-	if(hostptr == NULL) return -1;
-	
-	//set server destination
-	setDestination(hostptr, serverPort, dest);
+	//get the server destination
+	if(resolveAddress(serverName, serverPort, dest) < 0) {
+		close(sockfd);
+		return -1;
+	}
+	pathMtu = discover_Mtu(dest);
 	
 	//return the listening socket
 	return sockfd;
 }
 
+/*
+ * Looks up another server for a socket made by createSocket.
+ */
+int resolveServer(char * serverName, int serverPort, struct sockaddr_in6 * dest) {
+	int mtu;
+	if(resolveAddress(serverName, serverPort, dest) < 0) return -1;
+	mtu = discover_Mtu(dest);
+	if(mtu < pathMtu)
+		pathMtu = mtu;
+	return 0;
+}
+
+
+/*
+ * Looks up the address of a server, a name looked up in the last RESOLVE_CACHE_SEC seconds is not looked up again.
+ * The entry that expires first is replaced when the cache is full.
+ */
+int resolveAddress(char * serverName, int serverPort, struct sockaddr_in6 * dest) {
+	struct resolved_name *entry = &resolveCache[0];
+	time_t now = time(NULL);
+	int i;
+	for(i = 0; i < RESOLVE_CACHE_SIZE; i++) {
+		if(resolveCache[i].expires > now && strcmp(resolveCache[i].name, serverName) == 0) {
+			entry = &resolveCache[i];
+			break;
+		}
+		if(resolveCache[i].expires < entry->expires)
+			entry = &resolveCache[i];
+	}
+	if(i == RESOLVE_CACHE_SIZE) {
+		if(strlen(serverName) >= sizeof(entry->name) || lookup_Address(serverName, &entry->address, &entry->scope) < 0)
+			return -1;
+		strcpy(entry->name, serverName);
+		entry->expires = now + RESOLVE_CACHE_SEC;
+	}
+	memset(dest, 0, sizeof(struct sockaddr_in6));
+	dest->sin6_family = AF_INET6;
+	dest->sin6_addr = entry->address;
+	dest->sin6_scope_id = entry->scope;
+	dest->sin6_port = htons((u_short) serverPort);
+	return 0;
+}
+
 
 /*
  **************************************************
  *	MODIFIED ON 2/6/2014
  *	Changed SOCK_STREAM TO SOCK_DGRAM
+ *	MODIFIED ON 10/17/2026
+ *	The receive timeout is set with setReceiveTimeout instead of always being one second
+ *	An IPv6 socket that also reaches IPv4 servers through IPv4 mapped addresses
  **************************************************
  */
 int create_TCP_Socket(void){
-	int sockfd = socket(AF_INET, SOCK_DGRAM,0);
+	int sockfd = socket(AF_INET6, SOCK_DGRAM,0), off = 0;
 	if(sockfd == -1)
 		return printErrorMessage("Cannot Open Socket to Listen"); 
+	if( setsockopt(sockfd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off)) < 0)
+		return printErrorMessage("Cannot Set IPV6_V6ONLY for socket");
 	struct timeval tv;
-	tv.tv_sec = RECEIVE_WAIT_TIME_SEC;
-	tv.tv_usec = RECEVIE_WAIT_TIME_MIL_SEC;
+	tv.tv_sec = receiveTimeout / 1000;
+	tv.tv_usec = (receiveTimeout % 1000) * 1000;
 	//maximum wait timer
 	if( setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0)
 		return printErrorMessage("Cannot Set SO_RCVTIMEO for socket");
@@ -114,25 +206,49 @@ int create_TCP_Socket(void){
 
 /*
  **************************************************
+ *	ADDED ON 10/17/2026
+ *	Replaces gethostbyname, the first address getaddrinfo returns is used.
  **************************************************
  */
-struct hostent *info_Host(char * serverName){
-	struct hostent *hostptr; 
-	hostptr = gethostbyname(serverName);
-	if(hostptr == NULL) 
-		printErrorMessage("That Host Does Not Exist");
-	return hostptr;
+int lookup_Address(char *serverName, struct in6_addr *address, uint32_t *scope){
+	struct addrinfo hints, *result;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_flags = AI_ADDRCONFIG;
+	if(getaddrinfo(serverName, NULL, &hints, &result) != 0)
+		return printErrorMessage("That Host Does Not Exist");
+	*scope = 0;
+	if(result->ai_family == AF_INET6) {
+		*address = ((struct sockaddr_in6 *) result->ai_addr)->sin6_addr;
+		*scope = ((struct sockaddr_in6 *) result->ai_addr)->sin6_scope_id;
+	}
+	else {
+		memset(address, 0, sizeof(struct in6_addr));
+		address->s6_addr[10] = address->s6_addr[11] = 0xFF;
+		memcpy(&address->s6_addr[12], &((struct sockaddr_in *) result->ai_addr)->sin_addr, 4);
+	}
+	freeaddrinfo(result);
+	return 0;
 }
 
+
 /*
  **************************************************
  **************************************************
  */
-void setDestination(struct hostent *hostptr, int port, struct sockaddr_in *dest){
-	memset((void *) dest, 0, (size_t)sizeof(struct sockaddr_in));  
-	memcpy((void *) &(dest->sin_addr), (void *) hostptr->h_addr, hostptr->h_length);
-	dest->sin_family = (AF_INET);
-	dest->sin_port = htons((u_short) port);
+int discover_Mtu(struct sockaddr_in6 *dest){
+	int mtu = DEFAULT_MTU, sockfd = socket(AF_INET6, SOCK_DGRAM, 0);
+	socklen_t mtulen = sizeof(mtu);
+	if(sockfd == -1)
+		return DEFAULT_MTU;
+	//a mapped address is an IPv4 route, the IPv4 MTU of the connected socket is asked for
+	if(connect(sockfd, (struct sockaddr *) dest, sizeof(*dest)) == -1 
+	   || getsockopt(sockfd, IN6_IS_ADDR_V4MAPPED(&dest->sin6_addr) ? IPPROTO_IP : IPPROTO_IPV6,
+	                 IN6_IS_ADDR_V4MAPPED(&dest->sin6_addr) ? IP_MTU : IPV6_MTU, &mtu, &mtulen) == -1 || mtu < MIN_MTU)
+		mtu = DEFAULT_MTU;
+	close(sockfd);
+	return mtu > MAX_MTU ? MAX_MTU : mtu;
 }
 
 
@@ -150,14 +266,38 @@ void setDestination(struct hostent *hostptr, int port, struct sockaddr_in *dest)
   *	MODIFIED ON 2/6/2014
   *	Print out the message being sent to the server
   *	copy the request into a full length buffer - Like DR. R TCPclient.c sendRequst function 
+  *	MODIFIED ON 10/17/2026
+  *	Only the length of the request is sent, the full length buffer is kept for padded frames
+  *	Requests too large for one datagram of the path MTU are sent as fragments
+  *	The sending was split out into send_Message for binary requests
   */
-int sendRequest(int sockFD, char * request, struct sockaddr_in * dest){
+int sendRequest(int sockFD, char * request, struct sockaddr_in6 * dest){
+	printf("Sending the following message : \n%s\n", request);
+	return send_Message(sockFD, request, strnlen(request, MAX_MESSAGE_LIMIT), dest);
+}
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+int send_Message(int sockFD, char *request, int length, struct sockaddr_in6 *dest){
 	int error = 0;
 	char requestMesg[MAX_MESSAGE];
-	printf("Sending the following message : \n%s\n", request);
-	bzero(requestMesg, MAX_MESSAGE);
-	strcpy(requestMesg, request);
-	error = sendto(sockFD, requestMesg, MAX_MESSAGE, 0, (struct sockaddr *) dest, sizeof(*dest));
+	struct iovec part = { request, length };
+	static struct fragment_set fragments;
+	if(length > fragment_Payload(pathMtu)) {
+		if(split_Fragments(&fragments, &part, 1, pathMtu, nextMessageId++) == -1)
+			return printErrorMessage("Request Is Too Large");
+		error = send_Fragments(sockFD, (struct sockaddr *) dest, sizeof(*dest), &fragments);
+	}
+	else if(paddedFrames && length < MAX_MESSAGE && !is_Binary(request, length)) {
+		bzero(requestMesg, MAX_MESSAGE);
+		memcpy(requestMesg, request, length);
+		error = sendto(sockFD, requestMesg, MAX_MESSAGE, 0, (struct sockaddr *) dest, sizeof(*dest));
+	}
+	else
+		error = sendto(sockFD, request, length, 0, (struct sockaddr *) dest, sizeof(*dest));
 	if(error == -1) return printErrorMessage("Cannot Send Response to the Server");
 	return 0;
 }
@@ -174,18 +314,194 @@ int sendRequest(int sockFD, char * request, struct sockaddr_in * dest){
   *	MODIFIED ON 2/6/2014
   *	copy the reponse into a full length buffer - Like Dr. R TCPclient.c receiveResponse function
   *	Also added a time out command
+  *	MODIFIED ON 10/17/2026
+  *	Terminates the response at the received length so length exact replies work, 
+  *	a padded reply ends at its first null character
+  *	Reads into a response of MAX_MESSAGE bytes through receiveResponseSize
   */
 int receiveResponse(int sockFD, char * response){
-	int error = 0;
-	char responseMesg[MAX_MESSAGE];
-	bzero(responseMesg, MAX_MESSAGE);
-
-	error = recvfrom(sockFD, responseMesg, MAX_MESSAGE, 0, NULL, NULL);
-       	if(error == -1) return printErrorMessage("Client Received No Message from Server - Time Out Occurred");
-       	strcpy(response, responseMesg);
+	if(receiveResponseSize(sockFD, response, MAX_MESSAGE) < 0)
+		return -1;
 	return 0;
 }
 
+/*
+ * Receives the server's response into a buffer of a given size.
+ *
+ * sockfd    - the socket identifier
+ * response  - the buffer the response is written to as a null terminated string
+ * size      - the size of the buffer, a longer response is an error instead of being cut off
+ * 
+ * return   - the length of the response, or a negative number indicating the error
+ */
+int receiveResponseSize(int sockFD, char * response, int size){
+	int length = receive_Message(sockFD, response, size);
+	if(length < 0)
+		return -1;
+	//a padded reply ends at its first null character
+	return strnlen(response, length);
+}
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Split out of receiveResponseSize, the reply is copied with its exact length so binary
+ *	replies keep their null bytes.
+ **************************************************
+ */
+int receive_Message(int sockFD, char *response, int size){
+	int received = 0, length = 0, complete = 0;
+	char *message = NULL;
+	static char datagram[MAX_MTU];
+	struct sockaddr_in6 from;
+	socklen_t fromlen;
+
+	if(!reassemblyReady) {
+		init_Reassembly(&reassembly, MAX_MESSAGE_LIMIT + MAX_MESSAGE);
+		reassemblyReady = 1;
+	}
+	//keep reading fragments until one completes a response
+	while(!complete) {
+		fromlen = sizeof(from);
+		received = recvfrom(sockFD, datagram, MAX_MTU - 1, MSG_TRUNC, (struct sockaddr *) &from, &fromlen);
+		if(received == -1) return printErrorMessage("Client Received No Message from Server - Time Out Occurred");
+		if(received > MAX_MTU - 1) return printErrorMessage("Response Datagram Was Truncated");
+		if(is_Fragment(datagram, received))
+			complete = reassemble_Fragment(&reassembly, &from, datagram, received, &message, &length) == 1;
+		else {
+			length = received;
+			complete = 1;
+		}
+	}
+	if(length >= size) {
+		free(message);
+		return printErrorMessage("Response Is Larger Than The Response Buffer");
+	}
+	memcpy(response, message != NULL ? message : datagram, length);
+	response[length] = '\0';
+	free(message);
+	return length;
+}
+
+/*
+ * Translates a request written as XML into the binary form.
+ *
+ * return   - the length of the binary request, or a negative number if the request has no binary form
+ */
+int encodeBinaryRequest(char * request, uint64_t id, char * binary, int size){
+	static const struct { const char *request; int opcode; } empty[] = {
+		{ "<loadavg/>", BINARY_LOADAVG }, { "<shutdown/>", BINARY_SHUTDOWN },
+		{ "<limits/>", BINARY_LIMITS }, { "<stats/>", BINARY_STATS }
+	};
+	int length = strnlen(request, MAX_MESSAGE_LIMIT), i;
+	if(length >= 13 && !strncmp(request, "<echo>", 6) && !strcmp(request + length - 7, "</echo>")) {
+		length -= 13;
+		if(BINARY_HEADER_SIZE + length > size)
+			return -1;
+		write_Binary_Header((struct binary_header *) binary, BINARY_ECHO, 0, id, length);
+		memcpy(binary + BINARY_HEADER_SIZE, request + 6, length);
+		return BINARY_HEADER_SIZE + length;
+	}
+	if(length >= 21 && !strncmp(request, "<shutdown>", 10) && !strcmp(request + length - 11, "</shutdown>")) {
+		length -= 21; //the payload is the shutdown token
+		if(BINARY_HEADER_SIZE + length > size)
+			return -1;
+		write_Binary_Header((struct binary_header *) binary, BINARY_SHUTDOWN, 0, id, length);
+		memcpy(binary + BINARY_HEADER_SIZE, request + 10, length);
+		return BINARY_HEADER_SIZE + length;
+	}
+	for(i = 0; i < sizeof(empty) / sizeof(empty[0]); i++)
+		if(!strcmp(request, empty[i].request) && size >= BINARY_HEADER_SIZE) {
+			write_Binary_Header((struct binary_header *) binary, empty[i].opcode, 0, id, 0);
+			return BINARY_HEADER_SIZE;
+		}
+	return -1;
+}
+
+/*
+ * Sends a request for service to the server in the binary form.
+ *
+ * return   - 0, if no error; otherwise, a negative number indicating the error
+ */
+int sendBinaryRequest(int sockFD, char * request, uint64_t id, struct sockaddr_in6 * dest){
+	int length;
+	static char binary[MAX_MESSAGE_LIMIT];
+	if((length = encodeBinaryRequest(request, id, binary, sizeof(binary))) < 0)
+		return printErrorMessage("Request Has No Binary Form");
+	printf("Sending the following message as %d binary bytes : \n%s\n", length, request);
+	return send_Message(sockFD, binary, length, dest);
+}
+
+/*
+ * Writes a binary reply as the XML text string the server sends for the same request.
+ *
+ * return   - the length of the text, or a negative number if the reply is not a valid binary reply
+ */
+int formatBinaryResponse(char * message, int length, char * response, int size){
+	struct binary_header header;
+	double loadAvg[3];
+	uint64_t sampled;
+	char *payload = message + BINARY_HEADER_SIZE;
+	int written;
+
+	if(read_Binary_Header(message, length, &header) == -1 || !(header.flags & BINARY_FLAG_REPLY))
+		return -1;
+	if(header.flags & BINARY_FLAG_ERROR)
+		written = snprintf(response, size, "<error>%.*s</error>", (int) header.length, payload);
+	else if(header.flags & BINARY_FLAG_TEXT)
+		written = snprintf(response, size, "%.*s", (int) header.length, payload);
+	else if(header.opcode == BINARY_ECHO)
+		written = snprintf(response, size, "<reply>%.*s</reply>", (int) header.length, payload);
+	else if(header.opcode == BINARY_LOADAVG && read_Binary_Loadavg(payload, header.length, loadAvg, &sampled) == 0)
+		written = snprintf(response, size, "<replyLoadAvg sampled=\"%llu\">%f:%f:%f</replyLoadAvg>",
+		                   (unsigned long long) sampled, loadAvg[0], loadAvg[1], loadAvg[2]);
+	else
+		return -1;
+	return written < size ? written : -1;
+}
+
+/*
+ * Receives a binary reply from the server and writes it as text.
+ *
+ * return   - the length of the response, or a negative number indicating the error
+ */
+int receiveBinaryResponse(int sockFD, char * response, int size){
+	int length;
+	static char binary[MAX_MESSAGE_LIMIT + MAX_MESSAGE];
+	if((length = receive_Message(sockFD, binary, sizeof(binary))) < 0)
+		return -1;
+	if((length = formatBinaryResponse(binary, length, response, size)) < 0)
+		return printErrorMessage("Response Is Not a Valid Binary Reply");
+	return length;
+}
+
+/*
+ * Chooses how requests are framed.
+ *
+ * padded - 1 to send padded frames, 0 to send length exact frames
+ */
+void setPaddedFrames(int padded){
+	paddedFrames = padded;
+}
+
+/*
+ * Sets how long a receive waits for a response.
+ *
+ * milSec - the milli seconds to wait
+ */
+void setReceiveTimeout(int milSec){
+	receiveTimeout = milSec < 1 ? 1 : milSec;
+}
+
+/*
+ * Gets the path MTU to the server that createSocket found.
+ *
+ * return - the path MTU
+ */
+int getPathMtu(void){
+	return pathMtu;
+}
+
 /*
  * Prints the response to the screen in a formatted way.
  *
@@ -11,9 +11,12 @@
  * This file describes the functions to be implemented by the UDPclient.
  * You may also implement any auxillary functions you deem necessary.
  */
- 
- 
- 
+
+#ifndef UDPCLIENT_H
+#define UDPCLIENT_H
+
+#include "UDPfragment.h"	//first, it turns on the GNU extensions the system headers need for sendmmsg
+#include "UDPbinary.h"
 #include <stdio.h>
 #include <unistd.h>
 #include <netdb.h>
@@ -25,6 +28,7 @@
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <stdlib.h>
+#include <time.h>
 
 /*
  **************************************************
@@ -33,9 +37,29 @@
  */
 
 #define MAX_MESSAGE 256
+#define MAX_REPLY 1024		//the longest formatted reply of the server, <stats/> with every counter at its widest
 #define RECEIVE_WAIT_TIME_SEC 1
 #define RECEVIE_WAIT_TIME_MIL_SEC 0
+#define RECEIVE_WAIT_TIME (RECEIVE_WAIT_TIME_SEC * 1000 + RECEVIE_WAIT_TIME_MIL_SEC)	//milli seconds
+#define RESOLVE_CACHE_SIZE 16
+#define RESOLVE_CACHE_SEC 60		//how long a looked up address is used before it is looked up again
 
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+/*
+ * A server name and the address it was looked up to, every address is kept as an IPv6 address
+ * and IPv4 addresses are IPv4 mapped.
+ */
+struct resolved_name {
+	char name[NI_MAXHOST];
+	struct in6_addr address;
+	uint32_t scope;
+	time_t expires;
+};
 
  /*
  **************************************************
@@ -54,7 +78,31 @@
  *
  * return value - the socket identifier or a negative number indicating the error if a connection could not be established
  */
-int createSocket(char * serverName, int serverPort, struct sockaddr_in * dest);
+int createSocket(char * serverName, int serverPort, struct sockaddr_in6 * dest);
+
+/*
+ * Looks up another server for a socket made by createSocket. The path MTU is lowered
+ * when the path to this server has a smaller one, so a request fits on every path.
+ *
+ * serverName - the ip address or hostname of the server given as a string
+ * serverPort - the port number of the server
+ * dest       - filled in with the server's address information
+ *
+ * return value - 0, or a negative number if the server could not be found
+ */
+int resolveServer(char * serverName, int serverPort, struct sockaddr_in6 * dest);
+
+/*
+ * Looks up the address of a server with getaddrinfo. Names are cached for RESOLVE_CACHE_SEC
+ * seconds so requests to the same server do not wait on DNS every time.
+ *
+ * serverName - the ip address, IPv4 or IPv6, or hostname of the server given as a string
+ * serverPort - the port number of the server
+ * dest       - filled in with the server's address, an IPv4 server gets an IPv4 mapped address
+ *
+ * return value - 0, or a negative number if the server could not be found
+ */
+int resolveAddress(char * serverName, int serverPort, struct sockaddr_in6 * dest);
 
 /*
  * Sends a request for service to the server. This is an asynchronous call to the server, 
@@ -66,7 +114,7 @@ int createSocket(char * serverName, int serverPort, struct sockaddr_in * dest);
  *
  * return   - 0, if no error; otherwise, a negative number indicating the error
  */
-int sendRequest(int sockFD, char * request, struct sockaddr_in * dest);
+int sendRequest(int sockFD, char * request, struct sockaddr_in6 * dest);
 
 /*
  * Receives the server's response formatted as an XML text string.
@@ -78,6 +126,68 @@ int sendRequest(int sockFD, char * request, struct sockaddr_in * dest);
  */
 int receiveResponse(int sockFD, char * response);
 
+/*
+ * Receives the server's response into a buffer of a given size. Responses larger than one 
+ * datagram arrive as fragments and are reassembled before they are returned.
+ *
+ * sockfd    - the socket identifier
+ * response  - the buffer the response is written to as a null terminated string
+ * size      - the size of the buffer, a longer response is an error instead of being cut off
+ * 
+ * return   - the length of the response, or a negative number indicating the error
+ */
+int receiveResponseSize(int sockFD, char * response, int size);
+
+/*
+ * Translates a request written as XML into the binary form of UDPbinary.h. 
+ * <echo>text</echo>, <loadavg/>, <shutdown/> or <shutdown>token</shutdown>, <limits/> and <stats/> have a binary form.
+ *
+ * request - the request encoded as a string
+ * id      - the request ID the server returns in its reply
+ * binary  - the buffer the binary request is written to
+ * size    - the size of the buffer
+ *
+ * return   - the length of the binary request, or a negative number if the request has no binary form
+ */
+int encodeBinaryRequest(char * request, uint64_t id, char * binary, int size);
+
+/*
+ * Sends a request for service to the server in the binary form. Like sendRequest it does not 
+ * wait for a reply.
+ * 
+ * sockFD  - the socket identifier
+ * request - the request encoded as a string, translated by encodeBinaryRequest
+ * id      - the request ID the server returns in its reply
+ * dest    - the server's address information
+ *
+ * return   - 0, if no error; otherwise, a negative number indicating the error
+ */
+int sendBinaryRequest(int sockFD, char * request, uint64_t id, struct sockaddr_in6 * dest);
+
+/*
+ * Writes a binary reply as the XML text string the server sends for the same request, so
+ * binary replies can be printed and compared with text replies.
+ *
+ * message  - the binary reply starting with its header
+ * length   - the length of the binary reply
+ * response - the buffer the text is written to as a null terminated string
+ * size     - the size of the buffer
+ *
+ * return   - the length of the text, or a negative number if the reply is not a valid binary reply
+ */
+int formatBinaryResponse(char * message, int length, char * response, int size);
+
+/*
+ * Receives a binary reply from the server and writes it as text with formatBinaryResponse.
+ *
+ * sockfd    - the socket identifier
+ * response  - the buffer the response is written to as a null terminated string
+ * size      - the size of the buffer
+ * 
+ * return   - the length of the response, or a negative number indicating the error
+ */
+int receiveBinaryResponse(int sockFD, char * response, int size);
+
 /*
  * Prints the response to the screen in a formatted way.
  *
@@ -86,6 +196,30 @@ int receiveResponse(int sockFD, char * response);
  */
 void printResponse(char * response);
 
+/*
+ * Chooses how requests are framed. By default only the bytes of the request are sent,
+ * padded frames send every request as a MAX_MESSAGE byte datagram filled with null characters
+ * for servers that still expect the old fixed frame size. Replies are accepted in both forms.
+ *
+ * padded - 1 to send padded frames, 0 to send length exact frames
+ */
+void setPaddedFrames(int padded);
+
+/*
+ * Sets how long receiveResponse waits for a response on the sockets made by createSocket 
+ * afterwards, RECEIVE_WAIT_TIME milli seconds unless it is changed.
+ *
+ * milSec - the milli seconds to wait, at least 1
+ */
+void setReceiveTimeout(int milSec);
+
+/*
+ * Gets the path MTU to the server that createSocket found.
+ *
+ * return - the path MTU, DEFAULT_MTU before createSocket is called or when it could not be found
+ */
+int getPathMtu(void);
+
 /*
  * Closes the specified socket
  *
@@ -95,3 +229,4 @@ void printResponse(char * response);
  */
 int closeSocket(int sockFD);
 
+#endif
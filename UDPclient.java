@@ -4,6 +4,9 @@ import java.net.InetAddress;
 import java.net.SocketException;
 import java.net.SocketTimeoutException;
 import java.net.UnknownHostException;
+import java.nio.BufferUnderflowException;
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
 import java.util.StringTokenizer;
 
 /*
@@ -20,12 +23,30 @@ public class UDPclient {
 	private int servPort;
 	// Constants
 	private static final int BUFFSIZE =256; //
+	private static final int MAX_DATAGRAM = 65536; //replies are as long as their text, not BUFFSIZE
 	private static final int ERROR = -1;
 	private static final int SUCCESS = 0;
 	private static final int MILISEC_TIMEOUT = 500;//half second
 	//Message handling
 	private String request;
 	private String response;
+	private boolean paddedFrames = false; //send every request as a null padded BUFFSIZE frame
+	private boolean binaryFrames = false; //send requests in the binary form of UDPbinary.h
+	private long nextId = 1;
+	private final byte[] recvBuff = new byte[MAX_DATAGRAM]; //allocated once and reused for every reply
+	// Binary form, the same values as UDPbinary.h
+	private static final int BINARY_MAGIC = 0xBA;
+	private static final int BINARY_HEADER_SIZE = 16;
+	private static final int BINARY_ECHO = 1;
+	private static final int BINARY_LOADAVG = 2;
+	private static final int BINARY_SHUTDOWN = 3;
+	private static final int BINARY_LIMITS = 4;
+	private static final int BINARY_STATS = 5;
+	private static final int BINARY_FLAG_REPLY = 0x1;
+	private static final int BINARY_FLAG_ERROR = 0x2;
+	private static final int BINARY_FLAG_TEXT = 0x4;
+	private static final int BINARY_LOADAVG_SIZE = 20;
+	private static final double BINARY_LOADAVG_SCALE = 65536.0;
 
 	/**
 	 * Constructs a TCPclient object.
@@ -69,7 +90,6 @@ public class UDPclient {
 	 */
 	public int sendRequest(String request, String hostAddr, int port) {
 		this.request = request;
-		this.request += '\u0000';
 		//Check request string for errors in the client?????
 		servPort = port;
 		if(!doServAddr(hostAddr)){
@@ -101,16 +121,125 @@ public class UDPclient {
 		return true;
 	}
 	
+	/**
+	 * Chooses how requests are framed. By default only the bytes of the request are sent,
+	 * padded frames send every request as a BUFFSIZE datagram filled with null characters
+	 * for servers that still expect the old fixed frame size. Replies are accepted in both forms.
+	 * @param padded true to send padded frames, false to send length exact frames
+	 */
+	public void setPaddedFrames(boolean padded) {
+		paddedFrames = padded;
+	}
+
+	/**
+	 * Chooses the binary form of the requests. The request is still written as XML and
+	 * translated, the binary reply is turned back into the text reply of the server.
+	 * @param binary true to send binary requests, false to send text requests
+	 */
+	public void setBinaryFrames(boolean binary) {
+		binaryFrames = binary;
+	}
+
+	/**
+	 * Translates a request written as XML into the binary form, a 16 byte header in network
+	 * byte order followed by the payload.
+	 * @param request the request, <echo>text</echo>, <loadavg/>, <shutdown/>, <limits/> or <stats/>
+	 * @param id the request ID the server returns in its reply
+	 * @return the binary request or null if the request has no binary form
+	 */
+	public static byte[] encodeBinaryRequest(String request, long id) {
+		int opcode;
+		byte[] payload = new byte[0];
+		if(request.startsWith("<echo>") && request.endsWith("</echo>") && request.length() >= 13) {
+			opcode = BINARY_ECHO;
+			payload = request.substring(6, request.length() - 7).getBytes(StandardCharsets.UTF_8);
+		} else if(request.equals("<loadavg/>")) {
+			opcode = BINARY_LOADAVG;
+		} else if(request.equals("<shutdown/>")) {
+			opcode = BINARY_SHUTDOWN;
+		} else if(request.startsWith("<shutdown>") && request.endsWith("</shutdown>") && request.length() >= 21) {
+			//the payload is the shutdown token
+			opcode = BINARY_SHUTDOWN;
+			payload = request.substring(10, request.length() - 11).getBytes(StandardCharsets.UTF_8);
+		} else if(request.equals("<limits/>")) {
+			opcode = BINARY_LIMITS;
+		} else if(request.equals("<stats/>")) {
+			opcode = BINARY_STATS;
+		} else {
+			return null;
+		}
+		//ByteBuffer writes in network byte order unless told otherwise
+		ByteBuffer frame = ByteBuffer.allocate(BINARY_HEADER_SIZE + payload.length);
+		frame.put((byte) BINARY_MAGIC).put((byte) opcode).putShort((short) 0).putInt(payload.length).putLong(id);
+		frame.put(payload);
+		return frame.array();
+	}
+
+	/**
+	 * Writes a binary reply as the XML text string the server sends for the same request.
+	 * @param reply the received datagram
+	 * @param length the number of bytes received
+	 * @return the text reply or null if the datagram is not a valid binary reply
+	 */
+	public static String formatBinaryResponse(byte[] reply, int length) {
+		if(length < BINARY_HEADER_SIZE || (reply[0] & 0xFF) != BINARY_MAGIC) {
+			return null;
+		}
+		try {
+			ByteBuffer frame = ByteBuffer.wrap(reply, 0, length);
+			frame.get();
+			int opcode = frame.get() & 0xFF;
+			int flags = frame.getShort() & 0xFFFF;
+			int payloadLength = frame.getInt();
+			frame.getLong();
+			if(payloadLength != length - BINARY_HEADER_SIZE || (flags & BINARY_FLAG_REPLY) == 0) {
+				return null;
+			}
+			String text = new String(reply, BINARY_HEADER_SIZE, payloadLength, StandardCharsets.UTF_8);
+			if((flags & BINARY_FLAG_ERROR) != 0) {
+				return "<error>" + text + "</error>";
+			} else if((flags & BINARY_FLAG_TEXT) != 0) {
+				return text;
+			} else if(opcode == BINARY_ECHO) {
+				return "<reply>" + text + "</reply>";
+			} else if(opcode == BINARY_LOADAVG && payloadLength == BINARY_LOADAVG_SIZE) {
+				double one = (frame.getInt() & 0xFFFFFFFFL) / BINARY_LOADAVG_SCALE;
+				double five = (frame.getInt() & 0xFFFFFFFFL) / BINARY_LOADAVG_SCALE;
+				double fifteen = (frame.getInt() & 0xFFFFFFFFL) / BINARY_LOADAVG_SCALE;
+				long sampled = frame.getLong();
+				return String.format("<replyLoadAvg sampled=\"%d\">%f:%f:%f</replyLoadAvg>", sampled, one, five, fifteen);
+			}
+		} catch(BufferUnderflowException ex) {
+			return null;
+		}
+		return null;
+	}
+
 	/**
 	 * this method does the actual sending of the request message
 	 * @return true is no error, otherwise returns false
 	 */
 	private boolean doSendRequest(){
 		try{
-			//TODO
-			byte[] sendBuff = new byte[BUFFSIZE];
-			sendBuff = request.getBytes();
-			DatagramPacket sendPacket = new DatagramPacket(sendBuff, sendBuff.length, servAddr, servPort);
+			byte[] sendBuff = request.getBytes();
+			int length = sendBuff.length;
+			if(binaryFrames) {
+				sendBuff = encodeBinaryRequest(request, nextId++);
+				if(sendBuff == null) {
+					System.err.println("Request has no binary form");
+					closeSocket();
+					return false;
+				}
+				length = sendBuff.length;
+			} else if(paddedFrames) {
+				//copy into a full length buffer, the unused bytes stay null
+				byte[] frame = new byte[BUFFSIZE];
+				length = Math.min(sendBuff.length, BUFFSIZE - 1);
+				System.arraycopy(sendBuff, 0, frame, 0, length);
+				sendBuff = frame;
+				length = BUFFSIZE;
+			}
+			DatagramPacket sendPacket = new DatagramPacket(sendBuff, length, servAddr, servPort);
 			_socket.send(sendPacket);
 		}catch(Exception ex){
 			//TODO the book has a different error message than the one i put here
@@ -129,16 +258,17 @@ public class UDPclient {
 	 * @return - the server's response or NULL if an error occured
 	 */
 	public String receiveResponse() {
-	    byte[] recvBuff = new byte[BUFFSIZE];
+	    int length;
 		try{
 			
-			DatagramPacket recvPacket = new DatagramPacket(recvBuff, BUFFSIZE);
+			DatagramPacket recvPacket = new DatagramPacket(recvBuff, recvBuff.length);
 			try{
 			_socket.receive(recvPacket);
 			}catch(SocketTimeoutException ex){
 			        closeSocket();
 				return response = "Server not responding";
 			}
+			length = recvPacket.getLength();
 		}catch (Exception ex){
 			//TODO the book has a different error message than the one i put here
 			//I am not quite sure what they meant by it
@@ -147,7 +277,21 @@ public class UDPclient {
 			closeSocket();
 			return null;
 		}
-		response = new String(recvBuff);
+		if(binaryFrames) {
+			response = formatBinaryResponse(recvBuff, length);
+			if(response == null) {
+				System.err.println("Response is not a valid binary reply");
+			}
+			return response;
+		}
+		//only the received bytes belong to the reply, a padded reply ends at its first null character
+		for(int i = 0; i < length; i++) {
+			if(recvBuff[i] == 0) {
+				length = i;
+				break;
+			}
+		}
+		response = new String(recvBuff, 0, length);
 		return response;
 	}
 
@@ -159,7 +303,7 @@ public class UDPclient {
 	public static void printResponse(String response) {
 		if(response.contains("<reply>")) {
 			System.out.println("Reply: " + response);
-		} else if(response.contains("<replyLoadAvg>")) {
+		} else if(response.contains("<replyLoadAvg")) {
 			System.out.println("LoadAvg: " + response);
 		} else if(response.contains("<replyShutDown>")) {
 			System.out.println("ShutDown: " + response);
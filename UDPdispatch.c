@@ -0,0 +1,227 @@
+/**	@file UDPdispatch.c
+ * 	@brief Contains the function implementations of the command dispatcher.
+ *	The tag name of a message is read once, lower cased and hashed on the way, and the hash
+ *	picks the only command it can be. Registering more commands does not make a request slower.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPdispatch.h"
+#include <ctype.h>
+
+/*
+ **************************************************
+ *		DISPATCH TABLE
+ **************************************************
+ */
+
+static struct command commands[COMMAND_SLOTS];
+static struct command *opcodes[COMMAND_OPCODES];	//the commands again by opcode for binary requests
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Reads, lower cases and hashes the tag name at the start of a message and finds its command.
+*	@param 	message is the message, it starts with the opening tag.
+*			length is the length of the message.
+*			nameEnd is set to the index of the first byte after the tag name.
+*	@return returns the command or NULL if the tag names no registered command.
+*/
+struct command *find_Command(const char *message, int length, int *nameEnd);
+
+/*
+ **************************************************
+ *		DISPATCH FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ *	MODIFIED ON 10/17/2026
+ *	Returns -1 instead of stopping the server
+ **************************************************
+ */
+int register_Command(const char *name, int form, int opcode, command_handler handler){
+  uint32_t hash = COMMAND_HASH_BASIS;
+  int i, nameLength = strlen(name);
+  struct command *slot;
+  if(nameLength == 0 || nameLength >= MAX_COMMAND_NAME)
+	return printErrorMessage("Command Name Is Too Long");
+  for(i = 0; i < nameLength; i++)
+    hash = (hash ^ (uint8_t) tolower((unsigned char) name[i])) * COMMAND_HASH_PRIME;
+  slot = &commands[hash & (COMMAND_SLOTS - 1)];
+  if(slot->handler != NULL)
+	return printErrorMessage("Command Hash Collision, Change COMMAND_SLOTS");
+  for(i = 0; i < nameLength; i++)
+    slot->name[i] = tolower((unsigned char) name[i]);
+  slot->nameLength = nameLength;
+  slot->form = form;
+  slot->opcode = opcode;
+  slot->handler = handler;
+  if(opcode >= 0 && opcode < COMMAND_OPCODES)
+    opcodes[opcode] = slot;
+  return 0;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+int register_Binary(const char *name, command_handler handler){
+  int opcode = command_Opcode(name);
+  if(opcode < 0 || opcode >= COMMAND_OPCODES)
+	return printErrorMessage("Binary Handler For a Command That Is Not Registered");
+  opcodes[opcode]->binary = handler;
+  return 0;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The opcode is the index of the command, a binary request is never parsed.
+ **************************************************
+ */
+int dispatch_Binary(struct server_worker *worker, int opcode, char *body, int bodyLength,
+                    struct message_reply *reply, int *text){
+  struct command *command;
+  struct command_request request = { worker, body, bodyLength, body, bodyLength };
+  if(opcode < 0 || opcode >= COMMAND_OPCODES || (command = opcodes[opcode]) == NULL)
+    return -1;
+  *text = command->binary == NULL;
+  if(*text)
+    command->handler(&request, reply);
+  else
+    command->binary(&request, reply);
+  return command->opcode;
+}
+
+
+/*
+ **************************************************
+ *	The opening tag is scanned once, the only other bytes looked at are the closing tag
+ *	of a container command, compared in place at the end of the message.
+ **************************************************
+ */
+int dispatch_Message(struct server_worker *worker, char *message, int length, struct message_reply *reply){
+  int i, nameLength, end;
+  struct command *command;
+  struct command_request request;
+  
+  //a message that ends with the tag name has no form to check
+  if((command = find_Command(message, length, &i)) == NULL || i == length)
+    return -1;
+  nameLength = i - 1;
+  
+  request.worker = worker;
+  request.message = message;
+  request.length = length;
+  if(command->form == COMMAND_EMPTY || (command->form == COMMAND_EITHER && message[i] == '/')) {
+    //<name/> and nothing after it
+    if(length != i + 2 || message[i] != '/' || message[i + 1] != '>')
+      return -1;
+    request.body = message + length;
+    request.bodyLength = 0;
+  }
+  else {
+    //<name>body</name>, the closing tag is checked by its position from the end
+    end = length - (nameLength + 3);
+    if(message[i] != '>' || end < i + 1 || message[end] != '<' || message[end + 1] != '/' 
+       || message[length - 1] != '>' || strncasecmp(message + end + 2, command->name, nameLength))
+      return -1;
+    request.body = message + i + 1;
+    request.bodyLength = end - (i + 1);
+  }
+  command->handler(&request, reply);
+  return command->opcode;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Only the tag name is read, whether the rest of the message is well formed is left to the handler.
+ **************************************************
+ */
+int request_Opcode(const char *message, int length){
+  struct binary_header header;
+  struct command *command;
+  int nameEnd, tagLength;
+  if(is_Binary(message, length)) {
+    if(read_Binary_Header(message, length, &header) == -1 || header.opcode >= COMMAND_OPCODES || opcodes[header.opcode] == NULL)
+      return OPCODE_ERROR;
+    return opcodes[header.opcode]->opcode;
+  }
+  tagLength = correlation_Length(message, length);
+  command = find_Command(message + tagLength, length - tagLength, &nameEnd);
+  return command != NULL ? command->opcode : OPCODE_ERROR;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Split out of dispatch_Message, the tag name is read, lower cased and hashed in one pass.
+ **************************************************
+ */
+struct command *find_Command(const char *message, int length, int *nameEnd){
+  uint32_t hash = COMMAND_HASH_BASIS;
+  char name[MAX_COMMAND_NAME];
+  int i, nameLength;
+  struct command *command;
+  
+  if(length < 3 || message[0] != '<')
+    return NULL;
+  for(i = 1; i < length && (uint8_t) ((message[i] | 0x20) - 'a') < 26; i++) {
+    if(i > MAX_COMMAND_NAME)
+      return NULL;
+    name[i - 1] = message[i] | 0x20;
+    hash = (hash ^ (uint8_t) name[i - 1]) * COMMAND_HASH_PRIME;
+  }
+  nameLength = i - 1;
+  command = &commands[hash & (COMMAND_SLOTS - 1)];
+  if(command->handler == NULL || command->nameLength != nameLength || memcmp(command->name, name, nameLength))
+    return NULL;
+  *nameEnd = i;
+  return command;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+int command_Opcode(const char *name){
+  uint32_t hash = COMMAND_HASH_BASIS;
+  int i, nameLength = strlen(name);
+  struct command *command;
+  if(nameLength == 0 || nameLength >= MAX_COMMAND_NAME)
+    return -1;
+  for(i = 0; i < nameLength; i++)
+    hash = (hash ^ (uint8_t) tolower((unsigned char) name[i])) * COMMAND_HASH_PRIME;
+  command = &commands[hash & (COMMAND_SLOTS - 1)];
+  if(command->handler == NULL || command->nameLength != nameLength || strncasecmp(command->name, name, nameLength))
+    return -1;
+  return command->opcode;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	MODIFIED ON 10/17/2026
+ *	Looked up by opcode instead of scanning the table, the log thread names every request it writes
+ **************************************************
+ */
+const char *command_Name(int opcode){
+  if(opcode < 0 || opcode >= COMMAND_OPCODES || opcodes[opcode] == NULL)
+    return NULL;
+  return opcodes[opcode]->name;
+}
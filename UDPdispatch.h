@@ -0,0 +1,130 @@
+/**	@file UDPdispatch.h
+ * 	@brief Contains the function prototypes for the command dispatcher of the UDP server
+ *	that are implemented in UDPdispatch.c
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPDISPATCH_H
+#define UDPDISPATCH_H
+
+#include "UDPserver.h"
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define COMMAND_SLOTS 64	//size of the hash table, must be a power of two
+#define MAX_COMMAND_NAME 16
+#define COMMAND_EMPTY 0		//<name/>
+#define COMMAND_CONTAINER 1	//<name>body</name>
+#define COMMAND_EITHER 2	//<name/> or <name>body</name>
+#define COMMAND_HASH_BASIS 2166136261u
+#define COMMAND_HASH_PRIME 16777619u
+#define COMMAND_OPCODES 32	//opcodes a binary request can name
+
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+/**	@brief 	A parsed request handed to a command handler. body is the text between the 
+*			opening and closing tag of a container command, it points into message.
+*/
+struct command_request {
+  struct server_worker *worker;
+  char *message;
+  int length;
+  char *body;
+  int bodyLength;
+};
+
+/**	@brief 	Builds the reply to a command.
+*/
+typedef void (*command_handler)(struct command_request *request, struct message_reply *reply);
+
+/**	@brief 	One registered command. name is stored in lower case.
+*			binary builds the reply to the binary form of the command, NULL when the command
+*			answers binary requests with its text reply.
+*/
+struct command {
+  char name[MAX_COMMAND_NAME];
+  int nameLength;
+  int form;
+  int opcode;
+  command_handler handler;
+  command_handler binary;
+};
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Adds a command to the dispatch table. Commands are registered before the server
+*			loops start, the table is only read afterwards. The table is a perfect hash of the
+*			registered names, so a name that hashes to a slot already in use is an error.
+*	@param 	name is the tag name without brackets, matched without regard to case.
+*			form is COMMAND_EMPTY for <name/>, COMMAND_CONTAINER for <name>body</name> or COMMAND_EITHER for both.
+*			opcode is the message_opcode reported for the command.
+*			handler builds the reply.
+*	@return returns 0 on success, -1 if the name is too long or its slot is taken.
+*/
+int register_Command(const char *name, int form, int opcode, command_handler handler);
+
+/**	@brief 	Parses the tag of a message in one pass and runs the handler registered for it.
+*	@param 	worker is the server loop that received the message.
+*			message is the message, null terminated.
+*			length is the length of the message.
+*			reply is the reply the handler builds.
+*	@return returns the opcode of the command or -1 if the message is not a registered command
+*			in the right form, in which case no reply was built.
+*/
+int dispatch_Message(struct server_worker *worker, char *message, int length, struct message_reply *reply);
+
+/**	@brief 	Finds the command a message names without running its handler, so the request can be
+*			rate limited before any work is done for it.
+*	@param 	message is the text or binary message, null terminated.
+*			length is the length of the message.
+*	@return returns the opcode of the command the tag name or binary opcode names, OPCODE_ERROR if none.
+*/
+int request_Opcode(const char *message, int length);
+
+/**	@brief 	Adds the handler of the binary form of a registered command, its reply is the payload
+*			that follows the binary header.
+*	@param 	name is the name the command was registered with.
+*			handler builds the binary reply.
+*	@return returns 0 on success, -1 if the command is not registered.
+*/
+int register_Binary(const char *name, command_handler handler);
+
+/**	@brief 	Runs the handler of the command a binary request names by its opcode.
+*	@param 	worker is the server loop that received the message.
+*			opcode is the opcode of the binary header.
+*			body is the payload of the request.
+*			bodyLength is the length of the payload.
+*			reply is the reply the handler builds.
+*			text is set to 1 when the command has no binary handler and replied with its text reply.
+*	@return returns the opcode or -1 if no command has that opcode, in which case no reply was built.
+*/
+int dispatch_Binary(struct server_worker *worker, int opcode, char *body, int bodyLength,
+                    struct message_reply *reply, int *text);
+
+/**	@brief 	Looks up the opcode of a registered command by its name.
+*	@param 	name is the tag name without brackets, matched without regard to case.
+*	@return returns the opcode of the command or -1 if no command has that name.
+*/
+int command_Opcode(const char *name);
+
+/**	@brief 	Looks up the name of the command registered for an opcode.
+*	@param 	opcode is the message_opcode of the command.
+*	@return returns the name or NULL if no command has that opcode.
+*/
+const char *command_Name(int opcode);
+
+#endif
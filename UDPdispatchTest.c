@@ -0,0 +1,321 @@
+/**	@file	UDPdispatchTest.c
+ * 	@brief	Contains a fuzz test and a microbenchmark of the command dispatcher.
+ *	The fuzz test parses random and mutated messages that end right before an unmapped page, so
+ *	a read past the end of a message faults, and checks that every message the dispatcher accepts
+ *	is a registered command in its registered form with the body it reported.
+ *	The benchmark times dispatch_Message on the messages the server sees most.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPserver.h"
+#include "UDPdispatch.h"
+#include <sys/mman.h>
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define FUZZ_MAX_LENGTH 64		//longest message the fuzz test builds
+#define FUZZ_MAX_MUTATIONS 4
+#define DEFAULT_FUZZ_SEED 1
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Prints how the test program should be started.
+*	@param 	no parameter is passed.
+*	@return returns nothing.
+*/
+void printUsage(void);
+
+/**	@brief 	Registers the commands of the server, in their forms, with a handler that only records the body.
+*	@param 	no parameter is passed.
+*	@return returns 0 on success, -1 if a command cannot be registered.
+*/
+int register_Test_Commands(void);
+
+/**	@brief 	The handler of every test command, keeps the body the dispatcher found.
+*	@param 	request is the parsed request.
+*			reply is not used.
+*	@return returns nothing.
+*/
+void record_Body(struct command_request *request, struct message_reply *reply);
+
+/**	@brief 	Parses random and mutated messages and checks what the dispatcher accepts.
+*	@param 	messages is the number of messages to parse.
+*			seed starts the random numbers, the same seed parses the same messages.
+*	@return returns 0 when every message was handled right, -1 on the first that was not.
+*/
+int run_Fuzz(long messages, uint64_t seed);
+
+/**	@brief 	Checks a message the dispatcher accepted against the name and form of its command.
+*	@param 	message is the message.
+*			length is the length of the message.
+*			opcode is the opcode dispatch_Message returned.
+*	@return returns 0 if the message is the command in its form with the recorded body, -1 if not.
+*/
+int check_Accepted(const char *message, int length, int opcode);
+
+/**	@brief 	Times dispatch_Message on a few typical messages and prints the nano seconds per message.
+*	@param 	iterations is how often each message is parsed.
+*	@return returns nothing.
+*/
+void run_Dispatch_Bench(long iterations);
+
+/**	@brief 	Next number of a xorshift generator.
+*	@param 	state is the state of the generator, not 0.
+*	@return returns the number.
+*/
+uint64_t next_Random(uint64_t *state);
+
+/**	@brief 	Current CLOCK_MONOTONIC time.
+*	@param 	no parameter is passed.
+*	@return returns the time in nano seconds.
+*/
+uint64_t test_Clock(void);
+
+/*
+ **************************************************
+ *		TEST STATE
+ **************************************************
+ */
+
+static const char *bodyFound;
+static int bodyLengthFound;
+
+static const char *seeds[] = {
+  "<echo>hello</echo>", "<ECHO>Hello World</eChO>", "<echo></echo>", "<echo><echo>x</echo></echo>",
+  "<loadavg/>", "<LoadAvg/>", "<shutdown/>", "<shutdown>now</shutdown>", "<limits/>", "<stats/>",
+  "<trace/>", "<echo", "<echo>", "<echo/>", "<shutdown", "<loadavg", "<", "<a/>", "<nothing/>",
+  "</echo>", "<echo>x</echoo>", "<echoo>x</echo>", "#id <echo>x</echo>"
+};
+
+/*
+ **************************************************
+ *		TEST FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+int main(int argc, char **argv){
+  int option;
+  long messages = 0, iterations = 0;
+  uint64_t seed = DEFAULT_FUZZ_SEED;
+
+  //-f <Messages> runs the fuzz test, -s <Seed> picks its messages, -b <Iterations> runs the benchmark
+  while((option = getopt(argc, argv, "f:s:b:")) != -1) {
+    if(option == 'f' && (messages = strtol(optarg, NULL, 10)) > 0)
+      continue;
+    else if(option == 's' && (seed = strtoull(optarg, NULL, 10)) > 0)
+      continue;
+    else if(option == 'b' && (iterations = strtol(optarg, NULL, 10)) > 0)
+      continue;
+    printUsage();
+    return 1;
+  }
+  if(optind != argc || (messages == 0 && iterations == 0)) {
+    printUsage();
+    return 1;
+  }
+  if(register_Test_Commands() == -1)
+    return 1;
+  if(messages > 0 && run_Fuzz(messages, seed) == -1)
+    return 1;
+  if(iterations > 0)
+    run_Dispatch_Bench(iterations);
+  return 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void printUsage(void){
+  fprintf(stderr, "Usage: dispatch_test [-f <Messages>] [-s <Seed>] [-b <Iterations>]\n");
+  fprintf(stderr, "  -f  parses that many random and mutated messages and checks every accepted one\n");
+  fprintf(stderr, "  -s  seed of the random messages, default %d\n", DEFAULT_FUZZ_SEED);
+  fprintf(stderr, "  -b  times the dispatcher parsing each benchmark message that many times\n");
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The forms match register_Commands, the server handlers need a running server.
+ **************************************************
+ */
+int register_Test_Commands(void){
+  if(register_Command("echo", COMMAND_CONTAINER, OPCODE_ECHO, record_Body) == -1
+     || register_Command("loadavg", COMMAND_EMPTY, OPCODE_LOADAVG, record_Body) == -1
+     || register_Command("shutdown", COMMAND_EITHER, OPCODE_SHUTDOWN, record_Body) == -1
+     || register_Command("limits", COMMAND_EMPTY, OPCODE_LIMITS, record_Body) == -1
+     || register_Command("stats", COMMAND_EMPTY, OPCODE_STATS, record_Body) == -1
+     || register_Command("trace", COMMAND_EMPTY, OPCODE_TRACE, record_Body) == -1)
+    return -1;
+  return 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void record_Body(struct command_request *request, struct message_reply *reply){
+  bodyFound = request->body;
+  bodyLengthFound = request->bodyLength;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	A message is a seed cut, overwritten, extended or spliced a few times. It is copied to the end
+ *	of a page with no terminating null character in front of a page that is not mapped.
+ **************************************************
+ */
+int run_Fuzz(long messages, uint64_t seed){
+  long page = sysconf(_SC_PAGESIZE), n;
+  char *memory, *message, built[2 * FUZZ_MAX_LENGTH];
+  const char *from;
+  int length, mutations, i, at, opcode, accepted = 0;
+  uint64_t state = seed;
+  struct message_reply reply;
+
+  memory = mmap(NULL, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(memory == MAP_FAILED || mprotect(memory + page, page, PROT_NONE) == -1)
+    return printErrorMessage("Cannot Map The Guard Page");
+  for(n = 0; n < messages; n++) {
+    from = seeds[next_Random(&state) % (sizeof(seeds) / sizeof(seeds[0]))];
+    length = strlen(from);
+    memcpy(built, from, length);
+    mutations = next_Random(&state) % (FUZZ_MAX_MUTATIONS + 1);
+    for(i = 0; i < mutations; i++) {
+      at = length > 0 ? next_Random(&state) % length : 0;
+      switch(next_Random(&state) % 4) {
+      case 0: //cut the message short
+        length = at;
+        break;
+      case 1: //overwrite a byte, half of the time with one of the bytes tags are made of
+        if(length > 0)
+          built[at] = next_Random(&state) % 2 ? "<>/ eE"[next_Random(&state) % 6] : (char) next_Random(&state);
+        break;
+      case 2: //insert a byte
+        if(length < FUZZ_MAX_LENGTH) {
+          memmove(built + at + 1, built + at, length - at);
+          built[at] = (char) next_Random(&state);
+          length++;
+        }
+        break;
+      default: //append a piece of another seed
+        from = seeds[next_Random(&state) % (sizeof(seeds) / sizeof(seeds[0]))];
+        for(at = 0; from[at] != '\0' && length < FUZZ_MAX_LENGTH; at++)
+          built[length++] = from[at];
+      }
+    }
+    message = memory + page - length;
+    memcpy(message, built, length);
+    opcode = dispatch_Message(NULL, message, length, &reply);
+    if(opcode == -1)
+      continue;
+    accepted++;
+    if(check_Accepted(message, length, opcode) == -1 || request_Opcode(message, length) != opcode) {
+      fprintf(stderr, "ERROR: Message %ld Accepted As %s: %.*s\n", n, command_Name(opcode), length, message);
+      munmap(memory, 2 * page);
+      return -1;
+    }
+  }
+  printf("%ld messages parsed, %d accepted, none read past its end or was accepted in the wrong form\n", messages, accepted);
+  munmap(memory, 2 * page);
+  return 0;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Checked the slow way, with the name the command was registered with.
+ **************************************************
+ */
+int check_Accepted(const char *message, int length, int opcode){
+  const char *name = command_Name(opcode);
+  int nameLength;
+  if(name == NULL)
+    return -1;
+  nameLength = strlen(name);
+  if(length < nameLength + 3 || message[0] != '<' || strncasecmp(message + 1, name, nameLength))
+    return -1;
+  //<name/>
+  if(length == nameLength + 3 && message[nameLength + 1] == '/' && message[nameLength + 2] == '>')
+    return bodyLengthFound == 0 && bodyFound == message + length && opcode != OPCODE_ECHO ? 0 : -1;
+  //<name>body</name>
+  if(opcode != OPCODE_ECHO && opcode != OPCODE_SHUTDOWN)
+    return -1;
+  if(length < 2 * nameLength + 5 || message[nameLength + 1] != '>' || message[length - nameLength - 3] != '<'
+     || message[length - nameLength - 2] != '/' || strncasecmp(message + length - nameLength - 1, name, nameLength)
+     || message[length - 1] != '>')
+    return -1;
+  return bodyFound == message + nameLength + 2 && bodyLengthFound == length - 2 * nameLength - 5 ? 0 : -1;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+void run_Dispatch_Bench(long iterations){
+  static const char *names[] = { "echo 16 bytes", "echo 200 bytes", "loadavg", "unknown" };
+  char messages[4][256];
+  int lengths[4], i;
+  long n;
+  uint64_t start;
+  volatile int sink = 0;
+  struct message_reply reply;
+
+  lengths[0] = snprintf(messages[0], sizeof(messages[0]), "<echo>%016d</echo>", 0);
+  lengths[1] = snprintf(messages[1], sizeof(messages[1]), "<echo>%0200d</echo>", 0);
+  lengths[2] = snprintf(messages[2], sizeof(messages[2]), "<loadavg/>");
+  lengths[3] = snprintf(messages[3], sizeof(messages[3]), "<uptime/>");
+  printf("nano seconds per message\n");
+  for(i = 0; i < 4; i++) {
+    start = test_Clock();
+    for(n = 0; n < iterations; n++)
+      sink += dispatch_Message(NULL, messages[i], lengths[i], &reply);
+    printf("%-16s %8.1f\n", names[i], (double) (test_Clock() - start) / iterations);
+  }
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+uint64_t next_Random(uint64_t *state){
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+uint64_t test_Clock(void){
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
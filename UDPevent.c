@@ -0,0 +1,251 @@
+/**	@file UDPevent.c
+ * 	@brief Contains the function implementations of the epoll event loop.
+ *	Every server loop waits on one epoll instance for its sockets, its timers, the signalfd 
+ *	and the eventfd that wakes all loops on shutdown, so one thread can serve several ports 
+ *	and run periodic work without blocking in recvfrom.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPevent.h"
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Registers a descriptor with the epoll instance of a loop.
+*	@param 	loop is the loop to add to.
+*			fd is the descriptor.
+*			kind is EVENT_SOCKET, EVENT_TIMER, EVENT_SIGNAL or EVENT_WAKE.
+*			events is the epoll event mask.
+*			callback and arg are stored in the source.
+*	@return returns the source, NULL on error.
+*/
+struct event_source *add_Event(struct event_loop *loop, int fd, int kind, uint32_t events, event_callback callback, void *arg);
+
+/**	@brief 	Waits once for ready sources and runs their callbacks.
+*	@param 	loop is the loop.
+*			timeout is the epoll_wait timeout in milli seconds, -1 waits until a source is ready.
+*	@return returns 0, -1 if epoll_wait failed.
+*/
+int wait_Events(struct event_loop *loop, int timeout);
+
+/**	@brief 	Reads what a timer or signal descriptor has to say and runs the callback of its source.
+*	@param 	source is the ready source.
+*			events is the epoll event mask.
+*	@return returns nothing.
+*/
+void fire_Event(struct event_source *source, uint32_t events);
+
+/*
+ **************************************************
+ *		EVENT FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ *	MODIFIED ON 10/17/2026
+ *	Errors are returned instead of stopping the server, as in every function of the event loop
+ **************************************************
+ */
+int init_Event_Loop(struct event_loop *loop, atomic_int *stop, int wakefd){
+  memset(loop, 0, sizeof(struct event_loop));
+  loop->stop = stop;
+  loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+  if(loop->epfd == -1)
+	return printErrorMessage("Cannot Create Event Loop");
+  //level triggered and never read, once written it wakes every loop until they all stopped
+  if(wakefd >= 0 && add_Event(loop, wakefd, EVENT_WAKE, EPOLLIN, NULL, NULL) == NULL) {
+    close(loop->epfd);
+    return -1;
+  }
+  return 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void free_Event_Loop(struct event_loop *loop){
+  int i;
+  for(i = 0; i < loop->count; i++)
+    if(loop->sources[i].kind == EVENT_TIMER || loop->sources[i].kind == EVENT_SIGNAL)
+      close(loop->sources[i].fd);
+  close(loop->epfd);
+  loop->count = 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+struct event_source *add_Socket_Event(struct event_loop *loop, int fd, event_callback callback, void *arg){
+  return add_Event(loop, fd, EVENT_SOCKET, EPOLLIN | EPOLLET, callback, arg);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+struct event_source *add_Timer_Event(struct event_loop *loop, int interval, int repeat, event_callback callback, void *arg){
+  struct itimerspec timer;
+  struct event_source *source;
+  int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if(fd == -1) {
+	printErrorMessage("Cannot Create Timer");
+    return NULL;
+  }
+  memset(&timer, 0, sizeof(timer));
+  timer.it_value.tv_sec = interval / 1000;
+  timer.it_value.tv_nsec = (interval % 1000) * 1000000L;
+  if(repeat)
+    timer.it_interval = timer.it_value;
+  if(timerfd_settime(fd, 0, &timer, NULL) == -1)
+	printErrorMessage("Cannot Start Timer");
+  else if((source = add_Event(loop, fd, EVENT_TIMER, EPOLLIN, callback, arg)) != NULL)
+    return source;
+  close(fd);
+  return NULL;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+struct event_source *add_Signal_Event(struct event_loop *loop, sigset_t *signals, event_callback callback, void *arg){
+  struct event_source *source;
+  int fd = signalfd(-1, signals, SFD_NONBLOCK | SFD_CLOEXEC);
+  if(fd == -1) {
+	printErrorMessage("Cannot Create Signal Descriptor");
+    return NULL;
+  }
+  if((source = add_Event(loop, fd, EVENT_SIGNAL, EPOLLIN, callback, arg)) == NULL)
+    close(fd);
+  return source;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int block_Signals(sigset_t *signals){
+  sigemptyset(signals);
+  sigaddset(signals, SIGINT);
+  sigaddset(signals, SIGTERM);
+  if(pthread_sigmask(SIG_BLOCK, signals, NULL) != 0)
+	return printErrorMessage("Cannot Block Signals");
+  return 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int set_Non_Blocking(int fd){
+  int flags = fcntl(fd, F_GETFL, 0);
+  if(flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+	return printErrorMessage("Cannot Make Socket Non Blocking");
+  return 0;
+}
+
+
+/*
+ **************************************************
+ *	The stop flag is checked after every wait, a source that is still ready is reported again
+ *	by the next wait so nothing is lost by leaving in the middle of a round.
+ **************************************************
+ */
+int run_Event_Loop(struct event_loop *loop){
+  while(!atomic_load(loop->stop))
+    if(wait_Events(loop, -1) == -1)
+      return -1;
+  return 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int poll_Event_Loop(struct event_loop *loop){
+  return wait_Events(loop, 0);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int wait_Events(struct event_loop *loop, int timeout){
+  struct epoll_event events[EVENT_WAIT_BATCH];
+  int ready, i;
+  ready = epoll_wait(loop->epfd, events, EVENT_WAIT_BATCH, timeout);
+  if(ready == -1 && errno != EINTR)
+	return printErrorMessage("Cannot Wait for Events");
+  for(i = 0; i < ready && !atomic_load(loop->stop); i++)
+    fire_Event(events[i].data.ptr, events[i].events);
+  return 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+struct event_source *add_Event(struct event_loop *loop, int fd, int kind, uint32_t events, event_callback callback, void *arg){
+  struct epoll_event event;
+  struct event_source *source;
+  if(loop->count == MAX_EVENT_SOURCES) {
+	printErrorMessage("Too Many Event Sources");
+    return NULL;
+  }
+  source = &loop->sources[loop->count];
+  source->fd = fd;
+  source->kind = kind;
+  source->callback = callback;
+  source->arg = arg;
+  memset(&event, 0, sizeof(event));
+  event.events = events;
+  event.data.ptr = source;
+  if(epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &event) == -1) {
+	printErrorMessage("Cannot Add To Event Loop");
+    return NULL;
+  }
+  loop->count++;
+  return source;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void fire_Event(struct event_source *source, uint32_t events){
+  uint64_t expirations;
+  struct signalfd_siginfo info;
+  switch(source->kind) {
+    case EVENT_SOCKET:
+      source->callback(source, events);
+      break;
+    case EVENT_TIMER:
+      if(read(source->fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+        source->callback(source, expirations);
+      break;
+    case EVENT_SIGNAL:
+      while(read(source->fd, &info, sizeof(info)) == sizeof(info))
+        source->callback(source, info.ssi_signo);
+      break;
+    default:
+      break; //the wake eventfd only ends the wait
+  }
+}
@@ -0,0 +1,143 @@
+/**	@file UDPevent.h
+ * 	@brief Contains the function prototypes for the epoll event loop of the UDP server
+ *	that are implemented in UDPevent.c
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPEVENT_H
+#define UDPEVENT_H
+
+#include "UDPserver.h"
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <sys/eventfd.h>
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define MAX_EVENT_SOURCES 64
+#define EVENT_WAIT_BATCH 64		//epoll events handled per epoll_wait call
+#define EVENT_SOCKET 0
+#define EVENT_TIMER 1
+#define EVENT_SIGNAL 2
+#define EVENT_WAKE 3
+
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+struct event_source;
+
+/**	@brief 	Called when a source is ready. value is the epoll events of a socket, the number of
+*			expirations of a timer or the number of a signal.
+*/
+typedef void (*event_callback)(struct event_source *source, uint64_t value);
+
+/**	@brief 	One file descriptor watched by an event loop and what to do when it is ready.
+*/
+struct event_source {
+  int fd;
+  int kind;
+  event_callback callback;
+  void *arg;
+};
+
+/**	@brief 	An epoll instance and the sources registered with it. The loop runs until stop is set,
+*			the shared wake eventfd makes every loop notice it without polling.
+*/
+struct event_loop {
+  int epfd;
+  int count;
+  atomic_int *stop;
+  struct event_source sources[MAX_EVENT_SOURCES];
+};
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Creates the epoll instance of a loop and registers the wake eventfd.
+*	@param 	loop is the loop to set up.
+*			stop is the flag that ends the loop.
+*			wakefd is the eventfd written when stop is set, -1 for none.
+*	@return returns 0 on success, -1 when epoll cannot be created.
+*/
+int init_Event_Loop(struct event_loop *loop, atomic_int *stop, int wakefd);
+
+/**	@brief 	Closes the epoll instance and the timer and signal descriptors the loop created.
+*			Sockets and the wake eventfd belong to their owners and are left open.
+*	@param 	loop is the loop to free.
+*	@return returns nothing.
+*/
+void free_Event_Loop(struct event_loop *loop);
+
+/**	@brief 	Watches a socket. Sockets are edge triggered, the callback has to read until EAGAIN.
+*	@param 	loop is the loop to add to.
+*			fd is a non blocking socket.
+*			callback is called with the epoll events when the socket is readable.
+*			arg is handed to the callback through the source.
+*	@return returns the source, NULL on error.
+*/
+struct event_source *add_Socket_Event(struct event_loop *loop, int fd, event_callback callback, void *arg);
+
+/**	@brief 	Starts a timer on a timerfd.
+*	@param 	loop is the loop to add to.
+*			interval is the time to the first expiration in milli seconds.
+*			repeat is 1 to fire every interval, 0 to fire once.
+*			callback is called with the number of expirations since it last ran.
+*			arg is handed to the callback through the source.
+*	@return returns the source, NULL on error.
+*/
+struct event_source *add_Timer_Event(struct event_loop *loop, int interval, int repeat, event_callback callback, void *arg);
+
+/**	@brief 	Receives signals through a signalfd. The signals have to be blocked in every thread 
+*			before it starts, see block_Signals.
+*	@param 	loop is the loop to add to.
+*			signals is the set of signals to receive.
+*			callback is called once for every signal with its number.
+*			arg is handed to the callback through the source.
+*	@return returns the source, NULL on error.
+*/
+struct event_source *add_Signal_Event(struct event_loop *loop, sigset_t *signals, event_callback callback, void *arg);
+
+/**	@brief 	Blocks the signals the server handles through a signalfd, called before any thread starts
+*			so every thread inherits the mask.
+*	@param 	signals is filled with the blocked signals.
+*	@return returns 0 on success, -1 on error.
+*/
+int block_Signals(sigset_t *signals);
+
+/**	@brief 	Waits for events and runs the callbacks of the ready sources until stop is set.
+*	@param 	loop is the loop to run.
+*	@return returns 0 once stop is set, -1 if waiting failed.
+*/
+int run_Event_Loop(struct event_loop *loop);
+
+/**	@brief 	Runs the callbacks of the sources that are ready now without waiting, for a loop whose
+*			epoll descriptor is watched by another loop.
+*	@param 	loop is the loop to poll.
+*	@return returns 0, -1 if waiting failed.
+*/
+int poll_Event_Loop(struct event_loop *loop);
+
+/**	@brief 	Makes a descriptor non blocking.
+*	@param 	fd is the descriptor.
+*	@return returns 0 on success, -1 on error.
+*/
+int set_Non_Blocking(int fd);
+
+#endif
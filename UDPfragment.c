@@ -0,0 +1,340 @@
+/**	@file UDPfragment.c
+ * 	@brief Contains the function implementations of fragmenting and reassembling large messages.
+ *	A message that does not fit in one datagram of the path MTU is sent as several fragments,
+ *	each one starting with a fragment_header. The receiver keeps the partial messages in a 
+ *	reassembly table with a fixed number of slots, a memory budget and a timeout, so a lost
+ *	fragment or a client that never finishes a message cannot hold memory forever.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPfragment.h"
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Frees a slot and the message it holds.
+*	@param 	table is the table the slot belongs to.
+*			slot is the slot to release.
+*	@return returns nothing.
+*/
+void release_Slot(struct reassembly_table *table, struct reassembly_slot *slot);
+
+/**	@brief 	Drops every message that has not been completed in time.
+*	@param 	table is the table to clean.
+*			now is the current fragment_Clock time.
+*	@return returns nothing.
+*/
+void expire_Slots(struct reassembly_table *table, uint64_t now);
+
+/**	@brief 	Finds the slot for a new message, evicting the oldest messages if there is no room.
+*	@param 	table is the table to look in.
+*			need is the number of bytes the message needs.
+*	@return returns a free slot or NULL if the message cannot fit.
+*/
+struct reassembly_slot *claim_Slot(struct reassembly_table *table, size_t need);
+
+/**	@brief 	Works out from one fragment the payload every fragment but the last of its message carries.
+*	@param 	index, count, totalLength and offset are from the header of the fragment.
+*			payload is the number of message bytes the fragment carries.
+*	@return returns the fragment size, -1 if the fragment does not sit where its index puts it.
+*/
+int fragment_Size(uint16_t index, uint16_t count, uint32_t totalLength, uint32_t offset, uint32_t payload);
+
+/*
+ **************************************************
+ *		FRAGMENT FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ **************************************************
+ */
+int fragment_Payload(int mtu){
+  return mtu - UDP_IP_OVERHEAD - FRAGMENT_HEADER_SIZE;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int is_Fragment(const char *datagram, int length){
+  return length >= FRAGMENT_HEADER_SIZE && (uint8_t) datagram[0] == FRAGMENT_MAGIC;
+}
+
+
+/*
+ **************************************************
+ *	Walks the parts once, a fragment that crosses the end of a part gets a slice of each part.
+ **************************************************
+ */
+int split_Fragments(struct fragment_set *set, const struct iovec *parts, int partCount, int mtu, uint32_t messageId){
+  int payload = fragment_Payload(mtu), total = 0, part = 0, i, left, take;
+  size_t partOffset = 0;
+  struct fragment_header *header;
+  
+  for(i = 0; i < partCount; i++)
+    total += parts[i].iov_len;
+  set->count = total == 0 ? 1 : (total + payload - 1) / payload;
+  if(set->count > MAX_FRAGMENTS || partCount > FRAGMENT_PARTS)
+    return -1;
+  
+  for(i = 0; i < set->count; i++) {
+    header = &set->header[i];
+    header->magic = FRAGMENT_MAGIC;
+    header->flags = 0;
+    header->index = htons(i);
+    header->count = htons(set->count);
+    header->reserved = 0;
+    header->messageId = htonl(messageId);
+    header->totalLength = htonl(total);
+    header->offset = htonl(i * payload);
+    set->iov[i][0].iov_base = header;
+    set->iov[i][0].iov_len = FRAGMENT_HEADER_SIZE;
+    set->iovlen[i] = 1;
+    
+    //take the next payload bytes out of the parts
+    for(left = total - i * payload < payload ? total - i * payload : payload; left > 0; left -= take) {
+      while(partOffset == parts[part].iov_len) {
+        part++;
+        partOffset = 0;
+      }
+      take = parts[part].iov_len - partOffset < (size_t) left ? (int) (parts[part].iov_len - partOffset) : left;
+      set->iov[i][set->iovlen[i]].iov_base = (char *) parts[part].iov_base + partOffset;
+      set->iov[i][set->iovlen[i]].iov_len = take;
+      set->iovlen[i]++;
+      partOffset += take;
+    }
+  }
+  return set->count;
+}
+
+
+/*
+ **************************************************
+ *	sendmmsg may stop early so keep going until every fragment is out.
+ **************************************************
+ */
+int send_Fragments(int sockfd, const struct sockaddr *dest, socklen_t destlen, struct fragment_set *set){
+  int i, sent, flushed, bytes = 0;
+  for(i = 0; i < set->count; i++) {
+    memset(&set->msg[i], 0, sizeof(struct mmsghdr));
+    set->msg[i].msg_hdr.msg_name = (void *) dest;
+    set->msg[i].msg_hdr.msg_namelen = destlen;
+    set->msg[i].msg_hdr.msg_iov = set->iov[i];
+    set->msg[i].msg_hdr.msg_iovlen = set->iovlen[i];
+  }
+  for(flushed = 0; flushed < set->count; flushed += sent) {
+    sent = sendmmsg(sockfd, set->msg + flushed, set->count - flushed, 0);
+    if(sent <= 0)
+      return -1;
+  }
+  for(i = 0; i < set->count; i++)
+    bytes += set->msg[i].msg_len;
+  return bytes;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void init_Reassembly(struct reassembly_table *table, int maxMessage){
+  memset(table, 0, sizeof(struct reassembly_table));
+  table->maxMessage = maxMessage;
+  table->memoryBudget = REASSEMBLY_MEMORY;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void free_Reassembly(struct reassembly_table *table){
+  int i;
+  for(i = 0; i < REASSEMBLY_SLOTS; i++)
+    if(table->slot[i].inUse)
+      release_Slot(table, &table->slot[i]);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int reassemble_Fragment(struct reassembly_table *table, const struct sockaddr_in6 *source, const char *datagram,
+                        int length, char **message, int *messageLength){
+  struct fragment_header header;
+  struct reassembly_slot *slot = NULL;
+  int i, fromClient = 0, payload = length - FRAGMENT_HEADER_SIZE, size;
+  uint16_t index, count;
+  uint32_t messageId, totalLength, offset;
+  uint64_t now = fragment_Clock();
+  
+  if(!is_Fragment(datagram, length))
+    return -1;
+  memcpy(&header, datagram, FRAGMENT_HEADER_SIZE);
+  index = ntohs(header.index);
+  count = ntohs(header.count);
+  messageId = ntohl(header.messageId);
+  totalLength = ntohl(header.totalLength);
+  offset = ntohl(header.offset);
+  if(count == 0 || count > MAX_FRAGMENTS || index >= count || totalLength > (uint32_t) table->maxMessage
+     || offset > totalLength || (uint32_t) payload > totalLength - offset
+     || (size = fragment_Size(index, count, totalLength, offset, payload)) == -1) {
+    table->dropped++;
+    return -1;
+  }
+  expire_Slots(table, now);
+  
+  //find the message this fragment belongs to
+  for(i = 0; i < REASSEMBLY_SLOTS; i++) {
+    if(!table->slot[i].inUse || table->slot[i].source.sin6_port != source->sin6_port
+       || memcmp(&table->slot[i].source.sin6_addr, &source->sin6_addr, sizeof(struct in6_addr)))
+      continue;
+    fromClient++;
+    if(table->slot[i].messageId == messageId)
+      slot = &table->slot[i];
+  }
+  
+  //start a new message if this client is not over its share of the table
+  if(slot == NULL) {
+    if(fromClient >= REASSEMBLY_PER_CLIENT || (slot = claim_Slot(table, totalLength + 1)) == NULL) {
+      table->dropped++;
+      return -1;
+    }
+    slot->buffer = calloc(1, totalLength + 1);
+    if(slot->buffer == NULL) {
+      table->dropped++;
+      return -1;
+    }
+    slot->inUse = 1;
+    slot->source = *source;
+    slot->messageId = messageId;
+    slot->totalLength = totalLength;
+    slot->count = count;
+    slot->receivedCount = 0;
+    slot->fragmentSize = size;
+    slot->started = now;
+    memset(slot->received, 0, sizeof(slot->received));
+    table->memoryUsed += totalLength + 1;
+  }
+  else if(slot->totalLength != totalLength || slot->count != count || slot->fragmentSize != (uint32_t) size) {
+    table->dropped++;
+    return -1;
+  }
+  
+  //a duplicate fragment changes nothing
+  if(slot->received[index / 64] & (1ULL << (index % 64)))
+    return 0;
+  memcpy(slot->buffer + offset, datagram + FRAGMENT_HEADER_SIZE, payload);
+  slot->received[index / 64] |= 1ULL << (index % 64);
+  if(++slot->receivedCount < slot->count)
+    return 0;
+  
+  //complete, hand the buffer over to the caller
+  slot->buffer[totalLength] = '\0';
+  *message = slot->buffer;
+  *messageLength = totalLength;
+  table->memoryUsed -= totalLength + 1;
+  slot->buffer = NULL;
+  slot->inUse = 0;
+  return 1;
+}
+
+
+/*
+ **************************************************
+ *	Every fragment must sit where its index puts it with the same fragment size as the others, so
+ *	the fragments that complete a message cover each of its bytes once.
+ **************************************************
+ */
+int fragment_Size(uint16_t index, uint16_t count, uint32_t totalLength, uint32_t offset, uint32_t payload){
+  uint32_t size;
+  if(count == 1)
+    return offset == 0 && payload == totalLength ? (int) totalLength : -1;
+  if(index < count - 1)
+    size = payload;
+  else if(offset % index == 0 && offset + payload == totalLength)
+    size = offset / index;
+  else
+    return -1;
+  if(size == 0 || offset != (uint32_t) index * size || (uint64_t) size * (count - 1) >= totalLength
+     || (uint64_t) size * count < totalLength)
+    return -1;
+  return (int) size;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+uint64_t fragment_Clock(void){
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void release_Slot(struct reassembly_table *table, struct reassembly_slot *slot){
+  table->memoryUsed -= slot->totalLength + 1;
+  free(slot->buffer);
+  slot->buffer = NULL;
+  slot->inUse = 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void expire_Slots(struct reassembly_table *table, uint64_t now){
+  int i;
+  for(i = 0; i < REASSEMBLY_SLOTS; i++) {
+    if(table->slot[i].inUse && now - table->slot[i].started > REASSEMBLY_TIMEOUT_MIL_SEC) {
+      release_Slot(table, &table->slot[i]);
+      table->expired++;
+    }
+  }
+}
+
+
+/*
+ **************************************************
+ *	The oldest messages are the most likely to have lost a fragment, so they are evicted first.
+ **************************************************
+ */
+struct reassembly_slot *claim_Slot(struct reassembly_table *table, size_t need){
+  int i;
+  struct reassembly_slot *unused = NULL, *oldest;
+  if(need > table->memoryBudget)
+    return NULL;
+  for(;;) {
+    oldest = NULL;
+    for(i = 0; i < REASSEMBLY_SLOTS; i++) {
+      if(!table->slot[i].inUse) {
+        if(unused == NULL)
+          unused = &table->slot[i];
+      }
+      else if(oldest == NULL || table->slot[i].started < oldest->started)
+        oldest = &table->slot[i];
+    }
+    if(unused != NULL && table->memoryUsed + need <= table->memoryBudget)
+      return unused;
+    if(oldest == NULL)
+      return NULL;
+    release_Slot(table, oldest);
+    table->dropped++;
+  }
+}
@@ -0,0 +1,178 @@
+/**	@file UDPfragment.h
+ * 	@brief Contains the function prototypes for splitting large messages into fragments that fit
+ *	the path MTU and for reassembling them, implemented in UDPfragment.c and used by both the
+ *	UDP server and the C client.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPFRAGMENT_H
+#define UDPFRAGMENT_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE	//needed for sendmmsg
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define FRAGMENT_MAGIC 0xFA		//first byte of a fragment, a text message starts with '<'
+#define FRAGMENT_HEADER_SIZE 20
+#define FRAGMENT_PARTS 4		//largest number of parts a fragmented message is gathered from
+#define UDP_IP_OVERHEAD 48		//IPv6 and UDP headers, a fragment of this size fits the path of either family
+#define UDP_IPV4_OVERHEAD 28		//IPv4 and UDP headers, the largest datagram an IPv4 client fits into the MTU
+#define DEFAULT_MTU 1500
+#define MIN_MTU 576
+#define MAX_MTU 65536
+#define MAX_MESSAGE_LIMIT 65536
+#define MAX_FRAGMENTS 128
+#define REASSEMBLY_SLOTS 64
+#define REASSEMBLY_PER_CLIENT 4
+#define REASSEMBLY_MEMORY (4 * 1024 * 1024)
+#define REASSEMBLY_TIMEOUT_MIL_SEC 2000
+
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+/**	@brief 	Starts every fragment, all fields after magic and flags are in network byte order.
+*			offset is where the fragment payload goes in the message of totalLength bytes.
+*/
+struct fragment_header {
+  uint8_t magic;
+  uint8_t flags;
+  uint16_t index;
+  uint16_t count;
+  uint16_t reserved;
+  uint32_t messageId;
+  uint32_t totalLength;
+  uint32_t offset;
+};
+
+/**	@brief 	The datagrams a message was split into, each one is a header and slices of the message parts.
+*/
+struct fragment_set {
+  int count;
+  struct fragment_header header[MAX_FRAGMENTS];
+  struct iovec iov[MAX_FRAGMENTS][FRAGMENT_PARTS + 1];
+  int iovlen[MAX_FRAGMENTS];
+  struct mmsghdr msg[MAX_FRAGMENTS];
+};
+
+/**	@brief 	A message being reassembled, received marks the fragment indexes that arrived.
+*			fragmentSize is the payload of every fragment but the last, fragment index always
+*			starts at index * fragmentSize.
+*/
+struct reassembly_slot {
+  int inUse;
+  struct sockaddr_in6 source;
+  uint32_t messageId;
+  uint32_t totalLength;
+  uint16_t count;
+  uint16_t receivedCount;
+  uint32_t fragmentSize;
+  uint64_t started;
+  uint64_t received[MAX_FRAGMENTS / 64];
+  char *buffer;
+};
+
+/**	@brief 	Every message being reassembled for one socket. The table never holds more than 
+*			REASSEMBLY_SLOTS messages, REASSEMBLY_PER_CLIENT per source or memoryBudget bytes,
+*			and drops messages that are not complete after REASSEMBLY_TIMEOUT_MIL_SEC.
+*/
+struct reassembly_table {
+  int maxMessage;
+  size_t memoryBudget;
+  size_t memoryUsed;
+  unsigned long expired;
+  unsigned long dropped;
+  struct reassembly_slot slot[REASSEMBLY_SLOTS];
+};
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Number of message bytes one fragment can carry without IP fragmentation.
+*	@param 	mtu is the path MTU.
+*	@return returns the fragment payload size.
+*/
+int fragment_Payload(int mtu);
+
+/**	@brief 	Tells fragments apart from plain messages.
+*	@param 	datagram is the received datagram.
+*			length is the size of the datagram.
+*	@return returns 1 if the datagram is a fragment else returns 0.
+*/
+int is_Fragment(const char *datagram, int length);
+
+/**	@brief 	Splits a message into fragments. The fragments point into the parts, nothing is copied.
+*	@param 	set is filled in with the fragments.
+*			parts are the pieces the message is gathered from, at most FRAGMENT_PARTS.
+*			partCount is the number of parts.
+*			mtu is the path MTU.
+*			messageId identifies the message among the ones from the same sender.
+*	@return returns the number of fragments or -1 if the message needs more than MAX_FRAGMENTS.
+*/
+int split_Fragments(struct fragment_set *set, const struct iovec *parts, int partCount, int mtu, uint32_t messageId);
+
+/**	@brief 	Sends every fragment of a set with sendmmsg.
+*	@param 	sockfd is the socket to send on.
+*			dest is the address to send to.
+*			destlen is the size of dest.
+*			set is the fragment set built by split_Fragments.
+*	@return returns the number of bytes sent or -1 if a fragment could not be sent.
+*/
+int send_Fragments(int sockfd, const struct sockaddr *dest, socklen_t destlen, struct fragment_set *set);
+
+/**	@brief 	Prepares an empty reassembly table.
+*	@param 	table is the table to set up.
+*			maxMessage is the largest message that will be reassembled.
+*	@return returns nothing.
+*/
+void init_Reassembly(struct reassembly_table *table, int maxMessage);
+
+/**	@brief 	Frees every message still being reassembled.
+*	@param 	table is the table to empty.
+*	@return returns nothing.
+*/
+void free_Reassembly(struct reassembly_table *table);
+
+/**	@brief 	Adds a fragment to the message it belongs to.
+*	@param 	table is the reassembly table of the socket.
+*			source is the sender of the fragment.
+*			datagram is the fragment as received.
+*			length is the size of the fragment.
+*			message is set to the complete message, null terminated, when the last fragment arrived.
+*			The caller frees it with free().
+*			messageLength is set to the size of the complete message.
+*	@return returns 1 when the message is complete, 0 when more fragments are needed
+*			and -1 when the fragment was invalid or had to be dropped.
+*/
+int reassemble_Fragment(struct reassembly_table *table, const struct sockaddr_in6 *source, const char *datagram,
+                        int length, char **message, int *messageLength);
+
+/**	@brief 	Current CLOCK_MONOTONIC time used for the reassembly timeouts.
+*	@param 	no parameter is passed. 
+*	@return returns the time in milliseconds.
+*/
+uint64_t fragment_Clock(void);
+
+#endif
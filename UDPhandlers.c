@@ -0,0 +1,611 @@
+/**	@file UDPhandlers.c
+ * 	@brief Contains the function implementations of answering requests on handler threads.
+ *	A server loop receives into one of its request slots, reassembles fragments and offers the slot
+ *	to the queue of a handler thread. The handler runs the command, gathers the reply into the slot
+ *	and puts it on the done queue of the loop, which sends the replies it gets back with sendmmsg.
+ *	A handler that runs out of requests steals them from the queues of the others, so one slow
+ *	command does not hold up the requests queued behind it. When a loop has no free slot or every
+ *	queue is full the request is answered <error>busy</error> right away.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPhandlers.h"
+#include "UDPstats.h"
+#include "UDPlimit.h"
+#include "UDPtrace.h"
+#include "UDPbuffer.h"
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Runs a handler thread until the pool is stopped.
+*	@param 	arg is the handler_thread.
+*	@return returns NULL.
+*/
+void *handler_Thread(void *arg);
+
+/**	@brief 	Takes the next request of a handler, from its own queue first and then from the others.
+*	@param 	handler is the handler thread.
+*	@return returns the slot, NULL when every queue is empty.
+*/
+struct request_slot *next_Request(struct handler_thread *handler);
+
+/**	@brief 	Builds the reply to a request, gathers it into the slot and gives the slot back to its server loop.
+*	@param 	handler is the handler thread.
+*			slot is the request.
+*	@return returns nothing.
+*/
+void handle_Request(struct handler_thread *handler, struct request_slot *slot);
+
+/**	@brief 	Wakes a handler thread if it waits for requests.
+*	@param 	handler is the handler thread.
+*	@return returns 1 if it was waiting, 0 otherwise.
+*/
+int wake_Handler(struct handler_thread *handler);
+
+/**	@brief 	Turns a received datagram into a request and offers it to the handlers, or answers it right away
+*			when it is too long, when it is the spare slot or when every handler queue is full.
+*	@param 	worker is the server loop that received the datagram.
+*			slot is the slot it was received into.
+*			length is the size of the datagram, more than the configured datagram size if it was truncated.
+*	@return returns nothing.
+*/
+void dispatch_Request(struct server_worker *worker, struct request_slot *slot, int length);
+
+/**	@brief 	Offers a request to the handlers, starting with the next one in turn and going on while queues are full.
+*			A handler that is busy gets a waiting one woken to steal the request.
+*	@param 	worker is the server loop that received the request.
+*			slot is the request.
+*	@return returns 0 on success, -1 if every handler queue is full.
+*/
+int offer_Request(struct server_worker *worker, struct request_slot *slot);
+
+/**	@brief 	Sends a reply built by the server loop itself, counts and logs it.
+*	@param 	worker is the server loop.
+*			slot is the request, its socket, client, trace and message length are used.
+*			opcode is the command the request was recognised as.
+*			reply is the reply.
+*	@return returns nothing.
+*/
+void send_Now(struct server_worker *worker, struct request_slot *slot, int opcode, struct message_reply *reply);
+
+/**	@brief 	Takes the answered slots off the done queue of a server loop and sends their replies.
+*	@param 	worker is the server loop.
+*	@return returns nothing.
+*/
+void flush_Replies(struct server_worker *worker);
+
+/**	@brief 	Sends the replies gathered in the sending slots with sendmmsg, counts and logs them and frees the slots.
+*	@param 	worker is the server loop.
+*			count is the number of replies, all to the socket of the first one.
+*	@return returns nothing.
+*/
+void send_Replies(struct server_worker *worker, int count);
+
+/**	@brief 	Frees the message and the reply of a slot and puts it back on the free list.
+*	@param 	dispatch is the dispatch_loop of the slot.
+*			slot is the slot, the spare slot is only emptied.
+*	@return returns nothing.
+*/
+void return_Slot(struct dispatch_loop *dispatch, struct request_slot *slot);
+
+/*
+ **************************************************
+ *		HANDLER FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	A handler has a server_worker of its own after the server loops, for its counters. It writes no request log, the server loop logs the request when it sends the reply.
+ **************************************************
+ */
+struct handler_pool *start_Handlers(struct server_config *config){
+  struct handler_pool *pool = calloc(1, sizeof(struct handler_pool));
+  struct handler_thread *handler;
+  int i;
+  if(pool == NULL || (pool->handlers = aligned_alloc(CACHE_LINE, config->handlerCount * sizeof(struct handler_thread))) == NULL) {
+    free(pool);
+    printErrorMessage("Cannot Allocate Handlers");
+    return NULL;
+  }
+  memset(pool->handlers, 0, config->handlerCount * sizeof(struct handler_thread));
+  atomic_init(&pool->stopping, 0);
+  for(i = 0; i < config->handlerCount; i++) {
+    handler = &pool->handlers[i];
+    handler->pool = pool;
+    handler->index = i;
+    handler->wakefd = -1;
+    pool->count++;
+    if(init_Queue(&handler->queue, config->queueDepth) == -1 || init_Worker(&handler->worker, config->workers + i, config) == -1 ||
+       (handler->wakefd = eventfd(0, EFD_CLOEXEC)) == -1) {
+      printErrorMessage("Cannot Set Up Handler");
+      free_Handlers(pool);
+      return NULL;
+    }
+    handler->worker.log = NULL;
+  }
+  for(pool->started = 0; pool->started < pool->count; pool->started++)
+    if(pthread_create(&pool->handlers[pool->started].thread, NULL, handler_Thread, &pool->handlers[pool->started]) != 0) {
+      printErrorMessage("Cannot Start Handler Thread");
+      free_Handlers(pool);
+      return NULL;
+    }
+  return pool;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The eventfd of a handler that is not waiting keeps the count, it does not wait on its next read.
+ **************************************************
+ */
+void stop_Handlers(struct handler_pool *pool){
+  unsigned long handled = 0, stolen = 0;
+  uint64_t one = 1;
+  int i;
+  if(pool == NULL || pool->started == 0)
+    return;
+  atomic_store(&pool->stopping, 1);
+  for(i = 0; i < pool->started; i++)
+    if(write(pool->handlers[i].wakefd, &one, sizeof(one)) != sizeof(one))
+      fprintf(stderr, "ERROR: Cannot Wake Handler %d\n", i);
+  for(i = 0; i < pool->started; i++) {
+    pthread_join(pool->handlers[i].thread, NULL);
+    handled += pool->handlers[i].handled;
+    stolen += pool->handlers[i].stolen;
+  }
+  printf("%d handlers answered %lu requests, %lu of them stolen from another handler\n", pool->started, handled, stolen);
+  pool->started = 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void free_Handlers(struct handler_pool *pool){
+  int i;
+  if(pool == NULL)
+    return;
+  stop_Handlers(pool);
+  for(i = 0; i < pool->count; i++) {
+    free_Queue(&pool->handlers[i].queue);
+    free_Worker(&pool->handlers[i].worker);
+    if(pool->handlers[i].wakefd >= 0)
+      close(pool->handlers[i].wakefd);
+  }
+  free(pool->handlers);
+  free(pool);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	sleeping is set before the queues are looked at a last time and a server loop reads it after
+ *	its push, the fences keep either the handler from missing the request or the loop from missing
+ *	that the handler waits.
+ **************************************************
+ */
+void *handler_Thread(void *arg){
+  struct handler_thread *handler = arg;
+  struct request_slot *slot;
+  uint64_t count;
+  while(!atomic_load(&handler->pool->stopping)) {
+    if((slot = next_Request(handler)) != NULL) {
+      handle_Request(handler, slot);
+      continue;
+    }
+    atomic_store(&handler->sleeping, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    if((slot = next_Request(handler)) != NULL) {
+      atomic_store(&handler->sleeping, 0);
+      handle_Request(handler, slot);
+      continue;
+    }
+    if(read(handler->wakefd, &count, sizeof(count)) == -1 && errno != EINTR)
+      break;
+    atomic_store(&handler->sleeping, 0);
+  }
+  return NULL;
+}
+
+
+/*
+ **************************************************
+ *	The others are tried starting with the next handler so they do not all steal from the same one.
+ **************************************************
+ */
+struct request_slot *next_Request(struct handler_thread *handler){
+  struct handler_pool *pool = handler->pool;
+  struct request_slot *slot = pop_Queue(&handler->queue);
+  int i;
+  for(i = 1; slot == NULL && i < pool->count; i++)
+    if((slot = pop_Queue(&pool->handlers[(handler->index + i) % pool->count].queue)) != NULL)
+      handler->stolen++;
+  return slot;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The reply is gathered into the slot before it is handed back, its parts may point into
+ *	state the next request changes.
+ **************************************************
+ */
+void handle_Request(struct handler_thread *handler, struct request_slot *slot){
+  struct server_config *config = handler->worker.config;
+  struct dispatch_loop *dispatch = slot->owner->dispatch;
+  struct message_reply reply;
+  uint64_t one = 1;
+
+  handler->worker.client = &slot->cliaddr;
+  slot->opcode = processMessage(&handler->worker, slot->message != NULL ? slot->message : packet_Data(&slot->owner->packets, slot->packet),
+                                slot->messageLength, &reply);
+  if(config->padReplies && reply.iov[0].iov_base != &reply.header) //binary replies are never padded
+    pad_Reply(&reply);
+  end_Handler(&slot->trace);
+  slot->reply = reply.length <= fragment_Payload(config->mtu) ? packet_Data(&slot->owner->packets, slot->replyPacket) : malloc(reply.length);
+  slot->replyLength = reply.length;
+  if(slot->reply != NULL)
+    gather_Reply(&reply, slot->reply);
+  handler->handled++;
+
+  //done holds every slot of the loop so it never fills up
+  push_Queue(&dispatch->done, slot);
+  atomic_thread_fence(memory_order_seq_cst);
+  if(!atomic_exchange(&dispatch->signalled, 1) && write(dispatch->wakefd, &one, sizeof(one)) != sizeof(one))
+    fprintf(stderr, "ERROR: Cannot Wake Server Loop %d\n", slot->owner->id);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int wake_Handler(struct handler_thread *handler){
+  uint64_t one = 1;
+  if(!atomic_load(&handler->sleeping) || !atomic_exchange(&handler->sleeping, 0))
+    return 0;
+  if(write(handler->wakefd, &one, sizeof(one)) != sizeof(one))
+    fprintf(stderr, "ERROR: Cannot Wake Handler %d\n", handler->index);
+  return 1;
+}
+
+
+/*
+ **************************************************
+ *		DISPATCH FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Every slot takes a packet buffer for its datagram and its control messages and one for its reply,
+ *	which holds a fragment, larger replies are allocated by the handler. The spare slot is the one past
+ *	the others and never has a reply. The buffers go back with the pool of the loop.
+ **************************************************
+ */
+struct dispatch_loop *create_Dispatch(struct server_worker *worker){
+  struct server_config *config = worker->config;
+  struct dispatch_loop *dispatch = calloc(1, sizeof(struct dispatch_loop));
+  struct request_slot *slot;
+  int i;
+  if(dispatch == NULL) {
+    printErrorMessage("Cannot Allocate Dispatch Slots");
+    return NULL;
+  }
+  dispatch->size = config->queueDepth;
+  dispatch->wakefd = -1;
+  dispatch->slots = calloc(dispatch->size, sizeof(struct request_slot));
+  dispatch->free = malloc(dispatch->size * sizeof(struct request_slot *));
+  dispatch->receiving = malloc(config->batchSize * sizeof(struct request_slot *));
+  dispatch->recvIov = calloc(config->batchSize, sizeof(struct iovec));
+  dispatch->recvHdr = calloc(config->batchSize, sizeof(struct mmsghdr));
+  if(dispatch->slots == NULL || dispatch->free == NULL || dispatch->receiving == NULL || dispatch->recvIov == NULL ||
+     dispatch->recvHdr == NULL || worker->packets.freeCount < (uint32_t) (2 * dispatch->size + 1) || init_Queue(&dispatch->done, dispatch->size) == -1 || (dispatch->wakefd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1) {
+    free_Dispatch(dispatch);
+    printErrorMessage("Cannot Allocate Dispatch Slots");
+    return NULL;
+  }
+  for(i = 0; i <= dispatch->size; i++) {
+    slot = i < dispatch->size ? &dispatch->slots[i] : &dispatch->spare;
+    slot->owner = worker;
+    slot->packet = take_Packet(&worker->packets);
+    slot->replyPacket = i < dispatch->size ? take_Packet(&worker->packets) : PACKET_NONE;
+    if(i < dispatch->size)
+      dispatch->free[dispatch->freeCount++] = slot;
+  }
+  atomic_init(&dispatch->signalled, 0);
+  return dispatch;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void free_Dispatch(struct dispatch_loop *dispatch){
+  struct request_slot *slot;
+  int i;
+  if(dispatch == NULL)
+    return;
+  for(i = 0; dispatch->slots != NULL && i < dispatch->size; i++) {
+    slot = &dispatch->slots[i];
+    free(slot->message);
+    if(slot->reply != NULL && slot->reply != packet_Data(&slot->owner->packets, slot->replyPacket))
+      free(slot->reply);
+  }
+  free_Queue(&dispatch->done);
+  if(dispatch->wakefd >= 0)
+    close(dispatch->wakefd);
+  free(dispatch->slots);
+  free(dispatch->free);
+  free(dispatch->receiving);
+  free(dispatch->recvIov);
+  free(dispatch->recvHdr);
+  free(dispatch);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Replies that came back are sent first when the slots run out, the datagrams that still find
+ *	no slot are received into the spare one and answered busy, one per call.
+ **************************************************
+ */
+void serve_Dispatch(struct event_source *source, uint64_t events){
+  struct server_worker *worker = source->arg;
+  struct server_config *config = worker->config;
+  struct dispatch_loop *dispatch = worker->dispatch;
+  struct request_slot *slot;
+  int received, count, length, i, index = socket_Index(worker, source->fd), controlSize = control_Size(config);
+  uint64_t started, realtime;
+
+  while(!server_Stopped(config)) {
+    if(dispatch->freeCount == 0)
+      flush_Replies(worker);
+    count = dispatch->freeCount < config->batchSize ? dispatch->freeCount : config->batchSize;
+    for(i = 0; i < count; i++)
+      dispatch->receiving[i] = dispatch->free[dispatch->freeCount - 1 - i];
+    if(count == 0)
+      dispatch->receiving[count++] = &dispatch->spare;
+    for(i = 0; i < count; i++) {
+      slot = dispatch->receiving[i];
+      dispatch->recvIov[i].iov_base = packet_Data(&worker->packets, slot->packet);
+      dispatch->recvIov[i].iov_len = config->datagramSize;
+      dispatch->recvHdr[i].msg_hdr.msg_iov = &dispatch->recvIov[i];
+      dispatch->recvHdr[i].msg_hdr.msg_iovlen = 1;
+      dispatch->recvHdr[i].msg_hdr.msg_name = &slot->cliaddr;
+      dispatch->recvHdr[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+      dispatch->recvHdr[i].msg_hdr.msg_control = packet_Headroom(&worker->packets, slot->packet);
+      dispatch->recvHdr[i].msg_hdr.msg_controllen = controlSize;
+    }
+    received = recvmmsg(source->fd, dispatch->recvHdr, count, 0, NULL);
+    if(received == -1) {
+      if(errno == EINTR)
+        continue;
+      break; //EAGAIN, the socket is drained
+    }
+    started = log_Clock();
+    realtime = trace_Realtime(config->timestamps);
+    //every filled slot leaves the free list before any is dispatched, a rejected one goes back on top
+    if(dispatch->receiving[0] != &dispatch->spare)
+      dispatch->freeCount -= received;
+    for(i = 0; i < received; i++) {
+      slot = dispatch->receiving[i];
+      length = dispatch->recvHdr[i].msg_len;
+      hold_Packet(&worker->packets, length + dispatch->recvHdr[i].msg_hdr.msg_controllen);
+      if(dispatch->recvHdr[i].msg_hdr.msg_flags & MSG_TRUNC)
+        length = config->datagramSize + 1;
+      slot->sockfd = source->fd;
+      count_Overflow(worker, index, dispatch->recvHdr[i].msg_hdr.msg_control, dispatch->recvHdr[i].msg_hdr.msg_controllen);
+      start_Trace(&slot->trace, config->timestamps, dispatch->recvHdr[i].msg_hdr.msg_control, dispatch->recvHdr[i].msg_hdr.msg_controllen,
+                  started, realtime);
+      dispatch_Request(worker, slot, length);
+    }
+  }
+  flush_Replies(worker);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Fragments are reassembled here, a message only goes to the handlers once it is complete.
+ *	Requests over the rate limit of their client are dropped before a handler sees them,
+ *	the server loop owns the token buckets.
+ **************************************************
+ */
+void dispatch_Request(struct server_worker *worker, struct request_slot *slot, int length){
+  struct dispatch_loop *dispatch = worker->dispatch;
+  struct message_reply reply;
+  char *datagram = packet_Data(&worker->packets, slot->packet);
+  int result = read_Message(worker, &slot->cliaddr, datagram, length, &reply, &slot->message, &slot->messageLength);
+  char *request = slot->message != NULL ? slot->message : datagram;
+  if(result != MESSAGE_PENDING && worker->clients != NULL
+     && !allow_Request(worker, &slot->cliaddr, result == MESSAGE_READY ? request_Opcode(request, slot->messageLength) : OPCODE_ERROR)) {
+    count_Drop(worker);
+    return_Slot(dispatch, slot);
+    return;
+  }
+  if(result == MESSAGE_READY && (slot == &dispatch->spare || offer_Request(worker, slot) == -1)) {
+    busy_Reply(&reply, request, slot->messageLength);
+    count_Busy(worker);
+    result = MESSAGE_REJECTED;
+  }
+  if(result == MESSAGE_READY)
+    return;
+  if(result == MESSAGE_REJECTED)
+    send_Now(worker, slot, OPCODE_ERROR, &reply);
+  return_Slot(dispatch, slot);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int offer_Request(struct server_worker *worker, struct request_slot *slot){
+  struct handler_pool *pool = worker->config->handlers;
+  struct handler_thread *handler;
+  int i, j;
+  for(i = 0; i < pool->count; i++) {
+    handler = &pool->handlers[worker->dispatch->next++ % pool->count];
+    if(push_Queue(&handler->queue, slot) == -1)
+      continue;
+    atomic_thread_fence(memory_order_seq_cst);
+    if(!wake_Handler(handler))
+      for(j = 1; j < pool->count && !wake_Handler(&pool->handlers[(handler->index + j) % pool->count]); j++)
+        ;
+    return 0;
+  }
+  return -1;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void send_Now(struct server_worker *worker, struct request_slot *slot, int opcode, struct message_reply *reply){
+  int sent;
+  worker->sockfd = slot->sockfd;
+  end_Handler(&slot->trace);
+  sent = sendReply(worker, &slot->cliaddr, reply);
+  count_Request(worker, opcode, slot->messageLength, sent, &slot->trace);
+  log_Request(worker, &slot->cliaddr, opcode, slot->messageLength, sent, &slot->trace);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	signalled is cleared before the queue is read, a handler that finishes after the last pop
+ *	then writes wakefd again. A reply too large for one datagram is sent as fragments.
+ *	MODIFIED ON 10/17/2026
+ *	Requests answered with fragments, or whose reply could not be allocated, are logged too
+ **************************************************
+ */
+void flush_Replies(struct server_worker *worker){
+  struct dispatch_loop *dispatch = worker->dispatch;
+  struct message_reply reply;
+  struct request_slot *slot;
+  int count = 0, sent;
+
+  atomic_store(&dispatch->signalled, 0);
+  atomic_thread_fence(memory_order_seq_cst);
+  while((slot = pop_Queue(&dispatch->done)) != NULL) {
+    if(slot->reply == NULL || slot->replyLength > fragment_Payload(worker->config->mtu)) {
+      reset_Reply(&reply);
+      add_Reply_Part(&reply, slot->reply, slot->replyLength);
+      worker->sockfd = slot->sockfd;
+      sent = slot->reply != NULL ? sendReply(worker, &slot->cliaddr, &reply) : -1;
+      count_Request(worker, slot->opcode, slot->messageLength, sent, &slot->trace);
+      log_Request(worker, &slot->cliaddr, slot->opcode, slot->messageLength, sent, &slot->trace);
+      return_Slot(dispatch, slot);
+      continue;
+    }
+    hold_Reply(&worker->packets, slot->replyLength);
+    if(count == DISPATCH_SEND_BATCH || (count > 0 && slot->sockfd != dispatch->sending[0]->sockfd)) {
+      send_Replies(worker, count);
+      count = 0;
+    }
+    dispatch->sending[count] = slot;
+    dispatch->sendIov[count].iov_base = slot->reply;
+    dispatch->sendIov[count].iov_len = slot->replyLength;
+    dispatch->sendHdr[count].msg_hdr.msg_iov = &dispatch->sendIov[count];
+    dispatch->sendHdr[count].msg_hdr.msg_iovlen = 1;
+    dispatch->sendHdr[count].msg_hdr.msg_name = &slot->cliaddr;
+    dispatch->sendHdr[count].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+    count++;
+  }
+  if(count > 0)
+    send_Replies(worker, count);
+}
+
+
+/*
+ **************************************************
+ *	sendmmsg may stop early so it is called until all are out or it fails
+ *	MODIFIED ON 10/17/2026
+ *	The replies it did not take are logged as failed sends
+ **************************************************
+ */
+void send_Replies(struct server_worker *worker, int count){
+  struct dispatch_loop *dispatch = worker->dispatch;
+  struct request_slot *slot;
+  int flushed, sent, i;
+  for(flushed = 0; flushed < count; flushed += sent) {
+    sent = sendmmsg(dispatch->sending[0]->sockfd, dispatch->sendHdr + flushed, count - flushed, 0);
+    if(sent <= 0)
+      break;
+  }
+  log_Batch(worker, count, flushed);
+  for(i = 0; i < count; i++) {
+    slot = dispatch->sending[i];
+    sent = i < flushed ? (int) dispatch->sendHdr[i].msg_len : -1;
+    count_Request(worker, slot->opcode, slot->messageLength, sent, &slot->trace);
+    log_Request(worker, &slot->cliaddr, slot->opcode, slot->messageLength, sent, &slot->trace);
+    return_Slot(dispatch, slot);
+  }
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void replies_Ready(struct event_source *source, uint64_t events){
+  uint64_t count;
+  if(read(source->fd, &count, sizeof(count)) == -1 && errno != EAGAIN)
+    fprintf(stderr, "ERROR: Cannot Read the Reply Event\n");
+  flush_Replies(source->arg);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Every slot is back on the free list once the handlers answered what this loop handed out.
+ **************************************************
+ */
+void wait_Dispatch(struct server_worker *worker){
+  struct dispatch_loop *dispatch = worker->dispatch;
+  struct pollfd wake = { .fd = dispatch->wakefd, .events = POLLIN };
+  uint64_t count;
+  flush_Replies(worker);
+  while(dispatch->freeCount < dispatch->size && !server_Stopped(worker->config)) {
+    if(poll(&wake, 1, DISPATCH_WAIT_MIL_SEC) > 0 && read(dispatch->wakefd, &count, sizeof(count)) == -1 && errno != EAGAIN)
+      break;
+    flush_Replies(worker);
+  }
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void return_Slot(struct dispatch_loop *dispatch, struct request_slot *slot){
+  struct packet_pool *packets = &slot->owner->packets;
+  free(slot->message);
+  slot->message = NULL;
+  if(slot->replyPacket == PACKET_NONE || slot->reply != packet_Data(packets, slot->replyPacket))
+    free(slot->reply);
+  release_Packets(packets, slot->reply != NULL && slot->reply == packet_Data(packets, slot->replyPacket) ? 2 : 1);
+  slot->reply = NULL;
+  if(slot != &dispatch->spare)
+    dispatch->free[dispatch->freeCount++] = slot;
+}
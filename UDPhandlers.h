@@ -0,0 +1,170 @@
+/**	@file UDPhandlers.h
+ * 	@brief Contains the function prototypes for answering requests on handler threads apart from the
+ *	server loops that receive and send them, implemented in UDPhandlers.c
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPHANDLERS_H
+#define UDPHANDLERS_H
+
+#include "UDPserver.h"
+#include "UDPlog.h"
+#include "UDPevent.h"
+#include "UDPqueue.h"
+#include <stdint.h>
+#include <errno.h>
+#include <poll.h>
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define DEFAULT_HANDLERS 0		//0 answers every request on the server loop that received it
+#define MAX_HANDLERS 64
+#define DEFAULT_QUEUE_DEPTH 256	//requests a server loop can have handed out, and the depth of every handler queue
+#define MIN_QUEUE_DEPTH 2
+#define MAX_QUEUE_DEPTH 65536
+#define DISPATCH_SEND_BATCH 64		//replies flushed per sendmmsg call
+#define DISPATCH_WAIT_MIL_SEC 10	//how often a draining server loop waiting for its replies checks the deadline
+
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+/**	@brief 	A request handed from a server loop to the handler threads and its reply on the way back.
+*			owner is the server loop that received it into its packet buffer and sends the reply through sockfd,
+*			the control messages of the datagram are in the headroom of the buffer.
+*			message is the reassembled message when the request came as fragments, NULL otherwise.
+*			reply is the gathered reply, in the packet buffer replyPacket or allocated when it is larger,
+*			NULL if it could not be. Both buffers come from the pool of the owner.
+*/
+struct request_slot {
+  struct server_worker *owner;
+  int sockfd;
+  struct sockaddr_in6 cliaddr;
+  uint32_t packet;
+  char *message;
+  int messageLength;
+  int opcode;
+  char *reply;
+  int replyLength;
+  uint32_t replyPacket;
+  struct request_trace trace;
+};
+
+/**	@brief 	The request slots of one server loop. free holds the slots that are not handed out, spare receives
+*			a datagram when none is left so it is answered busy instead of left to overflow the socket.
+*			done is where the handler threads put the answered slots, they write wakefd unless signalled
+*			shows the loop was already woken. next is the handler the next request is offered to first.
+*			receiving are the slots the headers of a recvmmsg call point into, sending those of a sendmmsg call.
+*/
+struct dispatch_loop {
+  struct request_slot *slots;
+  struct request_slot **free;
+  int size;
+  int freeCount;
+  struct request_slot spare;
+  struct request_queue done;
+  int wakefd;
+  atomic_int signalled;
+  unsigned int next;
+  struct request_slot **receiving;
+  struct iovec *recvIov;
+  struct mmsghdr *recvHdr;
+  struct request_slot *sending[DISPATCH_SEND_BATCH];
+  struct iovec sendIov[DISPATCH_SEND_BATCH];
+  struct mmsghdr sendHdr[DISPATCH_SEND_BATCH];
+};
+
+struct handler_pool;
+
+/**	@brief 	One handler thread. queue holds the requests offered to it, the others steal from it when they
+*			run out. worker is the state the commands run with, its own counters.
+*			sleeping is set while it waits on wakefd. handled and stolen count the requests it answered.
+*/
+struct handler_thread {
+  struct request_queue queue;
+  struct server_worker worker;
+  struct handler_pool *pool;
+  int index;
+  atomic_int sleeping;
+  int wakefd;
+  pthread_t thread;
+  unsigned long handled;
+  unsigned long stolen;
+} __attribute__((aligned(CACHE_LINE)));
+
+/**	@brief 	The handler threads shared by every server loop. started is the number of threads running.
+*/
+struct handler_pool {
+  int count;
+  int started;
+  atomic_int stopping;
+  struct handler_thread *handlers;
+};
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Starts the handler threads, called after the signals were blocked and before any server loop starts.
+*	@param 	config holds the number of handlers and the depth of their queues.
+*	@return returns the pool, NULL if a thread or its queue cannot be set up.
+*/
+struct handler_pool *start_Handlers(struct server_config *config);
+
+/**	@brief 	Stops the handler threads and waits for them, the requests still queued are not answered.
+*			Prints how many requests they answered. Calling it again does nothing.
+*	@param 	pool is the pool returned by start_Handlers, may be NULL.
+*	@return returns nothing.
+*/
+void stop_Handlers(struct handler_pool *pool);
+
+/**	@brief 	Stops the handler threads if they still run and frees the pool.
+*	@param 	pool is the pool returned by start_Handlers, may be NULL.
+*	@return returns nothing.
+*/
+void free_Handlers(struct handler_pool *pool);
+
+/**	@brief 	Allocates the request slots of a server loop that hands its requests to the handler threads.
+*	@param 	worker is the server loop.
+*	@return returns the slots, NULL if they cannot be allocated.
+*/
+struct dispatch_loop *create_Dispatch(struct server_worker *worker);
+
+/**	@brief 	Frees the slots of a server loop, only once the handler threads were stopped.
+*	@param 	dispatch is the dispatch_loop returned by create_Dispatch, may be NULL.
+*	@return returns nothing.
+*/
+void free_Dispatch(struct dispatch_loop *dispatch);
+
+/**	@brief 	Receives every datagram queued on a socket into free slots and offers them to the handler threads,
+*			called by the event loop when the socket becomes readable.
+*	@param 	source is the socket, its arg is the server_worker that owns it.
+*			events is the epoll event mask.
+*	@return returns nothing.
+*/
+void serve_Dispatch(struct event_source *source, uint64_t events);
+
+/**	@brief 	Sends the replies the handler threads finished, called by the event loop when they wrote wakefd.
+*	@param 	source is the wakefd of the dispatch_loop, its arg is the server_worker.
+*			events is the epoll event mask.
+*	@return returns nothing.
+*/
+void replies_Ready(struct event_source *source, uint64_t events);
+
+/**	@brief 	Waits for the replies to the requests a draining server loop handed out until the drain deadline.
+*	@param 	worker is the server loop.
+*	@return returns nothing.
+*/
+void wait_Dispatch(struct server_worker *worker);
+
+#endif
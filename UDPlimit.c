@@ -0,0 +1,313 @@
+/**	@file UDPlimit.c
+ * 	@brief Contains the function implementations of the per client rate limiting.
+ *	Every server loop keeps a token bucket per client address and command in a table of fixed
+ *	size, a request finding its bucket empty is dropped without a reply and counted.
+ *	The table belongs to one loop so it is used without locks, and a client whose datagrams
+ *	reach several SO_REUSEPORT workers has a budget with each of them.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPlimit.h"
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Finds the entry of a client, replacing an empty or the least recently seen entry
+*			of its probe window when the client is new.
+*	@param 	table is the client table.
+*			key is the client_Key of the client.
+*			now is the current limit_Clock time.
+*			counters is where an eviction is counted.
+*	@return returns the entry of the client.
+*/
+struct client_entry *find_Client(struct client_table *table, uint64_t key, uint32_t now, struct limit_counters *counters);
+
+/**	@brief 	Turns a client address into the key of its buckets. An IPv4 client is one address, an IPv6
+*			client is its /64 since a single host is usually given a whole /64 to pick addresses from.
+*	@param 	cliaddr is the client, IPv4 clients arrive as v4 mapped addresses.
+*	@return returns the key, never 0.
+*/
+uint64_t client_Key(const struct sockaddr_in6 *cliaddr);
+
+/**	@brief 	Current coarse CLOCK_MONOTONIC time, a tick of a few milli seconds is plenty for refilling buckets.
+*	@param 	no parameter is passed.
+*	@return returns the time in milli seconds.
+*/
+uint32_t limit_Clock(void);
+
+/**	@brief 	Adds one to a counter only its server loop writes.
+*	@param 	counter is the counter.
+*	@return returns nothing.
+*/
+void count_Limit(atomic_ulong *counter);
+
+/*
+ **************************************************
+ *		LIMIT FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ **************************************************
+ */
+struct rate_limits *create_Limits(int clients, int workers){
+  struct rate_limits *limits = calloc(1, sizeof(struct rate_limits));
+  if(limits == NULL) {
+	printErrorMessage("Cannot Allocate Rate Limits");
+    return NULL;
+  }
+  limits->counters = aligned_alloc(CACHE_LINE, workers * sizeof(struct limit_counters));
+  if(limits->counters == NULL) {
+	printErrorMessage("Cannot Allocate Rate Limits");
+    free(limits);
+    return NULL;
+  }
+  memset(limits->counters, 0, workers * sizeof(struct limit_counters));
+  for(limits->clients = MIN_LIMIT_CLIENTS; limits->clients < clients; limits->clients <<= 1)
+    ;
+  limits->workers = workers;
+  return limits;
+}
+
+
+/*
+ **************************************************
+ *	The commands have to be registered first, the rule is looked up by name in the dispatch table.
+ *	MODIFIED ON 10/17/2026
+ *	A burst is at most MAX_LIMIT_BURST so a full bucket still runs out
+ **************************************************
+ */
+int add_Limit(struct rate_limits *limits, const char *text){
+  char name[MAX_COMMAND_NAME];
+  const char *equals = strchr(text, '=');
+  char *end;
+  long rate, burst;
+  int opcode;
+
+  if(equals == NULL || equals == text || equals - text >= MAX_COMMAND_NAME)
+    return -1;
+  memcpy(name, text, equals - text);
+  name[equals - text] = '\0';
+  opcode = strcasecmp(name, "error") == 0 ? OPCODE_ERROR : command_Opcode(name);
+  if(opcode < 0 || opcode >= LIMIT_OPCODES)
+    return -1;
+  rate = strtol(equals + 1, &end, 10);
+  burst = rate < MAX_LIMIT_BURST ? rate : MAX_LIMIT_BURST;
+  if(*end == '/')
+    burst = strtol(end + 1, &end, 10);
+  if(*end != '\0' || rate < 1 || rate > 1000000000 || burst < 1 || burst > MAX_LIMIT_BURST)
+    return -1;
+
+  snprintf(limits->rule[opcode].name, MAX_COMMAND_NAME, "%s", name);
+  limits->rule[opcode].rate = rate;
+  limits->rule[opcode].burst = burst;
+  return 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void print_Limits(struct rate_limits *limits){
+  char text[LIMIT_REPLY_MAX];
+  if(limits == NULL)
+    return;
+  render_Limits(limits, text);
+  printf("Rate Limits : %s\n", text);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void free_Limits(struct rate_limits *limits){
+  if(limits == NULL)
+    return;
+  free(limits->counters);
+  free(limits);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+struct client_table *create_Client_Table(int clients){
+  struct client_table *table = calloc(1, sizeof(struct client_table));
+  if(table == NULL || (table->entries = calloc(clients, sizeof(struct client_entry))) == NULL) {
+	printErrorMessage("Cannot Allocate Client Table");
+    free(table);
+    return NULL;
+  }
+  table->mask = clients - 1;
+  for(table->shift = 32; clients > 1; clients >>= 1)
+    table->shift--;
+  if(getrandom(&table->seed, sizeof(table->seed), 0) != sizeof(table->seed))
+    table->seed = (uint32_t) log_Clock();
+  return table;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void free_Client_Table(struct client_table *table){
+  if(table == NULL)
+    return;
+  free(table->entries);
+  free(table);
+}
+
+
+/*
+ **************************************************
+ *	Commands without a rule cost nothing but the check of their rate.
+ **************************************************
+ */
+int allow_Request(struct server_worker *worker, struct sockaddr_in6 *cliaddr, int opcode){
+  struct rate_limits *limits = worker->config->limits;
+  struct limit_counters *counters = &limits->counters[worker->id];
+  struct limit_rule *rule;
+  struct client_entry *client;
+  struct limit_bucket *bucket;
+  uint32_t now;
+
+  if(opcode >= LIMIT_OPCODES || limits->rule[opcode].rate == 0)
+    return 1;
+  rule = &limits->rule[opcode];
+  now = limit_Clock();
+  client = find_Client(worker->clients, client_Key(cliaddr), now, counters);
+  bucket = &client->bucket[opcode];
+
+  //refill for the time since the last request, a full bucket stays full
+  bucket->tokens += (float) (now - bucket->stamp) * rule->rate / 1000.0f;
+  if(bucket->tokens > rule->burst)
+    bucket->tokens = rule->burst;
+  bucket->stamp = now;
+  if(bucket->tokens < 1.0f) {
+    count_Limit(&counters->dropped[opcode]);
+    return 0;
+  }
+  bucket->tokens -= 1.0f;
+  return 1;
+}
+
+
+/*
+ **************************************************
+ *	MODIFIED ON 10/17/2026
+ *	LIMIT_REPLY_MAX holds every command limited with a 20 digit count, a reply that still does not fit
+ *	is sent as an error rather than cut off before its closing tag.
+ **************************************************
+ */
+int render_Limits(struct rate_limits *limits, char *text){
+  unsigned long clients = 0, evicted = 0, dropped;
+  int length, opcode, i;
+
+  for(i = 0; i < limits->workers; i++) {
+    clients += atomic_load_explicit(&limits->counters[i].clients, memory_order_relaxed);
+    evicted += atomic_load_explicit(&limits->counters[i].evicted, memory_order_relaxed);
+  }
+  length = append_Text(text, 0, LIMIT_REPLY_MAX, "<replyLimits clients=\"%lu\" evicted=\"%lu\">", clients, evicted);
+  for(opcode = 0; opcode < LIMIT_OPCODES; opcode++) {
+    if(limits->rule[opcode].rate == 0)
+      continue;
+    for(i = 0, dropped = 0; i < limits->workers; i++)
+      dropped += atomic_load_explicit(&limits->counters[i].dropped[opcode], memory_order_relaxed);
+    length = append_Text(text, length, LIMIT_REPLY_MAX, "<%s>%lu</%s>",
+                         limits->rule[opcode].name, dropped, limits->rule[opcode].name);
+  }
+  length = append_Text(text, length, LIMIT_REPLY_MAX, "</replyLimits>");
+  if(length == -1)
+    length = snprintf(text, LIMIT_REPLY_MAX, "<error>limits do not fit in a reply</error>");
+  return length;
+}
+
+
+/*
+ **************************************************
+ *	Entries are never emptied, only replaced, so a lookup can stop at the first empty slot.
+ *	A new client starts with full buckets.
+ **************************************************
+ */
+struct client_entry *find_Client(struct client_table *table, uint64_t key, uint32_t now, struct limit_counters *counters){
+  uint32_t slot = ((key ^ table->seed) * LIMIT_HASH) >> (32 + table->shift);
+  struct client_entry *entry, *oldest = NULL;
+  int i;
+
+  for(i = 0; i < LIMIT_PROBE; i++) {
+    entry = &table->entries[(slot + i) & table->mask];
+    if(entry->key == key) {
+      entry->seen = now;
+      return entry;
+    }
+    if(entry->key == 0) {
+      count_Limit(&counters->clients);
+      oldest = entry;
+      break;
+    }
+    if(oldest == NULL || (int32_t) (now - entry->seen) > (int32_t) (now - oldest->seen))
+      oldest = entry;
+  }
+  if(oldest->key != 0)
+    count_Limit(&counters->evicted);
+
+  memset(oldest, 0, sizeof(struct client_entry));
+  oldest->key = key;
+  oldest->seen = now;
+  for(i = 0; i < LIMIT_OPCODES; i++) {
+    oldest->bucket[i].tokens = 1e9f; //trimmed to the burst of its command on first use
+    oldest->bucket[i].stamp = now;
+  }
+  return oldest;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	A /64 that is all zero, like ::1, is keyed by its low half instead.
+ **************************************************
+ */
+uint64_t client_Key(const struct sockaddr_in6 *cliaddr){
+  uint64_t high, low;
+  uint32_t v4;
+  if(IN6_IS_ADDR_V4MAPPED(&cliaddr->sin6_addr)) {
+    memcpy(&v4, &cliaddr->sin6_addr.s6_addr[12], sizeof(v4));
+    return LIMIT_IPV4_KEY | ntohl(v4);
+  }
+  memcpy(&high, &cliaddr->sin6_addr.s6_addr[0], sizeof(high));
+  memcpy(&low, &cliaddr->sin6_addr.s6_addr[8], sizeof(low));
+  if(high != 0)
+    return high;
+  return low != 0 ? low : 1;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+uint32_t limit_Clock(void){
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+  return (uint32_t) (now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void count_Limit(atomic_ulong *counter){
+  atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + 1, memory_order_relaxed);
+}
@@ -0,0 +1,157 @@
+/**	@file UDPlimit.h
+ * 	@brief Contains the function prototypes for the per client rate limiting of the UDP server
+ *	that are implemented in UDPlimit.c
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPLIMIT_H
+#define UDPLIMIT_H
+
+#include "UDPserver.h"
+#include "UDPlog.h"
+#include "UDPdispatch.h"
+#include <stdint.h>
+#include <time.h>
+#include <sys/random.h>
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define DEFAULT_LIMIT_CLIENTS 4096	//clients remembered per server loop, rounded up to a power of two
+#define MIN_LIMIT_CLIENTS 16
+#define MAX_LIMIT_CLIENTS (1 << 20)
+#define LIMIT_PROBE 8			//slots a client can be stored in, the least recently seen of them is evicted
+#define LIMIT_OPCODES 8			//message_opcode values that can be limited
+#define LIMIT_HASH 0x9E3779B97F4A7C15ULL
+#define LIMIT_IPV4_KEY 0xFFFF00000000ULL	//IPv4 addresses are keyed by the address under this mark
+#define LIMIT_REPLY_MAX MAX_REPLY_TEXT
+#define MAX_LIMIT_BURST (1 << 24)	//tokens are a float, above this taking one away leaves the count unchanged
+
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+/**	@brief 	The budget of one command for every client. rate is the number of requests per second
+*			that are refilled, burst the number a client that was quiet can send at once.
+*			A rate of 0 leaves the command unlimited.
+*/
+struct limit_rule {
+  char name[MAX_COMMAND_NAME];
+  int rate;
+  int burst;
+};
+
+/**	@brief 	The tokens one client has left for one command and when they were last refilled.
+*/
+struct limit_bucket {
+  float tokens;
+  uint32_t stamp;		//milli seconds of the coarse monotonic clock
+};
+
+/**	@brief 	One client in the table, key is made by client_Key and 0 marks an empty slot.
+*/
+struct client_entry {
+  uint64_t key;
+  uint32_t seen;		//milli seconds, used to pick the entry to evict
+  struct limit_bucket bucket[LIMIT_OPCODES];
+};
+
+/**	@brief 	Open addressing table of the clients one server loop has seen. Its size is fixed when
+*			it is created, a new client takes an empty slot of its probe window or the one seen the longest ago.
+*			seed is random so the slots of an address cannot be predicted, and the slot is taken from
+*			the top bits of the hash since the low bits of a product only depend on the low bits of the key.
+*			shift is 32 less the number of those bits.
+*/
+struct client_table {
+  struct client_entry *entries;
+  uint32_t mask;
+  uint32_t shift;
+  uint32_t seed;
+};
+
+/**	@brief 	What one server loop dropped, only that loop writes them so they need no locked updates.
+*/
+struct limit_counters {
+  atomic_ulong dropped[LIMIT_OPCODES];
+  atomic_ulong evicted;
+  atomic_ulong clients;
+} __attribute__((aligned(CACHE_LINE)));
+
+/**	@brief 	The limits chosen on the command line and the counters of every server loop.
+*/
+struct rate_limits {
+  struct limit_rule rule[LIMIT_OPCODES];
+  int clients;
+  int workers;
+  struct limit_counters *counters;
+};
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Creates the limits with every command unlimited.
+*	@param 	clients is the number of clients each server loop remembers.
+*			workers is the number of server loops.
+*	@return returns the limits, NULL if they cannot be allocated.
+*/
+struct rate_limits *create_Limits(int clients, int workers);
+
+/**	@brief 	Sets the budget of a command from a rule given as <command>=<rate>[/<burst>].
+*			The command is a registered command name or error for messages that are not a command.
+*			burst is at most MAX_LIMIT_BURST, without one it is the rate up to MAX_LIMIT_BURST.
+*	@param 	limits is the limits to change.
+*			text is the rule.
+*	@return returns 0 on success, -1 when the rule is not valid.
+*/
+int add_Limit(struct rate_limits *limits, const char *text);
+
+/**	@brief 	Prints the number of requests each limited command dropped.
+*	@param 	limits is the limits, may be NULL.
+*	@return returns nothing.
+*/
+void print_Limits(struct rate_limits *limits);
+
+/**	@brief 	Frees the limits.
+*	@param 	limits is the limits returned by create_Limits, may be NULL.
+*	@return returns nothing.
+*/
+void free_Limits(struct rate_limits *limits);
+
+/**	@brief 	Allocates the client table of one server loop.
+*	@param 	clients is the number of slots, a power of two.
+*	@return returns the table, NULL if it cannot be allocated.
+*/
+struct client_table *create_Client_Table(int clients);
+
+/**	@brief 	Frees a client table.
+*	@param 	table is the table, may be NULL.
+*	@return returns nothing.
+*/
+void free_Client_Table(struct client_table *table);
+
+/**	@brief 	Takes a token from the bucket the client has for a command.
+*	@param 	worker is the server loop that received the request, it owns the client table.
+*			cliaddr is the client.
+*			opcode is the message_opcode the request was recognised as.
+*	@return returns 1 if the request is answered, 0 if it is dropped.
+*/
+int allow_Request(struct server_worker *worker, struct sockaddr_in6 *cliaddr, int opcode);
+
+/**	@brief 	Writes the drop counters of every server loop as a <replyLimits> reply.
+*	@param 	limits is the limits.
+*			text is where the reply is written, LIMIT_REPLY_MAX bytes.
+*	@return returns the length of the reply.
+*/
+int render_Limits(struct rate_limits *limits, char *text);
+
+#endif
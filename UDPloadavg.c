@@ -0,0 +1,125 @@
+/**	@file UDPloadavg.c
+ * 	@brief Contains the function implementations of the cached load average sampler.
+ *	A timer of the first event loop reads /proc/loadavg on a fixed interval and renders the whole 
+ *	<replyLoadAvg> reply into the spare one of two slots before publishing it, so 
+ *	answering <loadavg/> is a load of the current slot and a send.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPloadavg.h"
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Reads the 1, 5 and 15 minute load averages from /proc/loadavg.
+*	@param 	fd is the open /proc/loadavg file or -1 to fall back to getloadavg.
+*			loadAvg is where the three figures are written.
+*	@return returns 0 on success, -1 when the figures could not be read.
+*/
+int read_Loadavg(int fd, double loadAvg[LOAD_AVG_FUNCTION]);
+
+/*
+ **************************************************
+ *		LOADAVG FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ **************************************************
+ */
+struct loadavg_sampler *start_Loadavg(int interval, int stamp){
+  struct loadavg_sampler *sampler = calloc(1, sizeof(struct loadavg_sampler));
+  if(sampler == NULL) {
+	printErrorMessage("Cannot Allocate Load Average Sampler");
+    return NULL;
+  }
+  sampler->interval = interval;
+  sampler->stamp = stamp;
+  sampler->fd = open(LOADAVG_PATH, O_RDONLY | O_CLOEXEC); //kept open, every sample is one pread
+  sample_Loadavg(sampler); //the first reply is ready before any server loop starts
+  return sampler;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void stop_Loadavg(struct loadavg_sampler *sampler){
+  if(sampler == NULL)
+    return;
+  if(sampler->fd >= 0)
+    close(sampler->fd);
+  free(sampler);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+struct loadavg_slot *current_Loadavg(struct loadavg_sampler *sampler){
+  return &sampler->slot[atomic_load_explicit(&sampler->current, memory_order_acquire)];
+}
+
+
+/*
+ **************************************************
+ *	Only the timer of the first event loop writes the slots. The spare slot was retired one interval ago,
+ *	which is far longer than a server loop holds on to a reply before sending it.
+ *	MODIFIED ON 10/17/2026
+ *	Also renders the payload of the binary reply
+ **************************************************
+ */
+void sample_Loadavg(struct loadavg_sampler *sampler){
+  int next = !atomic_load_explicit(&sampler->current, memory_order_relaxed);
+  struct loadavg_slot *slot = &sampler->slot[next];
+  double loadAvg[LOAD_AVG_FUNCTION] = {0.0, 0.0, 0.0};
+  struct timespec now;
+  int failed;
+  
+  clock_gettime(CLOCK_REALTIME, &now);
+  slot->sampled = (uint64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+  failed = read_Loadavg(sampler->fd, loadAvg) < 0;
+  if(failed)
+    slot->length = snprintf(slot->text, LOADAVG_REPLY_MAX, "<error>unable to obtain load average</error>");
+  else if(sampler->stamp)
+    slot->length = snprintf(slot->text, LOADAVG_REPLY_MAX, "<replyLoadAvg sampled=\"%llu\">%f:%f:%f</replyLoadAvg>",
+                            (unsigned long long) slot->sampled, loadAvg[LOAD_AVG_1_MIN_INDEX], 
+                            loadAvg[LOAD_AVG_5_MIN_INDEX], loadAvg[LOAD_AVG_15_MIN_INDEX]);
+  else
+    slot->length = snprintf(slot->text, LOADAVG_REPLY_MAX, "<replyLoadAvg>%f:%f:%f</replyLoadAvg>",
+                            loadAvg[LOAD_AVG_1_MIN_INDEX], loadAvg[LOAD_AVG_5_MIN_INDEX], loadAvg[LOAD_AVG_15_MIN_INDEX]);
+  if(slot->length >= LOADAVG_REPLY_MAX)
+    slot->length = LOADAVG_REPLY_MAX - 1;
+  //the binary reply is rendered as well, so neither form is formatted per request
+  write_Binary_Loadavg(slot->binary, loadAvg, slot->sampled);
+  slot->binaryLength = failed ? 0 : BINARY_LOADAVG_SIZE;
+  atomic_store_explicit(&sampler->current, next, memory_order_release);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int read_Loadavg(int fd, double loadAvg[LOAD_AVG_FUNCTION]){
+  char text[LOADAVG_REPLY_MAX];
+  ssize_t length;
+  if(fd < 0)
+    return getloadavg(loadAvg, LOAD_AVG_FUNCTION) < LOAD_AVG_FUNCTION ? -1 : 0;
+  length = pread(fd, text, sizeof(text) - 1, 0);
+  if(length <= 0)
+    return -1;
+  text[length] = '\0';
+  if(sscanf(text, "%lf %lf %lf", &loadAvg[LOAD_AVG_1_MIN_INDEX], &loadAvg[LOAD_AVG_5_MIN_INDEX], 
+            &loadAvg[LOAD_AVG_15_MIN_INDEX]) != LOAD_AVG_FUNCTION)
+    return -1;
+  return 0;
+}
@@ -0,0 +1,92 @@
+/**	@file UDPloadavg.h
+ * 	@brief Contains the function prototypes for the cached load average sampler of the UDP server
+ *	that are implemented in UDPloadavg.c
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPLOADAVG_H
+#define UDPLOADAVG_H
+
+#include "UDPserver.h"
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define LOADAVG_PATH "/proc/loadavg"
+#define DEFAULT_LOADAVG_MIL_SEC 1000
+#define MIN_LOADAVG_MIL_SEC 10	//a retired slot is rewritten one interval later, far after its reply was sent
+#define MAX_LOADAVG_MIL_SEC 60000
+#define LOADAVG_SLOTS 2
+#define LOADAVG_REPLY_MAX 128
+
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+/**	@brief 	One pre rendered <replyLoadAvg> reply, or the error reply when the sample failed.
+*			binary is the payload of the binary reply, binaryLength is 0 when the sample failed.
+*			sampled is the CLOCK_REALTIME time in milli seconds the figures were read.
+*/
+struct loadavg_slot {
+  char text[LOADAVG_REPLY_MAX];
+  int length;
+  char binary[BINARY_LOADAVG_SIZE];
+  int binaryLength;
+  uint64_t sampled;
+};
+
+/**	@brief 	The sampler and its two reply slots. A timer of the first event loop renders into the slot
+*			that is not current and then publishes it, so a request only loads the current index.
+*			stamp adds the sampled time to the reply as a sampled="<ms>" attribute.
+*/
+struct loadavg_sampler {
+  struct loadavg_slot slot[LOADAVG_SLOTS];
+  atomic_int current;
+  int fd;
+  int interval;
+  int stamp;
+};
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Takes the first sample, run_Server refreshes it every interval from a timer.
+*	@param 	interval is the time between samples in milli seconds.
+*			stamp is 1 to add the sampled time to the reply.
+*	@return returns the sampler, NULL if it cannot be allocated.
+*/
+struct loadavg_sampler *start_Loadavg(int interval, int stamp);
+
+/**	@brief 	Frees the sampler once no server loop is running.
+*	@param 	sampler is the sampler returned by start_Loadavg, may be NULL.
+*	@return returns nothing.
+*/
+void stop_Loadavg(struct loadavg_sampler *sampler);
+
+/**	@brief 	Reads the load average and renders the reply into the slot that is not current,
+*			then makes it the current slot.
+*	@param 	sampler is the sampler to refresh.
+*	@return returns nothing.
+*/
+void sample_Loadavg(struct loadavg_sampler *sampler);
+
+/**	@brief 	Get the latest pre rendered reply. The slot stays valid for at least one interval.
+*	@param 	sampler is the sampler returned by start_Loadavg.
+*	@return returns the slot holding the reply.
+*/
+struct loadavg_slot *current_Loadavg(struct loadavg_sampler *sampler);
+
+#endif
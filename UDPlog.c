@@ -0,0 +1,308 @@
+/**	@file UDPlog.c
+ * 	@brief Contains the function implementations of the asynchronous request log.
+ *	Every server loop pushes fixed size records into its own lock free ring and a 
+ *	background thread drains the rings to stdout or a file as text lines or raw records, 
+ *	so the network loop never waits on terminal or file output.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPlog.h"
+#include "UDPdispatch.h"
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Thread entry point, drains the rings until the log is stopped.
+*	@param 	arg is the server_log structure.
+*	@return returns NULL. 
+*/
+void *log_Thread(void *arg);
+
+/**	@brief 	Writes out every record queued in every ring.
+*	@param 	log is the log to drain.
+*	@return returns the number of records written.
+*/
+int drain_Log(struct server_log *log);
+
+/**	@brief 	Writes one record as a line of text.
+*	@param 	out is the stream to write to.
+*			record is the record to write.
+*	@return returns nothing.
+*/
+void print_Record(FILE *out, struct log_record *record);
+
+/**	@brief 	Queues a record in a ring. 
+*	@param 	ring is the ring of the calling server loop.
+*			record is the record to copy into the ring.
+*	@return returns nothing.
+*/
+void push_Record(struct log_ring *ring, struct log_record *record);
+
+/**	@brief 	Narrows the time of a stage to a record field.
+*	@param 	time is the time in nano seconds.
+*	@return returns the time, UINT32_MAX for anything slower.
+*/
+uint32_t trace_Time(uint64_t time);
+
+/*
+ **************************************************
+ *		LOG FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ **************************************************
+ */
+struct server_log *start_Log(int verbosity, int binary, char *path, int rings){
+  struct server_log *log;
+  if(verbosity == LOG_OFF)
+    return NULL;
+  
+  log = calloc(1, sizeof(struct server_log));
+  if(log == NULL || posix_memalign((void **) &log->ring, CACHE_LINE, rings * sizeof(struct log_ring)) != 0) {
+	printErrorMessage("Cannot Allocate Log Rings");
+    free(log);
+    return NULL;
+  }
+  memset(log->ring, 0, rings * sizeof(struct log_ring));
+  log->verbosity = verbosity;
+  log->binary = binary;
+  log->rings = rings;
+  log->out = stdout;
+  if(path != NULL && (log->out = fopen(path, binary ? "wb" : "w")) == NULL)
+	printErrorMessage("Cannot Open Log File");
+  else {
+    atomic_store(&log->running, 1);
+    if(pthread_create(&log->thread, NULL, log_Thread, log) == 0)
+      return log;
+	printErrorMessage("Cannot Start Log Thread");
+    if(log->out != stdout)
+      fclose(log->out);
+  }
+  free(log->ring);
+  free(log);
+  return NULL;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void stop_Log(struct server_log *log){
+  int i;
+  unsigned long dropped = 0;
+  if(log == NULL)
+    return;
+  atomic_store(&log->running, 0);
+  pthread_join(log->thread, NULL);
+  
+  for(i = 0; i < log->rings; i++)
+    dropped += atomic_load(&log->ring[i].dropped);
+  if(dropped > 0)
+    fprintf(stderr, "Log dropped %lu record(s) because it could not keep up\n", dropped);
+  
+  if(log->out != stdout)
+    fclose(log->out);
+  else
+    fflush(stdout);
+  free(log->ring);
+  free(log);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+struct log_ring *log_Ring(struct server_log *log, int id){
+  if(log == NULL || id >= log->rings)
+    return NULL;
+  return &log->ring[id];
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+uint64_t log_Clock(void){
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+
+/*
+ **************************************************
+ *	Only plain stores go into the record, turning the address into text is left to the log thread.
+ *	MODIFIED ON 10/17/2026
+ *	Also records the stages of a traced request, a binary log of them is the trace file
+ *	MODIFIED ON 10/17/2026
+ *	A failed send is flagged instead of stored as a length
+ **************************************************
+ */
+void log_Request(struct server_worker *worker, struct sockaddr_in6 *cliaddr, int opcode,
+                 int requestLength, int replyLength, const struct request_trace *trace){
+  struct log_record record;
+  struct timespec now;
+  uint64_t completed;
+  if(worker->log == NULL || worker->config->log->verbosity < LOG_REQUESTS)
+    return;
+  clock_gettime(CLOCK_REALTIME, &now);
+  completed = log_Clock();
+  record.timestamp = (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+  record.latency = completed - trace->received;
+  memcpy(record.clientAddr, &cliaddr->sin6_addr, sizeof(record.clientAddr));
+  record.clientPort = cliaddr->sin6_port;
+  record.type = LOG_RECORD_REQUEST;
+  record.opcode = opcode;
+  record.worker = worker->id;
+  record.requestLength = requestLength;
+  record.replyLength = replyLength < 0 ? 0 : replyLength;
+  record.flags = replyLength < 0 ? LOG_FLAG_SEND_FAILED : 0;
+  record.queueTime = record.serviceTime = record.sendTime = 0;
+  if(trace->handled != 0) {
+    record.queueTime = trace->queued == TRACE_UNKNOWN ? 0 : trace_Time(trace->queued);
+    record.serviceTime = trace_Time(trace->handled - trace->dispatched);
+    record.sendTime = trace_Time(completed - trace->handled);
+  }
+  push_Record(worker->log, &record);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void log_Batch(struct server_worker *worker, int received, int sent){
+  struct log_record record;
+  struct timespec now;
+  if(worker->log == NULL)
+    return;
+  clock_gettime(CLOCK_REALTIME, &now);
+  memset(&record, 0, sizeof(record));
+  record.timestamp = (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+  record.type = LOG_RECORD_BATCH;
+  record.worker = worker->id;
+  record.requestLength = received;
+  record.replyLength = sent;
+  push_Record(worker->log, &record);
+}
+
+
+/*
+ **************************************************
+ *	The producer only reads tail to see if there is room, so a full ring costs one load.
+ **************************************************
+ */
+void push_Record(struct log_ring *ring, struct log_record *record){
+  size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  if(head - tail >= LOG_RING_SIZE) {
+    atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+    return;
+  }
+  ring->records[head & (LOG_RING_SIZE - 1)] = *record;
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+
+/*
+ **************************************************
+ *	Sleeps LOG_DRAIN_MIL_SEC whenever all rings are empty, 
+ *	and drains one last time after running is cleared.
+ **************************************************
+ */
+void *log_Thread(void *arg){
+  struct server_log *log = arg;
+  struct timespec nap = { 0, LOG_DRAIN_MIL_SEC * 1000000L };
+  while(atomic_load(&log->running)) {
+    if(drain_Log(log) == 0) {
+      fflush(log->out);
+      nanosleep(&nap, NULL);
+    }
+  }
+  drain_Log(log);
+  return NULL;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int drain_Log(struct server_log *log){
+  int i, written = 0;
+  size_t head, tail;
+  struct log_ring *ring;
+  struct log_record *record;
+  for(i = 0; i < log->rings; i++) {
+    ring = &log->ring[i];
+    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    for(; tail != head; tail++, written++) {
+      record = &ring->records[tail & (LOG_RING_SIZE - 1)];
+      if(log->binary)
+        fwrite(record, sizeof(struct log_record), 1, log->out);
+      else
+        print_Record(log->out, record);
+    }
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+  }
+  return written;
+}
+
+
+/*
+ **************************************************
+ *	MODIFIED ON 10/17/2026
+ *	Commands are named by the dispatch table, every registered command is logged by its name
+ **************************************************
+ */
+void print_Record(FILE *out, struct log_record *record){
+  const char *name = record->opcode == OPCODE_ERROR ? "error" : command_Name(record->opcode);
+  char stamp[32], addr[MAX_ADDRESS_TEXT];
+  time_t seconds = record->timestamp / 1000000000ULL;
+  struct tm local;
+  struct in6_addr inaddr;
+  
+  localtime_r(&seconds, &local);
+  strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+  if(record->type == LOG_RECORD_BATCH) {
+    fprintf(out, "%s.%06lu worker %u batch moved %u datagram(s) in, %u datagram(s) out\n", stamp,
+            (unsigned long) (record->timestamp % 1000000000ULL) / 1000, record->worker,
+            record->requestLength, record->replyLength);
+    return;
+  }
+  memcpy(&inaddr, record->clientAddr, sizeof(inaddr));
+  format_Address(&inaddr, ntohs(record->clientPort), addr, sizeof(addr));
+  fprintf(out, "%s.%06lu worker %u %s %s in %u out ", stamp,
+          (unsigned long) (record->timestamp % 1000000000ULL) / 1000, record->worker, addr,
+          name != NULL ? name : "unknown", record->requestLength);
+  if(record->flags & LOG_FLAG_SEND_FAILED)
+    fprintf(out, "failed");
+  else
+    fprintf(out, "%u", record->replyLength);
+  fprintf(out, " latency %.1f us", record->latency / 1000.0);
+  if(record->queueTime != 0)
+    fprintf(out, " queue %.1f us", record->queueTime / 1000.0);
+  if(record->serviceTime != 0 || record->sendTime != 0)
+    fprintf(out, " service %.1f us send %.1f us", record->serviceTime / 1000.0, record->sendTime / 1000.0);
+  fputc('\n', out);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+uint32_t trace_Time(uint64_t time){
+  return time > UINT32_MAX ? UINT32_MAX : (uint32_t) time;
+}
@@ -0,0 +1,139 @@
+/**	@file UDPlog.h
+ * 	@brief Contains the function prototypes for the asynchronous request log of the UDP server
+ *	that are implemented in UDPlog.c
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPLOG_H
+#define UDPLOG_H
+
+#include "UDPserver.h"
+#include <stdint.h>
+#include <time.h>
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define LOG_RING_SIZE 4096	//records per ring, must be a power of two
+#define LOG_DRAIN_MIL_SEC 10
+#define LOG_OFF 0
+#define LOG_BATCHES 1
+#define LOG_REQUESTS 2
+#define DEFAULT_LOG_VERBOSITY LOG_REQUESTS
+#define LOG_RECORD_REQUEST 0
+#define LOG_RECORD_BATCH 1
+#define LOG_FLAG_SEND_FAILED 0x1	//the reply of a request record could not be sent, replyLength is 0
+#define CACHE_LINE 64
+
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+/**	@brief 	One fixed size log record, written as is in binary mode.
+*			For a request record opcode is a message_opcode, the lengths are the datagram sizes and 
+*			latency is the time from receiving the request to sending the reply.
+*			A traced request also has the nano seconds of its stages, queueTime is 0 when the kernel did not
+*			stamp the datagram and all three are 0 when tracing is off. They are capped at UINT32_MAX.
+*			flags holds LOG_FLAG bits of a request record.
+*			For a batch record requestLength and replyLength are the number of datagrams 
+*			received and sent by one recvmmsg/sendmmsg round.
+*/
+struct log_record {
+  uint64_t timestamp;		//CLOCK_REALTIME in nanoseconds
+  uint64_t latency;		//nanoseconds
+  uint8_t clientAddr[16];	//IPv6 address, IPv4 clients are v4 mapped
+  uint16_t clientPort;		//network byte order
+  uint8_t type;
+  uint8_t opcode;
+  uint32_t worker;
+  uint32_t requestLength;
+  uint32_t replyLength;
+  uint32_t queueTime;
+  uint32_t serviceTime;
+  uint32_t sendTime;
+  uint32_t flags;
+};
+
+/**	@brief 	Lock free single producer, single consumer ring of log records.
+*			The server loop owning the ring moves head, the log thread moves tail.
+*			A record is dropped and counted instead of waiting when the ring is full.
+*/
+struct log_ring {
+  _Alignas(CACHE_LINE) atomic_size_t head;
+  _Alignas(CACHE_LINE) atomic_size_t tail;
+  _Alignas(CACHE_LINE) atomic_ulong dropped;
+  struct log_record records[LOG_RING_SIZE];
+};
+
+/**	@brief 	The log thread and the rings it drains, one ring per server loop.
+*/
+struct server_log {
+  int verbosity;
+  int binary;
+  FILE *out;
+  int rings;
+  struct log_ring *ring;
+  pthread_t thread;
+  atomic_int running;
+};
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Creates the rings and starts the background thread that writes them out.
+*	@param 	verbosity is LOG_OFF, LOG_BATCHES or LOG_REQUESTS.
+*			binary is 1 to write raw log_record structures instead of text lines.
+*			path is the file to write to or NULL for stdout.
+*			rings is the number of server loops that will log.
+*	@return returns the log, NULL when verbosity is LOG_OFF or the log cannot be started.
+*/
+struct server_log *start_Log(int verbosity, int binary, char *path, int rings);
+
+/**	@brief 	Stops the log thread after it wrote out every queued record and frees the log.
+*	@param 	log is the log returned by start_Log, may be NULL.
+*	@return returns nothing.
+*/
+void stop_Log(struct server_log *log);
+
+/**	@brief 	Get the ring a server loop should write to.
+*	@param 	log is the log returned by start_Log, may be NULL.
+*			id is the number of the server loop.
+*	@return returns the ring or NULL when logging is off.
+*/
+struct log_ring *log_Ring(struct server_log *log, int id);
+
+/**	@brief 	Current CLOCK_MONOTONIC time used to measure request latency.
+*	@param 	no parameter is passed. 
+*	@return returns the time in nanoseconds.
+*/
+uint64_t log_Clock(void);
+
+/**	@brief 	Queues a request record. Never blocks, the record is counted as dropped if the ring is full.
+*	@param 	worker is the server loop that handled the request.
+*			cliaddr is the client the request came from.
+*			opcode is the command the request was recognised as.
+*			requestLength and replyLength are the datagram sizes in bytes, replyLength is -1 when the send failed.
+*			trace is the stamps of the request, the send completed now.
+*	@return returns nothing.
+*/
+void log_Request(struct server_worker *worker, struct sockaddr_in6 *cliaddr, int opcode,
+                 int requestLength, int replyLength, const struct request_trace *trace);
+
+/**	@brief 	Queues a record with the number of datagrams one batched round moved.
+*	@param 	worker is the server loop that ran the batch.
+*			received and sent are the datagram counts of recvmmsg and sendmmsg.
+*	@return returns nothing.
+*/
+void log_Batch(struct server_worker *worker, int received, int sent);
+
+#endif
@@ -8,54 +8,205 @@
  */
 
  
+#include "UDPclient.h"	//first, it turns on the GNU extensions the system headers need for sendmmsg
+#include "UDPbench.h"
+#include "UDPpipeline.h"
+#include "UDPbalance.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <netinet/in.h>
 #include <unistd.h>
-#include "UDPclient.h"
+
+/**	@brief 	Sends every line of stdin through a request pipeline and prints the responses
+*			as they arrive, which may be in a different order than the requests.
+*	@param 	sockfd is the socket made by createSocket.
+*			servaddr is the server's address information.
+*			depth is the largest number of requests in flight.
+*			timeout is the milli seconds after which a request is reported as timed out.
+*			retries is the number of times an idempotent request is sent again before it times out.
+*			hedge is the hedge delay of setRetryPolicy.
+*			pool is the servers the requests are spread over, NULL to send them all to servaddr.
+*			message is a buffer of size + 1 bytes the lines are read into.
+*			size is the largest request.
+*	@return returns 0 if every request got a response, 1 if some timed out, -1 on error.
+*/
+int sendPipelined(int sockfd, struct sockaddr_in6 *servaddr, int depth, int timeout, int retries, int hedge, struct server_pool *pool, char *message, int size);
+
+/**	@brief 	Sends one request through a pipeline of one so it is retransmitted and hedged, and prints
+*			its response like receiveResponse with how often it was sent.
+*	@param 	sockfd is the socket made by createSocket.
+*			servaddr is the server's address information.
+*			timeout is the milli seconds until the first retransmission.
+*			retries is the number of times the request is sent again before it times out.
+*			hedge is the hedge delay of setRetryPolicy.
+*			pool is the servers the request may go to, NULL to send it to servaddr.
+*			message is the request.
+*	@return returns 0 if the request got a response, 1 if it timed out, -1 on error.
+*/
+int sendRetried(int sockfd, struct sockaddr_in6 *servaddr, int timeout, int retries, int hedge, struct server_pool *pool, char *message);
 
 /*
  * A test program to start a client and connect it to a specified server.
- * Usage: client <hostname> <portnum>
+ * Usage: client [-c] [-m <size>] [-T <timeout ms>] [-b | [-P <depth>] [-R <retries>] [-D <hedge ms>]] <hostname> <portnum>
+ *        client -B [-c | -b] [-t <threads>] [-i <inflight>] [-r <rate>] [-d <seconds>] [-T <timeout ms>]
+ *                  [-l <loadavg percent>] [-H <repeat percent>] [-X <reject percent>] [-s <size,size,...>] [-j <json file>]
+ *                  <hostname> <portnum>
+ *        client -C [-s <size,size,...>]
  *    client is this client program
- *    <hostname> IP address or name of a host that runs the server
+ *    -c sends the request as a null padded 256 byte frame for old servers,
+ *       with -B every text request is padded
+ *    -b sends the request in the binary form and prints the reply as the server's text reply,
+ *       with -B every request is binary and matched to its reply by the ID in the header
+ *    -m is the largest message and response in bytes, 256 by default
+ *    -P sends every line of stdin as a request with a correlation ID, keeping up to <depth>
+ *       requests in flight on the socket, and prints each response with the ID it belongs to
+ *    -T is how many milli seconds to wait for a response, 1000 by default
+ *    -R sends an <echo> or <loadavg/> without a response again up to <retries> times, waiting twice
+ *       as long after each one, and reports how often every request was sent
+ *    -D sends a second copy of an <echo> or <loadavg/> after <hedge ms> without a response and takes
+ *       the first reply, 0 waits for the 95th percentile of the recent latencies
+ *    -B runs the benchmark instead of sending one message read from stdin,
+ *       -t threads each with their own socket keep -i requests outstanding, or send 
+ *       -r requests per second between them on a fixed schedule, for -d seconds.
+ *       -l percent of the requests are <loadavg/> and the rest are echoes of the -s sizes.
+ *       -H percent of the echoes repeat the same payload, as health checks do.
+ *       -X percent of the requests are preceded by a datagram too long for the server, which rejects it,
+ *       its error reply counts as an error.
+ *    -C times formatting and parsing the -s echoes and <loadavg/> in the text and the binary form 
+ *       without a server and prints the nano seconds per message
+ *       A request without a reply after -T milli seconds is lost. The results are written
+ *       as JSON to -j or stdout and a summary to stderr.
+ *    <hostname> IP address or name of a host that runs the server, or a list of servers
+ *       host[:port],host[:port],... that the requests are spread over, the servers that stop
+ *       answering are left out until they answer a <loadavg/> again
  *    <portnum> the numeric port number on which the server listens
  */
 int main(int argc, char** argv) 
 {
-	int                sockfd;
-	struct sockaddr_in servaddr;
-	char               response[256];
-	char               message[256];
+	int                sockfd, option;
+	int                size = MAX_MESSAGE;
+	struct sockaddr_in6 servaddr;
+	char               *response;
+	char               *message;
+	struct server_pool *pool = NULL;
+	int                bench = 0, depth = 0, binary = 0, codec = 0, retries = 0, hedge = HEDGE_OFF;
+	struct bench_config config = { .threads = DEFAULT_BENCH_THREADS, .inflight = DEFAULT_BENCH_INFLIGHT,
+	                               .duration = DEFAULT_BENCH_DURATION_SEC, .timeout = DEFAULT_BENCH_TIMEOUT_MIL_SEC };
+
+	parse_Bench_Sizes(DEFAULT_BENCH_SIZES, &config);
+	while ((option = getopt(argc, argv, "cbm:P:R:D:BCt:i:r:d:T:l:H:X:s:j:")) != -1) {
+		if (option == 'c') {
+			setPaddedFrames(1);
+			config.padded = 1;
+		}
+		else if (option == 'b')
+			binary = config.binary = 1;
+		else if (option == 'm' && atoi(optarg) >= MAX_MESSAGE && atoi(optarg) <= MAX_MESSAGE_LIMIT)
+			size = atoi(optarg);
+		else if (option == 'P' && atoi(optarg) >= 1 && atoi(optarg) <= MAX_PIPELINE)
+			depth = atoi(optarg);
+		else if (option == 'R' && atoi(optarg) >= 0)
+			retries = atoi(optarg);
+		else if (option == 'D' && atoi(optarg) >= 0)
+			hedge = atoi(optarg);
+		else if (option == 'B')
+			bench = 1;
+		else if (option == 'C')
+			codec = 1;
+		else if (option == 't' && atoi(optarg) >= 1 && atoi(optarg) <= BENCH_MAX_THREADS)
+			config.threads = atoi(optarg);
+		else if (option == 'i' && atoi(optarg) >= 1 && atoi(optarg) <= BENCH_MAX_INFLIGHT)
+			config.inflight = atoi(optarg);
+		else if (option == 'r' && atof(optarg) >= 0)
+			config.rate = atof(optarg);
+		else if (option == 'd' && atoi(optarg) >= 1 && atoi(optarg) <= BENCH_MAX_DURATION_SEC)
+			config.duration = atoi(optarg);
+		else if (option == 'T' && atoi(optarg) >= 1)
+			config.timeout = atoi(optarg);
+		else if (option == 'l' && atoi(optarg) >= 0 && atoi(optarg) <= 100)
+			config.loadavgPercent = atoi(optarg);
+		else if (option == 'H' && atoi(optarg) >= 0 && atoi(optarg) <= 100)
+			config.repeatPercent = atoi(optarg);
+		else if (option == 'X' && atoi(optarg) >= 0 && atoi(optarg) <= 100)
+			config.rejectPercent = atoi(optarg);
+		else if (option == 's' && parse_Bench_Sizes(optarg, &config) == 0)
+			continue;
+		else if (option == 'j')
+			config.jsonPath = optarg;
+		else
+			argc = 0;
+	}
+	if (codec && argc > 0)
+		exit (run_Codec_Bench(&config, CODEC_ITERATIONS) == 0 ? 0 : 1);
+	if (argc - optind != 2 || (binary && (depth > 0 || retries > 0 || hedge != HEDGE_OFF || strchr(argv[optind], ',') != NULL))) {
+		fprintf (stderr, "Usage: client [-c] [-m <size>] [-T <timeout ms>] [-b | [-P <depth>] [-R <retries>] [-D <hedge ms>]] <hostname> <portnum>\n");
+		fprintf (stderr, "       client -B [-c | -b] [-t <threads>] [-i <inflight>] [-r <rate>] [-d <seconds>] [-T <timeout ms>]\n");
+		fprintf (stderr, "                 [-l <loadavg percent>] [-H <repeat percent>] [-X <reject percent>] [-s <size,size,...>] [-j <json file>]\n");
+		fprintf (stderr, "                 <hostname> <portnum>\n");
+		fprintf (stderr, "       client -C [-s <size,size,...>]\n");
+		exit (1);
+	}
+
+	if (bench) {
+		if (bench_Address(argv[optind], atoi(argv[optind + 1]), &config) < 0 || run_Bench(&config) < 0)
+			exit (1);
+		exit (0);
+	}
 
-	if (argc != 3) {
-		fprintf (stderr, "Usage: client <hostname> <portnum>\n");
+	// a response is a few bytes longer than the message it answers, or a report of up to MAX_REPLY bytes
+	message = malloc(size + 1);
+	response = malloc(size + MAX_REPLY);
+	if (message == NULL || response == NULL) {
+		fprintf (stderr, "Cannot allocate %d byte messages\n", size);
 		exit (1);
 	}
 
 	// parse input parameter for port information
-	int portNum = atoi (argv[2]);
+	int portNum = atoi (argv[optind + 1]);
 
 	// create a streaming socket
-	sockfd = createSocket(argv[1], portNum, &servaddr);
+	setReceiveTimeout(config.timeout);
+	if (strchr(argv[optind], ',') != NULL) {
+		pool = createPool(argv[optind], portNum);
+		if (pool == NULL)
+			exit (1);
+		sockfd = pool->sockFD;
+		servaddr = pool->endpoints[0].address;
+	}
+	else
+		sockfd = createSocket(argv[optind], portNum, &servaddr);
 	if (sockfd < 0) {
 		exit (1);
 	}
 	
+	if (depth > 0) {
+		option = sendPipelined(sockfd, &servaddr, depth, config.timeout, retries, hedge, pool, message, size);
+		freePool(pool);
+		close (sockfd);
+		exit (option == 0 ? 0 : 1);
+	}
+
 	printf ("Enter a message: ");
-	fgets (message, 256, stdin);
+	fgets (message, size + 1, stdin);
 	// replace new line with null character
 	message[strlen(message)-1] = '\0';
 	
+	if (retries > 0 || hedge != HEDGE_OFF || pool != NULL) {
+		option = sendRetried(sockfd, &servaddr, config.timeout, retries, hedge, pool, message);
+		freePool(pool);
+		close (sockfd);
+		exit (option == 0 ? 0 : 1);
+	}
+
 	// send request to server
 	//if (sendRequest (sockfd, "<echo>Hello, World!</echo>", &servaddr) < 0) {
-	if (sendRequest (sockfd, message, &servaddr) < 0) {
+	if ((binary ? sendBinaryRequest (sockfd, message, getpid(), &servaddr) : sendRequest (sockfd, message, &servaddr)) < 0) {
 		close (sockfd);
 		exit (1);
 	}
 
-	if (receiveResponse(sockfd, response) < 0) {
+	if ((binary ? receiveBinaryResponse(sockfd, response, size + MAX_REPLY) : receiveResponseSize(sockfd, response, size + MAX_REPLY)) < 0) {
 		close (sockfd);
 		exit (1);
 	}
@@ -67,3 +218,109 @@ int main(int argc, char** argv)
 	exit(0);
 }
 
+/*
+ **************************************************
+ *	Waits for a response only when the pipeline is full or stdin is done
+ **************************************************
+ */
+int sendPipelined(int sockfd, struct sockaddr_in6 *servaddr, int depth, int timeout, int retries, int hedge, struct server_pool *pool, char *message, int size)
+{
+	struct request_pipeline *pipeline;
+	struct request_result result;
+	int length, ready = 0, timedOut = 0, done = 0, answered = 0;
+	uint64_t id, total = 0, longest = 0;
+
+	pipeline = openPipeline(sockfd, servaddr, depth, timeout);
+	if (pipeline == NULL) {
+		fprintf (stderr, "Cannot allocate a pipeline of %d requests\n", depth);
+		return -1;
+	}
+	setRetryPolicy(pipeline, retries, 0, hedge);
+	if (pool != NULL)
+		usePool(pipeline, pool);
+	while (ready >= 0 && (!done || pendingRequests(pipeline) > 0)) {
+		if (!done && pendingRequests(pipeline) < depth) {
+			// responses that already came, timeouts and probes are handled before waiting for the next line
+			ready = pollResponse(pipeline, &result, 0);
+			if (ready == 0 && fgets (message, size + 1, stdin) == NULL) {
+				done = 1;
+				continue;
+			}
+			if (ready == 0) {
+				length = strlen(message);
+				if (length > 0 && message[length - 1] == '\n')
+					message[length - 1] = '\0';
+				if ((id = submitRequest(pipeline, message)) == 0) {
+					ready = -1;
+					break;
+				}
+				printf ("Request %llx : %s\n", (unsigned long long) id, message);
+				continue;
+			}
+		}
+		else
+			ready = pollResponse(pipeline, &result, -1);
+		if (ready == 1 && result.status == RESPONSE_OK) {
+			if (result.sends > 1)
+				printf ("Response to %llx after %.1f us (%d sends) : %s\n", (unsigned long long) result.id, result.latency / 1e3, result.sends, result.response);
+			else
+				printf ("Response to %llx after %.1f us : %s\n", (unsigned long long) result.id, result.latency / 1e3, result.response);
+			answered++;
+			total += result.latency;
+			if (result.latency > longest)
+				longest = result.latency;
+		}
+		else if (ready == 1) {
+			printf ("Request %llx timed out\n", (unsigned long long) result.id);
+			timedOut++;
+		}
+	}
+	if (retries > 0 || hedge != HEDGE_OFF)
+		fprintf (stderr, "%d responses, %d timed out, %lu retransmitted, %lu hedged, %lu late, latency mean %.1f us max %.1f us\n",
+		         answered, timedOut, pipeline->retried, pipeline->hedged, pipeline->late,
+		         answered > 0 ? total / 1e3 / answered : 0.0, longest / 1e3);
+	if (pool != NULL)
+		printPool(pool);
+	closePipeline(pipeline);
+	if (ready < 0)
+		return -1;
+	return timedOut > 0 ? 1 : 0;
+}
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+int sendRetried(int sockfd, struct sockaddr_in6 *servaddr, int timeout, int retries, int hedge, struct server_pool *pool, char *message)
+{
+	struct request_pipeline *pipeline;
+	struct request_result result;
+	int ready;
+
+	pipeline = openPipeline(sockfd, servaddr, 1, timeout);
+	if (pipeline == NULL) {
+		fprintf (stderr, "Cannot allocate a pipeline\n");
+		return -1;
+	}
+	setRetryPolicy(pipeline, retries, 0, hedge);
+	if (pool != NULL)
+		usePool(pipeline, pool);
+	if (submitRequest(pipeline, message) == 0) {
+		closePipeline(pipeline);
+		return -1;
+	}
+	do
+		ready = pollResponse(pipeline, &result, -1);
+	while (ready == 0);
+	if (ready == 1 && result.status == RESPONSE_OK) {
+		printResponse(result.response);
+		fprintf (stderr, "Response after %.1f us and %d sends\n", result.latency / 1e3, result.sends);
+	}
+	else if (ready == 1)
+		fprintf (stderr, "ERROR: No Response after %d sends\n", result.sends);
+	closePipeline(pipeline);
+	if (ready < 0)
+		return -1;
+	return result.status == RESPONSE_OK ? 0 : 1;
+}
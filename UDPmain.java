@@ -6,6 +6,9 @@
 
 import java.io.*;
 import java.net.*;
+import java.util.ArrayList;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.CompletionException;
 
 public class UDPmain {
 
@@ -19,14 +22,30 @@ public class UDPmain {
         String    serverName;
         String    req;
 
+        boolean paddedFrames = false;
+        boolean binaryFrames = false;
+        if (args.length >= 4 && args[0].equals("-a")) {
+            //send the request many times through the asynchronous client
+            runAsync(args);
+            return;
+        }
+        if (args.length == 3 && args[0].equals("-c")) {
+            //send null padded 256 byte frames for old servers
+            paddedFrames = true;
+            args = new String[] { args[1], args[2] };
+        } else if (args.length == 3 && args[0].equals("-b")) {
+            //send the request in the binary form
+            binaryFrames = true;
+            args = new String[] { args[1], args[2] };
+        }
         if (args.length != 2) {
-            System.err.println("Usage: UDPclient <serverName> <port number>\n");
+            System.err.println("Usage: UDPclient [-c | -b] <serverName> <port number>\n       UDPclient -a <count> [-b] <serverName> <port number>\n");
             return;
         }
         try {
             serverName = args[0];
         } catch (NullPointerException xcp) {
-            System.err.println("Usage: UDPclient <serverName> <port number>\n");
+            System.err.println("Usage: UDPclient [-c | -b] <serverName> <port number>\n       UDPclient -a <count> [-b] <serverName> <port number>\n");
             return;
         }
 
@@ -34,7 +53,7 @@ public class UDPmain {
         try {
             portNum = Integer.parseInt(args[1]);
         } catch (NumberFormatException xcp) {
-            System.err.println("Usage: UDPclient <serverName> <port number>\n");
+            System.err.println("Usage: UDPclient [-c | -b] <serverName> <port number>\n       UDPclient -a <count> [-b] <serverName> <port number>\n");
             return;
         }
 
@@ -43,9 +62,15 @@ public class UDPmain {
         if (client.createSocket() < 0) {
             return;
         }
+        client.setPaddedFrames(paddedFrames);
+        client.setBinaryFrames(binaryFrames);
 
         System.out.print ("Enter a request: ");
-        req = System.console().readLine();
+        req = readRequest();
+        if (req == null) {
+            client.closeSocket();
+            return;
+        }
         
         if (client.sendRequest(req, serverName, portNum) < 0) {
 			//client.close();
@@ -63,4 +88,81 @@ public class UDPmain {
 
         client.closeSocket();
     }
+
+    /**
+     * Reads the request from standard input, which is not a console when the request is piped in.
+     * @return the first line of standard input or null if there is none
+     */
+    private static String readRequest()
+    {
+        try {
+            String req = new BufferedReader(new InputStreamReader(System.in)).readLine();
+            if (req == null) {
+                System.err.println("No request on standard input");
+            }
+            return req;
+        } catch (IOException xcp) {
+            System.err.println("Unable to read the request: " + xcp.getMessage());
+            return null;
+        }
+    }
+
+    /**
+     * Sends one request count times with every request in flight at once and prints
+     * the last response, how many were answered and the rate.
+     * @param args -a, the count, optionally -b, the server name and the port number
+     */
+    private static void runAsync(String[] args)
+    {
+        int count, portNum;
+        boolean binaryFrames = args.length == 5 && args[2].equals("-b");
+        if (args.length != (binaryFrames ? 5 : 4)) {
+            System.err.println("Usage: UDPclient -a <count> [-b] <serverName> <port number>\n");
+            return;
+        }
+        try {
+            count = Integer.parseInt(args[1]);
+            portNum = Integer.parseInt(args[args.length - 1]);
+        } catch (NumberFormatException xcp) {
+            System.err.println("Usage: UDPclient -a <count> [-b] <serverName> <port number>\n");
+            return;
+        }
+        if (count <= 0) {
+            System.err.println("Usage: UDPclient -a <count> [-b] <serverName> <port number>\n");
+            return;
+        }
+
+        System.out.print ("Enter a request: ");
+        String req = readRequest();
+        if (req == null) {
+            return;
+        }
+
+        try (UDPasyncClient client = new UDPasyncClient(args[args.length - 2], portNum, binaryFrames,
+                UDPasyncClient.DEFAULT_MAX_IN_FLIGHT, UDPasyncClient.DEFAULT_TIMEOUT_MIL_SEC, UDPasyncClient.DEFAULT_RETRIES)) {
+            long started = System.nanoTime();
+            ArrayList<CompletableFuture<String>> responses = new ArrayList<CompletableFuture<String>>(count);
+            for (int i = 0; i < count; i++) {
+                responses.add(client.send(req));
+            }
+            String response = null;
+            int answered = 0;
+            for (CompletableFuture<String> future : responses) {
+                try {
+                    response = future.join();
+                    answered++;
+                } catch (CompletionException xcp) {
+                    //timed out after every retry, counted below
+                }
+            }
+            double seconds = (System.nanoTime() - started) / 1e9;
+            if (response != null) {
+                UDPclient.printResponse(response.trim());
+            }
+            System.out.printf("%d of %d answered in %.3f s, %.0f requests/s, %d retries%n",
+                              answered, count, seconds, answered / seconds, client.getRetried());
+        } catch (IOException xcp) {
+            System.err.println("Unable to create channel: " + xcp.getMessage());
+        }
+    }
 }
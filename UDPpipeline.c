@@ -0,0 +1,610 @@
+/**	@file UDPpipeline.c
+ * 	@brief Contains the function implementations of pipelined requests for the C client.
+ *	Every request is sent with a correlation ID the server hands back with the response,
+ *	so many requests can be in flight on one socket and each one either gets its own
+ *	response or is reported as timed out.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPpipeline.h"
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Writes the correlation envelope of an ID, "#<hex id> ".
+*	@param 	tag is where the envelope is written, at least CORRELATION_TAG_MAX bytes.
+*			id is the ID of the request.
+*	@return returns the length of the envelope.
+*/
+int write_Tag(char *tag, uint64_t id);
+
+/**	@brief 	Reads the ID out of the envelope in front of a response.
+*	@param 	response is the response as received.
+*			length is the length of the response.
+*			id is where the ID is written.
+*	@return returns the length of the envelope, 0 when the response has none.
+*/
+int read_Tag(char *response, int length, uint64_t *id);
+
+/**	@brief 	Sends a request with its correlation envelope, in fragments when it does not fit a datagram.
+*	@param 	pipeline is the pipeline to send on.
+*			id is the ID of the request.
+*			request is the request.
+*			length is the length of the request.
+*			dest is the server to send to.
+*	@return returns 0 on success, -1 if it could not be sent.
+*/
+int send_Tagged(struct request_pipeline *pipeline, uint64_t id, char *request, int length, struct sockaddr_in6 *dest);
+
+/**	@brief 	Chooses the server a request is sent to.
+*	@param 	pipeline is the pipeline.
+*			endpoint is where the server of the pool is written, -1 without a pool.
+*	@return returns the address of the server.
+*/
+struct sockaddr_in6 *route_Request(struct request_pipeline *pipeline, int *endpoint);
+
+/**	@brief 	Counts a request as in flight on the server it was sent to last.
+*	@param 	pipeline is the pipeline.
+*			slot is the request.
+*			endpoint is the server of the pool, -1 without a pool.
+*	@return returns nothing.
+*/
+void move_Request(struct request_pipeline *pipeline, struct pipeline_slot *slot, int endpoint);
+
+/**	@brief 	Frees the slot of a request that completed or timed out.
+*	@param 	pipeline is the pipeline.
+*			index is the slot.
+*	@return returns nothing.
+*/
+void free_Slot(struct request_pipeline *pipeline, int index);
+
+/**	@brief 	Sends BALANCE_PROBE to the servers of the pool that are due to be probed.
+*	@param 	pipeline is the pipeline.
+*			now is the current pipeline_Clock time.
+*	@return returns nothing.
+*/
+void send_Probes(struct request_pipeline *pipeline, uint64_t now);
+
+/**	@brief 	Checks if a request can be answered twice without harm.
+*	@param 	request is the request.
+*			length is the length of the request.
+*	@return returns 1 for <echo> and <loadavg/>, 0 otherwise.
+*/
+int is_Idempotent(const char *request, int length);
+
+/**	@brief 	Keeps the latency of a response and updates the hedge delay every PIPELINE_HEDGE_UPDATE responses.
+*	@param 	pipeline is the pipeline.
+*			latency is the nano seconds from sending the request to its response.
+*	@return returns nothing.
+*/
+void note_Latency(struct request_pipeline *pipeline, uint64_t latency);
+
+/**	@brief 	Orders two latencies for qsort.
+*	@param 	first is the first latency.
+*			second is the second latency.
+*	@return returns a negative number, 0 or a positive number like strcmp.
+*/
+int compare_Latency(const void *first, const void *second);
+
+/**	@brief 	Sends the hedges and retransmissions that are due, reports the first request that is out of
+*			retransmissions and finds the next deadline.
+*	@param 	pipeline is the pipeline to check.
+*			now is the current pipeline_Clock time.
+*			result is filled in when a request timed out.
+*	@return returns 1 if a request timed out, 0 if none did.
+*/
+int expire_Request(struct request_pipeline *pipeline, uint64_t now, struct request_result *result);
+
+/**	@brief 	Reads one datagram and matches the response it completes to its request.
+*	@param 	pipeline is the pipeline to read on.
+*			now is the current pipeline_Clock time.
+*			result is filled in when a request completed.
+*	@return returns 1 if a request completed, 0 if not, -1 if the socket failed.
+*/
+int read_Response(struct request_pipeline *pipeline, uint64_t now, struct request_result *result);
+
+/**	@brief 	Current CLOCK_MONOTONIC time.
+*	@param 	no parameter is passed.
+*	@return returns the time in nano seconds.
+*/
+uint64_t pipeline_Clock(void);
+
+/*
+ **************************************************
+ *		PIPELINE FUNCTIONS
+ **************************************************
+ */
+
+/*
+ * Sets up a pipeline of requests on a socket made by createSocket.
+ */
+struct request_pipeline *openPipeline(int sockFD, struct sockaddr_in6 * dest, int capacity, int timeout){
+	int i, buffer = capacity * PIPELINE_BUFFER_PER_REQUEST;
+	struct request_pipeline *pipeline;
+	if(capacity < 1 || capacity > MAX_PIPELINE)
+		return NULL;
+	pipeline = calloc(1, sizeof(struct request_pipeline));
+	if(pipeline == NULL)
+		return NULL;
+	pipeline->slots = calloc(capacity, sizeof(struct pipeline_slot));
+	pipeline->freeSlots = malloc(capacity * sizeof(int));
+	pipeline->datagram = malloc(MAX_MTU);
+	pipeline->response = malloc(MAX_MESSAGE_LIMIT + MAX_MESSAGE);
+	if(pipeline->slots == NULL || pipeline->freeSlots == NULL || pipeline->datagram == NULL || pipeline->response == NULL) {
+		free(pipeline->slots);
+		free(pipeline->freeSlots);
+		free(pipeline->datagram);
+		free(pipeline->response);
+		free(pipeline);
+		return NULL;
+	}
+	init_Reassembly(&pipeline->reassembly, MAX_MESSAGE_LIMIT + MAX_MESSAGE);
+	//every response in flight has to fit in the receive buffer while the client is busy sending,
+	//the kernel keeps the default when the size is above net.core.rmem_max
+	if(buffer > PIPELINE_MIN_BUFFER)
+		setsockopt(sockFD, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+	for(i = 0; i < capacity; i++)
+		pipeline->freeSlots[i] = capacity - 1 - i;
+	pipeline->freeCount = capacity;
+	pipeline->sockFD = sockFD;
+	pipeline->dest = *dest;
+	pipeline->capacity = capacity;
+	pipeline->timeout = timeout;
+	pipeline->mtu = getPathMtu();
+	pipeline->nextSequence = 1; //an ID is never 0
+	pipeline->nextExpire = UINT64_MAX;
+	pipeline->hedgeDelay = HEDGE_OFF;
+	pipeline->hedgeAfter = UINT64_MAX;
+	return pipeline;
+}
+
+/*
+ * Sets how requests without a response are sent again.
+ * The adaptive hedge waits for PIPELINE_HEDGE_UPDATE latencies before it hedges anything.
+ */
+void setRetryPolicy(struct request_pipeline * pipeline, int retries, int maxTimeout, int hedgeDelay){
+	pipeline->retries = retries < 0 ? 0 : retries;
+	pipeline->maxTimeout = maxTimeout > 0 ? maxTimeout : pipeline->timeout * PIPELINE_MAX_BACKOFF;
+	pipeline->hedgeDelay = hedgeDelay;
+	if(hedgeDelay > 0)
+		pipeline->hedgeAfter = (uint64_t) hedgeDelay * 1000000ULL;
+	else
+		pipeline->hedgeAfter = UINT64_MAX;
+}
+
+/*
+ * Spreads the requests over a pool of servers.
+ */
+void usePool(struct request_pipeline * pipeline, struct server_pool * pool){
+	pipeline->pool = pool;
+}
+
+/*
+ * Sends a request with a new correlation ID without waiting for the response.
+ * The request is only copied when it may have to be sent again.
+ */
+uint64_t submitRequest(struct request_pipeline * pipeline, char * request){
+	struct pipeline_slot *slot;
+	struct sockaddr_in6 *dest;
+	int index, length, endpoint;
+	char *copy;
+	uint64_t id;
+
+	if(pipeline->freeCount == 0)
+		return 0;
+	index = pipeline->freeSlots[pipeline->freeCount - 1];
+	id = pipeline->nextSequence << PIPELINE_SLOT_BITS | index;
+	length = strnlen(request, MAX_MESSAGE_LIMIT);
+	dest = route_Request(pipeline, &endpoint);
+	if(send_Tagged(pipeline, id, request, length, dest) == -1)
+		return 0;
+
+	pipeline->freeCount--;
+	pipeline->nextSequence++;
+	slot = &pipeline->slots[index];
+	slot->endpoint = -1;
+	move_Request(pipeline, slot, endpoint);
+	slot->id = id;
+	slot->active = 1;
+	slot->attempts = 0;
+	slot->sends = 1;
+	slot->requestLength = 0;
+	slot->sent = pipeline_Clock();
+	slot->deadline = slot->sent + (uint64_t) pipeline->timeout * 1000000ULL;
+	slot->hedgeAt = UINT64_MAX;
+	if((pipeline->retries > 0 || pipeline->hedgeDelay != HEDGE_OFF) && is_Idempotent(request, length)) {
+		if(length > slot->requestSize && (copy = realloc(slot->request, length)) != NULL) {
+			slot->request = copy;
+			slot->requestSize = length;
+		}
+		if(length <= slot->requestSize) {
+			memcpy(slot->request, request, length);
+			slot->requestLength = length;
+			if(pipeline->hedgeAfter != UINT64_MAX)
+				slot->hedgeAt = slot->sent + pipeline->hedgeAfter;
+		}
+	}
+	if(slot->deadline < pipeline->nextExpire)
+		pipeline->nextExpire = slot->deadline;
+	if(slot->hedgeAt < pipeline->nextExpire)
+		pipeline->nextExpire = slot->hedgeAt;
+	return id;
+}
+
+/*
+ * Waits for the next response or timeout of a request in flight.
+ * A response that matches no request in flight came after its request timed out and is skipped.
+ */
+int pollResponse(struct request_pipeline * pipeline, struct request_result * result, int wait){
+	struct pollfd readable = { pipeline->sockFD, POLLIN, 0 };
+	uint64_t now = pipeline_Clock(), until, next;
+	int ready, timeout;
+
+	until = wait < 0 ? UINT64_MAX : now + (uint64_t) wait * 1000000ULL;
+	while(1) {
+		//responses that came while the caller was busy are read before their requests can time out
+		while(now >= pipeline->nextExpire && poll(&readable, 1, 0) > 0) {
+			ready = read_Response(pipeline, now, result);
+			if(ready != 0)
+				return ready;
+		}
+		if(now >= pipeline->nextExpire && expire_Request(pipeline, now, result))
+			return 1;
+		if(pipeline->pool != NULL && now >= nextProbe(pipeline->pool))
+			send_Probes(pipeline, now);
+		if(pipeline->freeCount == pipeline->capacity || now >= until)
+			return 0;
+
+		//sleep until a datagram arrives, a request times out, a probe is due or the wait is over
+		next = pipeline->nextExpire < until ? pipeline->nextExpire : until;
+		if(pipeline->pool != NULL && nextProbe(pipeline->pool) < next)
+			next = nextProbe(pipeline->pool);
+		timeout = (next - now + 999999) / 1000000;
+		ready = poll(&readable, 1, timeout);
+		if(ready == -1 && errno != EINTR) {
+			fprintf(stderr, "ERROR: Cannot Wait for a Response\n");
+			return -1;
+		}
+		now = pipeline_Clock();
+		if(ready > 0) {
+			ready = read_Response(pipeline, now, result);
+			if(ready != 0)
+				return ready;
+		}
+	}
+}
+
+/*
+ * Gets the number of requests in flight.
+ */
+int pendingRequests(struct request_pipeline * pipeline){
+	return pipeline->capacity - pipeline->freeCount;
+}
+
+/*
+ * Frees a pipeline, the socket is left open.
+ */
+void closePipeline(struct request_pipeline * pipeline){
+	int i;
+	if(pipeline == NULL)
+		return;
+	for(i = 0; i < pipeline->capacity; i++)
+		free(pipeline->slots[i].request);
+	free_Reassembly(&pipeline->reassembly);
+	free(pipeline->slots);
+	free(pipeline->freeSlots);
+	free(pipeline->datagram);
+	free(pipeline->response);
+	free(pipeline);
+}
+
+/*
+ **************************************************
+ *	The envelope and the request are sent as two parts so the request is not copied.
+ **************************************************
+ */
+int send_Tagged(struct request_pipeline *pipeline, uint64_t id, char *request, int length, struct sockaddr_in6 *dest){
+	char tag[CORRELATION_TAG_MAX];
+	struct iovec parts[2];
+	struct msghdr header;
+	int error;
+
+	parts[0].iov_base = tag;
+	parts[0].iov_len = write_Tag(tag, id);
+	parts[1].iov_base = request;
+	parts[1].iov_len = length;
+	if(parts[0].iov_len + parts[1].iov_len > fragment_Payload(pipeline->mtu)) {
+		if(split_Fragments(&pipeline->fragments, parts, 2, pipeline->mtu, pipeline->nextMessageId++) == -1) {
+			fprintf(stderr, "ERROR: Request Is Too Large\n");
+			return -1;
+		}
+		error = send_Fragments(pipeline->sockFD, (struct sockaddr *) dest, sizeof(*dest), &pipeline->fragments);
+	}
+	else {
+		memset(&header, 0, sizeof(header));
+		header.msg_name = dest;
+		header.msg_namelen = sizeof(*dest);
+		header.msg_iov = parts;
+		header.msg_iovlen = 2;
+		error = sendmsg(pipeline->sockFD, &header, 0);
+	}
+	if(error == -1) {
+		fprintf(stderr, "ERROR: Cannot Send Request to the Server\n");
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ **************************************************
+ **************************************************
+ */
+struct sockaddr_in6 *route_Request(struct request_pipeline *pipeline, int *endpoint){
+	if(pipeline->pool == NULL) {
+		*endpoint = -1;
+		return &pipeline->dest;
+	}
+	*endpoint = chooseEndpoint(pipeline->pool);
+	return &pipeline->pool->endpoints[*endpoint].address;
+}
+
+/*
+ **************************************************
+ *	A hedged request only counts against the server of its last copy.
+ **************************************************
+ */
+void move_Request(struct request_pipeline *pipeline, struct pipeline_slot *slot, int endpoint){
+	if(slot->endpoint >= 0)
+		pipeline->pool->endpoints[slot->endpoint].pending--;
+	slot->endpoint = endpoint;
+	if(endpoint >= 0) {
+		pipeline->pool->endpoints[endpoint].pending++;
+		pipeline->pool->endpoints[endpoint].sent++;
+	}
+}
+
+/*
+ **************************************************
+ **************************************************
+ */
+void free_Slot(struct request_pipeline *pipeline, int index){
+	struct pipeline_slot *slot = &pipeline->slots[index];
+	slot->active = 0;
+	move_Request(pipeline, slot, -1);
+	pipeline->freeSlots[pipeline->freeCount++] = index;
+}
+
+/*
+ **************************************************
+ *	A probe is sent without a slot under ID 0, its response is matched by the address it came from.
+ *	A lost probe is sent again BALANCE_PROBE_MIL_SEC later.
+ **************************************************
+ */
+void send_Probes(struct request_pipeline *pipeline, uint64_t now){
+	char probe[] = BALANCE_PROBE;
+	int index;
+	while((index = dueProbe(pipeline->pool, now)) != -1)
+		send_Tagged(pipeline, 0, probe, sizeof(probe) - 1, &pipeline->pool->endpoints[index].address);
+}
+
+/*
+ **************************************************
+ *	<shutdown/>, <limits> and anything unknown are never sent twice.
+ **************************************************
+ */
+int is_Idempotent(const char *request, int length){
+	static const char echo[] = "<echo>", loadavg[] = "<loadavg/>";
+	if(length >= (int) sizeof(echo) - 1 && memcmp(request, echo, sizeof(echo) - 1) == 0)
+		return 1;
+	return length == sizeof(loadavg) - 1 && memcmp(request, loadavg, sizeof(loadavg) - 1) == 0;
+}
+
+/*
+ **************************************************
+ *	The window is sorted every PIPELINE_HEDGE_UPDATE latencies instead of on every response.
+ **************************************************
+ */
+void note_Latency(struct request_pipeline *pipeline, uint64_t latency){
+	uint64_t sorted[PIPELINE_LATENCY_WINDOW];
+	int count;
+	pipeline->latencies[pipeline->latencyCount++ % PIPELINE_LATENCY_WINDOW] = latency;
+	if(pipeline->hedgeDelay != HEDGE_P95 || pipeline->latencyCount % PIPELINE_HEDGE_UPDATE != 0)
+		return;
+	count = pipeline->latencyCount < PIPELINE_LATENCY_WINDOW ? pipeline->latencyCount : PIPELINE_LATENCY_WINDOW;
+	memcpy(sorted, pipeline->latencies, count * sizeof(uint64_t));
+	qsort(sorted, count, sizeof(uint64_t), compare_Latency);
+	pipeline->hedgeAfter = sorted[count * 95 / 100];
+}
+
+/*
+ **************************************************
+ **************************************************
+ */
+int compare_Latency(const void *first, const void *second){
+	uint64_t a = *(const uint64_t *) first, b = *(const uint64_t *) second;
+	return a < b ? -1 : a > b;
+}
+
+/*
+ **************************************************
+ **************************************************
+ */
+int write_Tag(char *tag, uint64_t id){
+	static const char hex[] = "0123456789abcdef";
+	char digits[16];
+	int count = 0, length = 0;
+	do {
+		digits[count++] = hex[id & 0xF];
+		id >>= 4;
+	} while(id != 0);
+	tag[length++] = '#';
+	while(count > 0)
+		tag[length++] = digits[--count];
+	tag[length++] = ' ';
+	return length;
+}
+
+/*
+ **************************************************
+ **************************************************
+ */
+int read_Tag(char *response, int length, uint64_t *id){
+	int i;
+	char c;
+	if(length < 3 || response[0] != '#')
+		return 0;
+	for(i = 1, *id = 0; i < length && i <= 16 && response[i] != ' '; i++) {
+		c = response[i];
+		if(c >= '0' && c <= '9')
+			*id = *id << 4 | (c - '0');
+		else if(c >= 'a' && c <= 'f')
+			*id = *id << 4 | (c - 'a' + 10);
+		else
+			return 0;
+	}
+	if(i == 1 || i == length || response[i] != ' ')
+		return 0;
+	return i + 1;
+}
+
+/*
+ **************************************************
+ **************************************************
+ */
+int expire_Request(struct request_pipeline *pipeline, uint64_t now, struct request_result *result){
+	int index, timeout, endpoint;
+	struct sockaddr_in6 *dest;
+	struct pipeline_slot *slot;
+	pipeline->nextExpire = UINT64_MAX;
+	for(index = 0; index < pipeline->capacity; index++) {
+		slot = &pipeline->slots[index];
+		if(!slot->active)
+			continue;
+		if(slot->hedgeAt <= now) {
+			//a lost send can not be told from a slow one, the hedge covers both once
+			slot->hedgeAt = UINT64_MAX;
+			dest = route_Request(pipeline, &endpoint);
+			if(send_Tagged(pipeline, slot->id, slot->request, slot->requestLength, dest) == 0) {
+				move_Request(pipeline, slot, endpoint);
+				slot->sends++;
+				pipeline->hedged++;
+			}
+		}
+		if(slot->deadline <= now && slot->endpoint >= 0)
+			endpointFailed(pipeline->pool, slot->endpoint, now);
+		if(slot->deadline <= now && slot->attempts < pipeline->retries && slot->requestLength > 0) {
+			//exponential back off, a server that is only slow is not flooded with copies
+			slot->attempts++;
+			timeout = pipeline->timeout << (slot->attempts < 16 ? slot->attempts : 16);
+			if(timeout > pipeline->maxTimeout || timeout <= 0)
+				timeout = pipeline->maxTimeout;
+			slot->deadline = now + (uint64_t) timeout * 1000000ULL;
+			slot->hedgeAt = UINT64_MAX;
+			dest = route_Request(pipeline, &endpoint);
+			if(send_Tagged(pipeline, slot->id, slot->request, slot->requestLength, dest) == 0) {
+				move_Request(pipeline, slot, endpoint);
+				slot->sends++;
+			}
+			pipeline->retried++;
+		}
+		if(slot->deadline <= now) {
+			free_Slot(pipeline, index);
+			result->id = slot->id;
+			result->status = RESPONSE_TIMEOUT;
+			result->response = NULL;
+			result->length = 0;
+			result->latency = now - slot->sent;
+			result->sends = slot->sends;
+			pipeline->nextExpire = now; //there may be more, look again on the next call
+			return 1;
+		}
+		if(slot->deadline < pipeline->nextExpire)
+			pipeline->nextExpire = slot->deadline;
+		if(slot->hedgeAt < pipeline->nextExpire)
+			pipeline->nextExpire = slot->hedgeAt;
+	}
+	return 0;
+}
+
+/*
+ **************************************************
+ *	A padded response ends at its first null character like in receiveResponseSize
+ **************************************************
+ */
+int read_Response(struct request_pipeline *pipeline, uint64_t now, struct request_result *result){
+	int received, length = 0, tagLength, index, endpoint;
+	char *message = NULL, *response;
+	struct sockaddr_in6 from;
+	socklen_t fromlen = sizeof(from);
+	struct pipeline_slot *slot;
+	uint64_t id;
+
+	received = recvfrom(pipeline->sockFD, pipeline->datagram, MAX_MTU - 1, MSG_TRUNC | MSG_DONTWAIT, (struct sockaddr *) &from, &fromlen);
+	if(received == -1) {
+		if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return 0;
+		fprintf(stderr, "ERROR: Cannot Receive a Response\n");
+		return -1;
+	}
+	if(received > MAX_MTU - 1)
+		return 0;
+	if(is_Fragment(pipeline->datagram, received)) {
+		if(reassemble_Fragment(&pipeline->reassembly, &from, pipeline->datagram, received, &message, &length) != 1)
+			return 0;
+		response = message;
+	}
+	else {
+		response = pipeline->datagram;
+		length = strnlen(response, received);
+	}
+
+	tagLength = read_Tag(response, length, &id);
+	endpoint = pipeline->pool != NULL && tagLength > 0 ? findEndpoint(pipeline->pool, &from) : -1;
+	if(endpoint >= 0 && id >> PIPELINE_SLOT_BITS == 0) {
+		endpointResponded(pipeline->pool, endpoint, 0);
+		free(message);
+		return 0;
+	}
+	index = id & (MAX_PIPELINE - 1);
+	if(tagLength == 0 || index >= pipeline->capacity || !pipeline->slots[index].active || pipeline->slots[index].id != id) {
+		pipeline->late++;
+		free(message);
+		return 0;
+	}
+	slot = &pipeline->slots[index];
+	//only a request sent once tells how fast the server that answered is
+	if(endpoint >= 0)
+		endpointResponded(pipeline->pool, endpoint, slot->sends == 1 ? now - slot->sent : 0);
+	free_Slot(pipeline, index);
+	length -= tagLength;
+	memcpy(pipeline->response, response + tagLength, length);
+	pipeline->response[length] = '\0';
+	free(message);
+
+	result->id = id;
+	result->status = RESPONSE_OK;
+	result->response = pipeline->response;
+	result->length = length;
+	result->latency = now - slot->sent;
+	result->sends = slot->sends;
+	//after a retransmission it is unknown which copy was answered, a hedged request still counts
+	//or the slow requests the hedges answer would drop out of the window and pull the delay down
+	if(slot->attempts == 0)
+		note_Latency(pipeline, result->latency);
+	return 1;
+}
+
+/*
+ **************************************************
+ **************************************************
+ */
+uint64_t pipeline_Clock(void){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
@@ -0,0 +1,189 @@
+/**	@file UDPpipeline.h
+ * 	@brief Contains the function prototypes for sending pipelined requests with correlation IDs
+ *	from the C client that are implemented in UDPpipeline.c
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPPIPELINE_H
+#define UDPPIPELINE_H
+
+#include "UDPclient.h"	//first, it turns on the GNU extensions the system headers need for sendmmsg
+#include "UDPbalance.h"
+#include <stdint.h>
+#include <poll.h>
+#include <errno.h>
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define PIPELINE_SLOT_BITS 16		//the low bits of an ID are the slot of the request
+#define MAX_PIPELINE (1 << PIPELINE_SLOT_BITS)
+#define DEFAULT_PIPELINE_DEPTH 256
+#define DEFAULT_PIPELINE_TIMEOUT_MIL_SEC 1000
+#define PIPELINE_BUFFER_PER_REQUEST 2048	//receive buffer per request in flight, a small datagram costs about 1 KiB of it
+#define PIPELINE_MIN_BUFFER 212992		//the usual net.core.rmem_default
+#define CORRELATION_TAG_MAX 20		//'#', 16 hex digits, a space and a null character
+#define RESPONSE_OK 0
+#define RESPONSE_TIMEOUT 1
+#define PIPELINE_MAX_BACKOFF 8		//a retransmission waits at most this many timeouts unless setRetryPolicy says otherwise
+#define PIPELINE_LATENCY_WINDOW 256	//recent latencies the hedge delay is the 95th percentile of
+#define PIPELINE_HEDGE_UPDATE 32	//new latencies between two updates of the hedge delay
+#define HEDGE_OFF -1
+#define HEDGE_P95 0
+
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+/**	@brief 	One request that is waiting for its response. request is a copy of an idempotent request
+*			that may be sent again, requestLength is 0 when it may not. The buffer is kept for the next
+*			request of the slot.
+*/
+struct pipeline_slot {
+	uint64_t id;
+	uint64_t sent;
+	uint64_t deadline;
+	uint64_t hedgeAt;
+	int endpoint;		//the server of the pool it was last sent to, -1 without a pool
+	int attempts;
+	int sends;
+	int active;
+	char *request;
+	int requestLength;
+	int requestSize;
+};
+
+/**	@brief 	Requests in flight on one socket. A request is sent as "#<id> <request>" and the server
+*			puts the same envelope in front of its response, so responses can arrive in any order.
+*			nextExpire is the earliest deadline or hedge, the slots are only scanned once it passed.
+*			A retransmission or hedge of an idempotent request reuses its ID, the first response wins
+*			and the others are counted as late.
+*			With a pool every send goes to the server chooseEndpoint picks instead of dest, and the
+*			servers that were taken out are probed with an ID below 1 << PIPELINE_SLOT_BITS.
+*/
+struct request_pipeline {
+	int sockFD;
+	struct sockaddr_in6 dest;
+	struct server_pool *pool;
+	int capacity;
+	int timeout;
+	int mtu;
+	uint64_t nextSequence;
+	struct pipeline_slot *slots;
+	int *freeSlots;
+	int freeCount;
+	uint64_t nextExpire;
+	unsigned long late;
+	unsigned long retried;
+	unsigned long hedged;
+	int retries;
+	int maxTimeout;
+	int hedgeDelay;
+	uint64_t hedgeAfter;
+	uint64_t latencies[PIPELINE_LATENCY_WINDOW];
+	unsigned long latencyCount;
+	uint32_t nextMessageId;
+	char *datagram;
+	char *response;
+	struct reassembly_table reassembly;
+	struct fragment_set fragments;
+};
+
+/**	@brief 	What happened to one request. response is only set for RESPONSE_OK, it is the response
+*			without the envelope and stays valid until the next call to pollResponse.
+*/
+struct request_result {
+	uint64_t id;
+	int status;
+	char *response;
+	int length;
+	uint64_t latency;		//nano seconds from first sending the request
+	int sends;			//times the request was sent, more than 1 when it was retransmitted or hedged
+};
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/*
+ * Sets up a pipeline of requests on a socket made by createSocket.
+ *
+ * sockFD   - the socket identifier
+ * dest     - the server's address information
+ * capacity - the largest number of requests in flight, 1 to MAX_PIPELINE
+ * timeout  - the milli seconds after which a request without a response is reported as timed out
+ *
+ * return   - the pipeline, or NULL if it could not be allocated
+ */
+struct request_pipeline *openPipeline(int sockFD, struct sockaddr_in6 * dest, int capacity, int timeout);
+
+/*
+ * Sets how requests without a response are sent again. Only <echo> and <loadavg/> are sent again,
+ * they can be answered twice without harm. Applies to requests submitted afterwards.
+ *
+ * pipeline   - the pipeline
+ * retries    - the number of retransmissions before a request is reported as timed out
+ * maxTimeout - the longest wait in milli seconds after a retransmission, each one waits twice as long
+ *              as the one before up to this, 0 for PIPELINE_MAX_BACKOFF timeouts
+ * hedgeDelay - milli seconds after which a second copy is sent if no response came, HEDGE_P95 for the
+ *              95th percentile of the recent latencies, HEDGE_OFF to never hedge
+ */
+void setRetryPolicy(struct request_pipeline * pipeline, int retries, int maxTimeout, int hedgeDelay);
+
+/*
+ * Spreads the requests over a pool of servers instead of sending them all to the server given
+ * to openPipeline. Retransmissions and hedges may go to another server than the first send.
+ *
+ * pipeline - the pipeline
+ * pool     - the servers, made by createPool on the socket of the pipeline
+ */
+void usePool(struct request_pipeline * pipeline, struct server_pool * pool);
+
+/*
+ * Sends a request with a new correlation ID without waiting for the response.
+ *
+ * pipeline - the pipeline to send on
+ * request  - the request to be sent encoded as a string
+ *
+ * return   - the ID of the request, 0 if the pipeline is full or the request could not be sent
+ */
+uint64_t submitRequest(struct request_pipeline * pipeline, char * request);
+
+/*
+ * Waits for the next response or timeout of a request in flight.
+ *
+ * pipeline - the pipeline to wait on
+ * result   - filled in with the ID and the response or the timeout of one request
+ * wait     - the milli seconds to wait, -1 waits until a request completes or times out
+ *
+ * return   - 1 if result was filled in, 0 if nothing happened in time or no request is in flight,
+ *            a negative number if the socket failed
+ */
+int pollResponse(struct request_pipeline * pipeline, struct request_result * result, int wait);
+
+/*
+ * Gets the number of requests in flight.
+ *
+ * pipeline - the pipeline
+ *
+ * return   - the number of requests sent that have not completed or timed out
+ */
+int pendingRequests(struct request_pipeline * pipeline);
+
+/*
+ * Frees a pipeline, the socket is left open.
+ *
+ * pipeline - the pipeline returned by openPipeline
+ */
+void closePipeline(struct request_pipeline * pipeline);
+
+#endif
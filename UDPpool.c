@@ -0,0 +1,243 @@
+/**	@file UDPpool.c
+ * 	@brief Contains the function implementations of the packet buffers of the server loops.
+ *	Each loop maps all the buffers it receives into and sends from once, at a fixed size of cache
+ *	line aligned buffers, and keeps the free ones on a list only it uses, so no request allocates,
+ *	clears or copies between buffers and the memory a loop touches is known when it starts.
+ *	Large pools go on huge pages, explicit ones when the system reserved some and otherwise
+ *	transparent ones, so the buffers of a loop take a few TLB entries instead of hundreds.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPlog.h"
+#include "UDPpool.h"
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Maps the memory of a pool, on huge pages when it is at least HUGE_PAGE_SIZE, and sets its pages.
+*	@param 	pool is the pool, mapped is the size needed and is rounded up to the pages used.
+*	@return returns 0 on success, -1 if the memory cannot be mapped.
+*/
+int map_Packets(struct packet_pool *pool);
+
+/**	@brief 	Rounds a size up to a whole number of cache lines.
+*	@param 	size is the size in bytes.
+*	@return returns the rounded size.
+*/
+size_t cache_Lines(size_t size);
+
+/*
+ **************************************************
+ *		POOL FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The free list is filled from the top so the first handles taken are the lowest.
+ **************************************************
+ */
+int init_Packets(struct packet_pool *pool, uint32_t count, size_t headroom, size_t size){
+  uint32_t i;
+  memset(pool, 0, sizeof(struct packet_pool));
+  pool->headroom = headroom > 0 ? cache_Lines(headroom) : 0;
+  pool->packetSize = pool->headroom + cache_Lines(size);
+  pool->mapped = (size_t) count * pool->packetSize;
+  pool->free = malloc(count * sizeof(uint32_t));
+  if(pool->free == NULL || map_Packets(pool) == -1) {
+    free(pool->free);
+    pool->free = NULL;
+    pool->memory = NULL;
+    return printErrorMessage("Cannot Map Packet Buffers");
+  }
+  pool->count = count;
+  for(i = 0; i < count; i++)
+    pool->free[i] = count - 1 - i;
+  pool->freeCount = count;
+  return 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void free_Packets(struct packet_pool *pool){
+  if(pool->memory != NULL)
+    munmap(pool->memory, pool->mapped);
+  free(pool->free);
+  memset(pool, 0, sizeof(struct packet_pool));
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+uint32_t take_Packet(struct packet_pool *pool){
+  if(pool->freeCount == 0)
+    return PACKET_NONE;
+  return pool->free[--pool->freeCount];
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void give_Packet(struct packet_pool *pool, uint32_t handle){
+  pool->free[pool->freeCount++] = handle;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Taking a buffer says nothing about its use, the loops hand theirs out when they start.
+ **************************************************
+ */
+void hold_Packet(struct packet_pool *pool, size_t bytes){
+  pool->received++;
+  hold_Reply(pool, bytes);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void hold_Reply(struct packet_pool *pool, size_t bytes){
+  pool->touched += bytes;
+  if(++pool->inFlight > pool->mostInFlight)
+    pool->mostInFlight = pool->inFlight;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void release_Packets(struct packet_pool *pool, uint32_t buffers){
+  pool->inFlight -= buffers;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+char *packet_Data(struct packet_pool *pool, uint32_t handle){
+  return pool->memory + (size_t) handle * pool->packetSize + pool->headroom;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+char *packet_Headroom(struct packet_pool *pool, uint32_t handle){
+  return pool->headroom > 0 ? pool->memory + (size_t) handle * pool->packetSize : NULL;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Explicit huge pages only exist when vm.nr_hugepages reserved them, otherwise the mapping is
+ *	placed on a huge page boundary so the kernel can back it with transparent huge pages.
+ *	The pages are written once here so no request pays for the first fault.
+ **************************************************
+ */
+int map_Packets(struct packet_pool *pool){
+  size_t length = pool->mapped, slack;
+  char *memory;
+  if(length < HUGE_PAGE_SIZE) {
+    pool->mapped = length = (length + sysconf(_SC_PAGESIZE) - 1) & ~((size_t) sysconf(_SC_PAGESIZE) - 1);
+    pool->memory = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    pool->pages = PAGES_SMALL;
+    return pool->memory == MAP_FAILED ? -1 : 0;
+  }
+  pool->mapped = length = (length + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+  pool->memory = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+  if(pool->memory != MAP_FAILED) {
+    pool->pages = PAGES_HUGE;
+    return 0;
+  }
+  //map a huge page more than needed and cut the mapping down to the aligned part
+  memory = mmap(NULL, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(memory == MAP_FAILED)
+    return -1;
+  slack = (HUGE_PAGE_SIZE - ((uintptr_t) memory & (HUGE_PAGE_SIZE - 1))) & (HUGE_PAGE_SIZE - 1);
+  if(slack > 0)
+    munmap(memory, slack);
+  munmap(memory + slack + length, HUGE_PAGE_SIZE - slack);
+  pool->memory = memory + slack;
+  pool->pages = madvise(pool->memory, length, MADV_HUGEPAGE) == 0 ? PAGES_TRANSPARENT : PAGES_SMALL;
+  memset(pool->memory, 0, length);
+  return 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+size_t cache_Lines(size_t size){
+  return (size + CACHE_LINE - 1) & ~((size_t) CACHE_LINE - 1);
+}
+
+
+/*
+ **************************************************
+ *		USAGE FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Every loop of a server has the same pool, the buffer size of any of them is the size of all.
+ **************************************************
+ */
+void count_Packets(struct packet_usage *usage, struct packet_pool *pool){
+  unsigned int used = pool->mostInFlight, highest = atomic_load(&usage->highest);
+  if(pool->memory == NULL)
+    return;
+  atomic_fetch_add(&usage->pools, 1);
+  atomic_fetch_add(&usage->buffers, pool->count);
+  atomic_fetch_add(&usage->mapped, pool->mapped);
+  atomic_fetch_add(&usage->received, pool->received);
+  atomic_fetch_add(&usage->touched, pool->touched);
+  atomic_store(&usage->packetSize, pool->packetSize);
+  atomic_fetch_or(&usage->pages, 1 << pool->pages);
+  while(used > highest && !atomic_compare_exchange_weak(&usage->highest, &highest, used))
+    ;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void print_Packets(struct packet_usage *usage){
+  static const char *names[] = { "4 KB pages", "transparent huge pages", "huge pages" };
+  int pages = atomic_load(&usage->pages), i, printed = 0;
+  unsigned long received = atomic_load(&usage->received);
+  if(atomic_load(&usage->pools) == 0)
+    return;
+  printf("Packet buffers: %d pool(s) of %u buffers of %zu bytes, %zu KB mapped on ", atomic_load(&usage->pools),
+         atomic_load(&usage->buffers) / atomic_load(&usage->pools), atomic_load(&usage->packetSize), atomic_load(&usage->mapped) >> 10);
+  for(i = PAGES_SMALL; i <= PAGES_HUGE; i++)
+    if(pages & (1 << i))
+      printf("%s%s", printed++ > 0 ? " and " : "", names[i]);
+  printf(", at most %u in flight in one loop", atomic_load(&usage->highest));
+  if(received > 0)
+    printf(", %.0f bytes touched per request", (double) atomic_load(&usage->touched) / received);
+  printf("\n");
+}
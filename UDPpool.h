@@ -0,0 +1,158 @@
+/**	@file UDPpool.h
+ * 	@brief Contains the function prototypes for the packet buffers every server loop receives into and
+ *	sends from, mapped once when the loop starts and handed out by handle, implemented in UDPpool.c
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPPOOL_H
+#define UDPPOOL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define PACKET_NONE UINT32_MAX		//the handle take_Packet returns when every buffer is in use
+#define HUGE_PAGE_SIZE (2UL << 20)	//pools at least this large are mapped on huge pages
+#define PAGES_SMALL 0				//kinds of pages a pool is mapped on
+#define PAGES_TRANSPARENT 1
+#define PAGES_HUGE 2
+
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+/**	@brief 	The packet buffers of one server loop, count buffers of packetSize bytes in one mapping.
+*			Every buffer starts on a cache line with headroom bytes for the control messages of the
+*			datagram, its data follows on the next cache line. A buffer is named by its handle, the
+*			number of the buffer, free holds the handles not in use with freeCount of them on top.
+*			A loop takes most of its buffers when it starts, inFlight counts the ones that hold a
+*			request or its reply right now and mostInFlight the most that ever did. received counts
+*			the datagrams received into the pool and touched the bytes written into it for them.
+*			Only the loop that owns the pool takes and gives back buffers and counts them, other
+*			threads may read and write the buffers it handed them.
+*/
+struct packet_pool {
+  char *memory;
+  size_t mapped;
+  size_t packetSize;
+  size_t headroom;
+  uint32_t count;
+  uint32_t *free;
+  uint32_t freeCount;
+  uint32_t inFlight;
+  uint32_t mostInFlight;
+  uint64_t received;
+  uint64_t touched;
+  int pages;
+};
+
+/**	@brief 	What the pools of every server loop mapped, added up by count_Packets as the loops finish.
+*			highest is the most buffers one loop had in flight, received and touched add up the datagrams
+*			and the bytes written for them. pages has a bit set for every kind of page a pool was mapped on.
+*/
+struct packet_usage {
+  atomic_int pools;
+  atomic_uint buffers;
+  atomic_uint highest;
+  atomic_ulong received;
+  atomic_ulong touched;
+  atomic_size_t mapped;
+  atomic_size_t packetSize;
+  atomic_int pages;
+};
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Maps the buffers of a pool and faults them in, on huge pages when the pool is large enough.
+*	@param 	pool is the pool to set up.
+*			count is the number of buffers.
+*			headroom is the room in front of the data of every buffer, rounded up to a cache line.
+*			size is the data of every buffer, rounded up to a cache line.
+*	@return returns 0 on success, -1 if the buffers cannot be mapped.
+*/
+int init_Packets(struct packet_pool *pool, uint32_t count, size_t headroom, size_t size);
+
+/**	@brief 	Unmaps the buffers of a pool, none may still be in use.
+*	@param 	pool is the pool set up by init_Packets or zeroed.
+*	@return returns nothing.
+*/
+void free_Packets(struct packet_pool *pool);
+
+/**	@brief 	Takes a free buffer. A new pool hands out its handles from 0 up.
+*	@param 	pool is the pool.
+*	@return returns the handle of the buffer, PACKET_NONE if every buffer is in use.
+*/
+uint32_t take_Packet(struct packet_pool *pool);
+
+/**	@brief 	Puts a buffer back on the free list.
+*	@param 	pool is the pool.
+*			handle is the buffer returned by take_Packet.
+*	@return returns nothing.
+*/
+void give_Packet(struct packet_pool *pool, uint32_t handle);
+
+/**	@brief 	Counts a buffer that a datagram was just received into as in flight.
+*	@param 	pool is the pool.
+*			bytes is what the datagram and its control messages wrote into the buffer.
+*	@return returns nothing.
+*/
+void hold_Packet(struct packet_pool *pool, size_t bytes);
+
+/**	@brief 	Counts a buffer that the reply to a held datagram was just written into as in flight.
+*	@param 	pool is the pool.
+*			bytes is the length of the reply.
+*	@return returns nothing.
+*/
+void hold_Reply(struct packet_pool *pool, size_t bytes);
+
+/**	@brief 	Stops counting buffers as in flight once their reply was sent or the request dropped.
+*	@param 	pool is the pool.
+*			buffers is the number of buffers held for the request.
+*	@return returns nothing.
+*/
+void release_Packets(struct packet_pool *pool, uint32_t buffers);
+
+/**	@brief 	Finds the data of a buffer.
+*	@param 	pool is the pool.
+*			handle is the buffer.
+*	@return returns the data, packetSize - headroom bytes.
+*/
+char *packet_Data(struct packet_pool *pool, uint32_t handle);
+
+/**	@brief 	Finds the headroom of a buffer, where the control messages of its datagram go.
+*	@param 	pool is the pool.
+*			handle is the buffer.
+*	@return returns the start of the buffer, NULL when the pool has no headroom.
+*/
+char *packet_Headroom(struct packet_pool *pool, uint32_t handle);
+
+/**	@brief 	Adds the size of a pool, the most buffers it had in flight and the bytes it touched to the usage of the server.
+*	@param 	usage is the usage of every pool.
+*			pool is the pool of a server loop that finished, may be unused.
+*	@return returns nothing.
+*/
+void count_Packets(struct packet_usage *usage, struct packet_pool *pool);
+
+/**	@brief 	Prints what the pools of the server loops mapped, the most buffers one of them had in flight
+*			and the bytes written into the buffers per request.
+*	@param 	usage is the usage of every pool.
+*	@return returns nothing.
+*/
+void print_Packets(struct packet_usage *usage);
+
+#endif
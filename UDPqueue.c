@@ -0,0 +1,107 @@
+/**	@file UDPqueue.c
+ * 	@brief Contains the function implementations of the bounded queue between the server loops and
+ *	the handler threads. Each cell carries a sequence number, a thread claims a position with a
+ *	compare and swap on head or tail and then hands the cell over by moving its sequence on,
+ *	so pushers and poppers on different cells never wait for each other.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPqueue.h"
+
+/*
+ **************************************************
+ *		QUEUE FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	A single cell would look free again right after it was filled, so there are at least two.
+ **************************************************
+ */
+int init_Queue(struct request_queue *queue, int depth){
+  size_t size = 2, i;
+  while(size < (size_t) depth)
+    size <<= 1;
+  queue->cells = malloc(size * sizeof(struct queue_cell));
+  if(queue->cells == NULL)
+    return -1;
+  for(i = 0; i < size; i++) {
+    atomic_init(&queue->cells[i].sequence, i);
+    queue->cells[i].data = NULL;
+  }
+  queue->mask = size - 1;
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+  return 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void free_Queue(struct request_queue *queue){
+  free(queue->cells);
+  queue->cells = NULL;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	A cell whose sequence is behind the position still holds a pointer from the last lap, the queue is full.
+ **************************************************
+ */
+int push_Queue(struct request_queue *queue, void *data){
+  struct queue_cell *cell;
+  size_t position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  intptr_t difference;
+  for(;;) {
+    cell = &queue->cells[position & queue->mask];
+    difference = (intptr_t) atomic_load_explicit(&cell->sequence, memory_order_acquire) - (intptr_t) position;
+    if(difference == 0) {
+      if(atomic_compare_exchange_weak_explicit(&queue->head, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+        break;
+    }
+    else if(difference < 0)
+      return -1;
+    else
+      position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  }
+  cell->data = data;
+  atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+  return 0;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The popped cell is handed to the pusher of the next lap by moving its sequence a whole queue on.
+ **************************************************
+ */
+void *pop_Queue(struct request_queue *queue){
+  struct queue_cell *cell;
+  size_t position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  intptr_t difference;
+  void *data;
+  for(;;) {
+    cell = &queue->cells[position & queue->mask];
+    difference = (intptr_t) atomic_load_explicit(&cell->sequence, memory_order_acquire) - (intptr_t) (position + 1);
+    if(difference == 0) {
+      if(atomic_compare_exchange_weak_explicit(&queue->tail, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+        break;
+    }
+    else if(difference < 0)
+      return NULL;
+    else
+      position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  }
+  data = cell->data;
+  atomic_store_explicit(&cell->sequence, position + queue->mask + 1, memory_order_release);
+  return data;
+}
@@ -0,0 +1,74 @@
+/**	@file UDPqueue.h
+ * 	@brief Contains the function prototypes for the bounded queue the server loops and the handler
+ *	threads pass requests through, implemented in UDPqueue.c
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPQUEUE_H
+#define UDPQUEUE_H
+
+#include "UDPlog.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+/**	@brief 	One cell of a queue. sequence tells a pusher the cell is free when it equals the position
+*			being pushed and a popper it is full when it is one past the position being popped.
+*/
+struct queue_cell {
+  atomic_size_t sequence;
+  void *data;
+};
+
+/**	@brief 	A bounded queue of pointers any number of threads push to and pop from without locks.
+*			head is the next position pushed and tail the next one popped, on their own cache lines
+*			since pushers and poppers are usually different threads. mask is the number of cells less one.
+*/
+struct request_queue {
+  struct queue_cell *cells;
+  size_t mask;
+  _Alignas(CACHE_LINE) atomic_size_t head;
+  _Alignas(CACHE_LINE) atomic_size_t tail;
+};
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Allocates the cells of a queue.
+*	@param 	queue is the queue to set up.
+*			depth is the number of pointers it holds, rounded up to a power of two of at least 2.
+*	@return returns 0 on success, -1 if the cells cannot be allocated.
+*/
+int init_Queue(struct request_queue *queue, int depth);
+
+/**	@brief 	Frees the cells of a queue, the pointers still in it are left alone.
+*	@param 	queue is the queue set up by init_Queue.
+*	@return returns nothing.
+*/
+void free_Queue(struct request_queue *queue);
+
+/**	@brief 	Adds a pointer to the end of a queue.
+*	@param 	queue is the queue.
+*			data is the pointer.
+*	@return returns 0 on success, -1 if the queue is full.
+*/
+int push_Queue(struct request_queue *queue, void *data);
+
+/**	@brief 	Takes the pointer at the front of a queue.
+*	@param 	queue is the queue.
+*	@return returns the pointer, NULL if the queue is empty.
+*/
+void *pop_Queue(struct request_queue *queue);
+
+#endif
@@ -7,15 +7,30 @@
  *	Messages can be sent to the server in the following format:
  *	<echo>message</echo>
  *	<loadavg/>
- *	<shutdown/>
+ *	<shutdown/> from the same host, or <shutdown>token</shutdown> when the server was given a shutdown token
+ *	<limits/>
+ *	<stats/>
+ *	<trace/>
  *	If a message is sent that is not in the above format, 
  *	server responses with <error>unknown format</error>.
+ *	The same commands can be sent in the binary form of UDPbinary.h on the same port.
  * 	@author Cole Amick
  * 	@author Daniel Davis
  * 	@bug No known bugs!
  */
  
 #include "UDPserver.h"
+#include "UDPlog.h"
+#include "UDPdispatch.h"
+#include "UDPloadavg.h"
+#include "UDPevent.h"
+#include "UDPuring.h"
+#include "UDPlimit.h"
+#include "UDPstats.h"
+#include "UDPtrace.h"
+#include "UDPbuffer.h"
+#include "UDPhandlers.h"
+#include <stdarg.h>
 
 /*
  **************************************************
@@ -23,64 +38,197 @@
  **************************************************
  */
  
-/**	@brief 	Is a function that takes in a error message and outputs the message to the display
-*			and stops the server from running. 
-*	@param 	Is the error message that should be outputted to the screen.
+/**	@brief 	Modifies the sent message and return the modified message to the client. 
+*	@param 	worker is the server loop that received the message, it holds the socket used for communication. 
+*			cliaddr is a structure containing the connected client identification
+*			recvMesg is a char array containing the client message that was sent to the server. 
+*			length is the number of bytes received.
+*			trace is the stamps of the message, started by start_Trace.
+*	@return returns the message_opcode of the reply or -1 if there was nothing to reply yet.
+*/
+int handleMessage(struct server_worker *worker, struct sockaddr_in6 cliaddr, char *recvMesg, int length, struct request_trace *trace);
+
+
+/**	@brief 	Reads every datagram queued on a socket and answers it, called by the event loop
+*			when the socket becomes readable.
+*	@param 	source is the socket, its arg is the server_worker that owns it.
+*			events is the epoll event mask.
 *	@return returns nothing. 
 */
-void printErrorMessage( char *message );
+void serve_Socket(struct event_source *source, uint64_t events);
 
 
-/**	@brief 	Modifies the sent message and return the modified message to the client. 
-*	@param 	sockfd is the sock that the server is using for communation. 
-*			cliaddr is a structure containing the connected client identification
-*			recvMesg is a char array containing the client message that was sent to the server. 
-*	@return returns a 1 if the shutdown command has been given else returns 0.
+/**	@brief 	Batched version of serve_Socket, receives up to batchSize datagrams per recvmmsg call
+*			and flushes all of their replies with one sendmmsg call. 
+*	@param 	source is the socket, its arg is the server_worker that owns it.
+*			events is the epoll event mask.
+*	@return returns nothing. 
+*/
+void serve_Batch(struct event_source *source, uint64_t events);
+
+
+/**	@brief 	Drains the server when SIGINT or SIGTERM arrives through the signalfd, 
+*			a second signal during the drain stops it right away.
+*	@param 	source is the signalfd, its arg is the server_config.
+*			signal is the number of the signal.
+*	@return returns nothing. 
 */
-int handleMessage(int sockfd, struct sockaddr_in cliaddr, char *recvMesg);
+void signal_Received(struct event_source *source, uint64_t signal);
 
 
-/**	@brief 	Determines if the message is a valid ECHO or LOADAVG command or
-*			if the message is a error message, and makes decisions based upon this.
-*	@param 	*recvMesg is a char array containing the client message that was sent to the server.
-*			*send is the char array representing the message to be sent back to the client. 
-*	@return returns a 1 if the shutdown command has been given else returns 0.
+/**	@brief 	Timer callback that takes a new load average sample.
+*	@param 	source is the timer, its arg is the loadavg_sampler.
+*			expirations is the number of times the timer fired since the last call.
+*	@return returns nothing. 
+*/
+void refresh_Loadavg(struct event_source *source, uint64_t expirations);
+
+
+/**	@brief 	Timer callback that stops the server once its run time is over.
+*	@param 	source is the timer, its arg is the server_config.
+*			expirations is the number of times the timer fired.
+*	@return returns nothing. 
+*/
+void run_Time_Over(struct event_source *source, uint64_t expirations);
+
+
+/**	@brief 	Timer callback that copies the request counters into the metrics file.
+*	@param 	source is the timer, its arg is the server_stats.
+*			expirations is the number of times the timer fired since the last call.
+*	@return returns nothing. 
 */
-int modifyMessage(char *recvMesg, char *send);
+void refresh_Stats(struct event_source *source, uint64_t expirations);
+
+
+/**	@brief 	Answers every datagram still queued on the sockets of a server loop, called once its event loop
+*			has left because a drain started.
+*	@param 	worker is the server loop.
+*	@return returns nothing.
+*/
+void drain_Sockets(struct server_worker *worker);
+
+
+/**	@brief 	Compares the token a <shutdown> carries with the token of the server in constant time.
+*	@param 	config is the shared configuration.
+*			client is the address the request came from.
+*			token is the body of the request.
+*			length is the length of the body.
+*	@return returns 1 if the tokens match, or if the server has no token and the client is on
+*			the loopback address, 0 otherwise.
+*/
+int shutdown_Authorized(struct server_config *config, struct sockaddr_in6 *client, const char *token, int length);
+
+
+/**	@brief 	Builds the reply to a binary message, the header names the command by its opcode.
+*	@param 	worker is the server loop that received the message.
+*			recvMesg is the message starting with its binary header.
+*			length is the length of the message.
+*			reply is the reply that is built, it starts with a binary header and may point into recvMesg.
+*	@return returns the message_opcode of the command, OPCODE_ERROR if it is not a valid binary request.
+*/
+int binaryMessage(struct server_worker *worker, char *recvMesg, int length, struct message_reply *reply);
+
+
+/**	@brief 	Makes a binary error reply.
+*	@param 	reply is the reply to set.
+*			id is the ID of the request.
+*			text is the error, it is not copied.
+*	@return returns nothing.
+*/
+void binaryError(struct message_reply *reply, uint64_t id, const char *text);
+
+
+/**	@brief 	Runs the command the message carries through the dispatch table or
+*			replies with an error if the message is not a known command.
+*	@param 	worker is the server loop that received the message.
+*			*recvMesg is a char array containing the client message that was sent to the server.
+*			length is the length of the message without padding or the ending newline.
+*			*reply is the reply representing the message to be sent back to the client. 
+*	@return returns the message_opcode of the command, OPCODE_ERROR if it is not a known command.
+*/
+int modifyMessage(struct server_worker *worker, char *recvMesg, int length, struct message_reply *reply);
 
 
 /**	@brief 	The client sent a message in the ECHO header and should be returned to the client
 *			in REPLY headers. 
-*	@param 	*recvMesg is a char array containing the client message that was sent to the server. 
-*			*send is the char array representing the message to be sent back to the client. 
+*	@param 	*request is the parsed <echo> message, its body is the text between the tags. 
+*			*reply is the reply to the client, the echoed text is a slice of the message and is not copied. 
+*	@return returns nothing. 
+*/
+void echoMessage(struct command_request *request, struct message_reply *reply);
+
+
+/**	@brief 	Binary form of echoMessage, the reply payload is the request payload. 
+*	@param 	*request is the binary request, its body is the payload.
+*			*reply is the reply payload, a slice of the request. 
 *	@return returns nothing. 
 */
-void echoMessage(char *recvMesg, char *send);
+void echoBinary(struct command_request *request, struct message_reply *reply);
 
 
 /**	@brief 	The client sent the <loadavg/> message and therefore the load average
 *			on the server for 1:5:15 minutes.
-*	@param 	*recvMesg is a char array containing the keyword -> <loadavg/>
-*			*send is a char array containing the load average calculations. 
+*	@param 	*request is the parsed <loadavg/> message.
+*			*reply is the reply, it points at the reply the sampler rendered last. 
 *	@return returns nothing. 
 */
-void loadavgMessage(char *recvMesg, char *send);
+void loadavgMessage(struct command_request *request, struct message_reply *reply);
 
 
-/**	@brief	The client sent the server a invalid message and must be returned
-*			to the client as a invalid input. 
-*	@param 	*recvMesg is a char array contains the message that the client sent to the server.
-*			*send is the char array representing the message to be sent back to the client. 
-*	@return	returns nothing. 
+/**	@brief 	Binary form of loadavgMessage, the reply payload holds the load averages as fixed point numbers. 
+*	@param 	*request is the binary request.
+*			*reply is the reply payload the sampler rendered last. 
+*	@return returns nothing. 
+*/
+void loadavgBinary(struct command_request *request, struct message_reply *reply);
+
+
+/**	@brief 	The client sent the <shutdown/> message, the server replies and drains if the request
+*			carries the shutdown token, or comes from the loopback address when there is no token.
+*			Otherwise it replies with <error>not authorized</error>.
+*	@param 	*request is the parsed <shutdown/> message, its body is the token.
+*			*reply is the reply telling the client the server is shutting down. 
+*	@return returns nothing. 
+*/
+void shutdownMessage(struct command_request *request, struct message_reply *reply);
+
+
+/**	@brief 	The client sent the <limits/> message, the reply holds the number of requests
+*			the rate limits dropped for each limited command.
+*	@param 	*request is the parsed <limits/> message.
+*			*reply is the reply holding the drop counters. 
+*	@return returns nothing. 
 */
-void errorMessage(char *recvMesg, char *send);
+void limitsMessage(struct command_request *request, struct message_reply *reply);
 
 
-/**	@brief	Used to reverse a string pass into the function. 
-*	@param	*original is the string to reverse, it directly modifies this char array 
+/**	@brief 	The client sent the <stats/> message, the reply holds the request counters of every
+*			server loop added up: the bytes received and sent, the requests dropped and the replies
+*			that failed, the median and 99th percentile latency in nano seconds and the requests of each command.
+*	@param 	*request is the parsed <stats/> message.
+*			*reply is the reply holding the counters. 
+*	@return returns nothing. 
+*/
+void statsMessage(struct command_request *request, struct message_reply *reply);
+
+
+/**	@brief 	The client sent the <trace/> message, the reply holds the stage histograms of the traced
+*			requests of every server loop added up: the time in the socket queue, building the reply and
+*			sending it, each as the median, 99th percentile and slowest bucket in nano seconds.
+*	@param 	*request is the parsed <trace/> message.
+*			*reply is the reply holding the stages. 
+*	@return returns nothing. 
+*/
+void traceMessage(struct command_request *request, struct message_reply *reply);
+
+
+/**	@brief	The client sent the server a invalid message and must be returned
+*			to the client as a invalid input. 
+*	@param 	*recvMesg is a char array contains the message that the client sent to the server.
+*			*reply is the reply representing the message to be sent back to the client. 
 *	@return	returns nothing. 
 */
-void reverseString(char *original);
+void errorMessage(char *recvMesg, struct message_reply *reply);
 
 
 /*
@@ -91,11 +239,13 @@ void reverseString(char *original);
  
 /*
  **************************************************
+ *	MODIFIED ON 10/17/2026
+ *	Returns -1 instead of calling exit so the callers can free what they set up and hand the error up
  **************************************************
  */
-void printErrorMessage( char *message ) {	
+int printErrorMessage( char *message ) {	
   fprintf(stderr, "ERROR: %s\n", message);
-  exit(1);
+  return -1;
 }
 
 
@@ -103,29 +253,58 @@ void printErrorMessage( char *message ) {
  **************************************************
  *	MODIFIED ON 2/6/2014
  *	Changed to SOCK_DGRAM
+ *	MODIFIED ON 10/17/2026
+ *	Dual stack, IPv4 clients arrive as v4 mapped IPv6 addresses
  **************************************************
  */
 int create_UDP_Socket(void){
-  int sockfd = socket(AF_INET, SOCK_DGRAM,0);
+  int sockfd = socket(AF_INET6, SOCK_DGRAM,0), off = 0;
   if(sockfd == -1)
 	printErrorMessage("Cannot Open Socket to Listen"); 
+  else if(setsockopt(sockfd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off)) == -1) {
+	printErrorMessage("Cannot Accept IPv4 on the Socket");
+    close(sockfd);
+    return -1;
+  }
   return sockfd;
 }
 
 
 /*
  **************************************************
+ *	ADDED ON 10/17/2026
+ *	Replaces the lookup of the host name, which failed on hosts whose name does not resolve,
+ *	and the SIOCGIFADDR of one fixed interface. Loopback and link local addresses are left out.
  **************************************************
  */
-struct hostent *info_Host(void) {
-  char hostname[IP_4];
-  struct hostent *hostptr; 
-  if(gethostname(hostname, IP_4) == -1) 
-	printErrorMessage("Cannot Get The Host Name");
-  hostptr = gethostbyname(hostname);
-  if(hostptr == NULL) 
-	printErrorMessage("That Host Does Not Exist");
-  return hostptr;
+void discover_Host(struct server_config *config){
+  struct ifaddrs *interfaces, *interface;
+  struct host_address *address;
+  const void *raw;
+
+  if(gethostname(config->hostname, sizeof(config->hostname)) == -1)
+    snprintf(config->hostname, sizeof(config->hostname), "unknown");
+  config->hostname[sizeof(config->hostname) - 1] = '\0';
+  config->addressCount = 0;
+  if(getifaddrs(&interfaces) == -1) {
+	printErrorMessage("Cannot List the Network Interfaces");
+    return;
+  }
+  for(interface = interfaces; interface != NULL && config->addressCount < MAX_HOST_ADDRESSES; interface = interface->ifa_next) {
+    if(interface->ifa_addr == NULL || (interface->ifa_flags & IFF_LOOPBACK))
+      continue;
+    if(interface->ifa_addr->sa_family == AF_INET)
+      raw = &((struct sockaddr_in *) interface->ifa_addr)->sin_addr;
+    else if(interface->ifa_addr->sa_family == AF_INET6 && !IN6_IS_ADDR_LINKLOCAL(&((struct sockaddr_in6 *) interface->ifa_addr)->sin6_addr))
+      raw = &((struct sockaddr_in6 *) interface->ifa_addr)->sin6_addr;
+    else
+      continue;
+    address = &config->addresses[config->addressCount++];
+    snprintf(address->interface, sizeof(address->interface), "%s", interface->ifa_name);
+    address->family = interface->ifa_addr->sa_family;
+    inet_ntop(address->family, raw, address->text, sizeof(address->text));
+  }
+  freeifaddrs(interfaces);
 }
 
 
@@ -133,43 +312,134 @@ struct hostent *info_Host(void) {
  **************************************************
  *	MODIFIED ON 2/6/2014
  *	Lien 144: Server port is set from user input given to function as parameter
+ *	MODIFIED ON 10/17/2026
+ *	The IPv6 wildcard address, the host entry it copied was overwritten with INADDR_ANY anyway
  **************************************************
  */
-struct sockaddr_in destination_Address( struct hostent *hostptr, int SERVER_PORT) {
-  struct sockaddr_in servaddr;
+struct sockaddr_in6 destination_Address(int SERVER_PORT) {
+  struct sockaddr_in6 servaddr;
   memset((void *) &servaddr, 0, (size_t) sizeof(servaddr));
-  memcpy((void *) &servaddr.sin_addr, (void *) hostptr->h_addr, hostptr->h_length);
-  servaddr.sin_family = (AF_INET);
-  servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
-  servaddr.sin_port = htons(SERVER_PORT);
+  servaddr.sin6_family = AF_INET6;
+  servaddr.sin6_addr = in6addr_any;
+  servaddr.sin6_port = htons(SERVER_PORT);
   return servaddr;
 }
 
 
 /*
  **************************************************
+ *	ADDED ON 10/17/2026
  **************************************************
  */
-struct sockaddr_in bind_Socket(int sockfd, struct sockaddr_in servaddr){
+int format_Address(const struct in6_addr *addr, int port, char *text, int size){
+  char address[INET6_ADDRSTRLEN];
+  if(IN6_IS_ADDR_V4MAPPED(addr)) {
+    inet_ntop(AF_INET, &addr->s6_addr[12], address, sizeof(address));
+    return snprintf(text, size, "%s:%d", address, port);
+  }
+  inet_ntop(AF_INET6, addr, address, sizeof(address));
+  return snprintf(text, size, "[%s]:%d", address, port);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int bind_Socket(int sockfd, struct sockaddr_in6 servaddr){
   if(bind(sockfd, (struct sockaddr *) &servaddr, (socklen_t) sizeof(servaddr)) == -1)
-	printErrorMessage("Failed to Bind To Socket");  
-  return servaddr;
+	return printErrorMessage("Failed to Bind To Socket");  
+  return 0;
 }
 
 /*
  **************************************************
+ *	MODIFIED ON 10/17/2026
+ *	Prints the interface addresses discover_Host found instead of asking for the address of eth0
  **************************************************
  */
-void print_Server_info(int sockfd, struct hostent *hostptr, struct sockaddr_in servaddr){
-  struct ifreq ifr;
-  ifr.ifr_addr.sa_family = AF_INET;
-  strncpy(ifr.ifr_name, INTERFACE, IFNAMSIZ-1);
-  if(ioctl(sockfd, SIOCGIFADDR, &ifr) == -1)
-	printErrorMessage("Cannot Get Server IP Address");
-  
-  printf("\nHostname Name : %s\n", hostptr->h_name);
-  printf("Host IP Address : %s\n", inet_ntoa(((struct sockaddr_in *)&ifr.ifr_addr)->sin_addr));
-  printf("Host Port Number : %i\n\n", htons(servaddr.sin_port));
+void print_Server_info(struct server_config *config){
+  struct sockaddr_in6 *servaddr = &config->listeners[0];
+  char address[MAX_ADDRESS_TEXT];
+  int i;
+  printf("\nHostname Name : %s\n", config->hostname);
+  if(!IN6_IS_ADDR_UNSPECIFIED(&servaddr->sin6_addr)) {
+    format_Address(&servaddr->sin6_addr, ntohs(servaddr->sin6_port), address, sizeof(address));
+    printf("Host IP Address : %s\n", address);
+  }
+  else {
+    for(i = 0; i < config->addressCount; i++)
+      printf("Host IP Address : %s %s\n", config->addresses[i].interface, config->addresses[i].text);
+    if(config->addressCount == 0)
+      printf("Host IP Address : every address of the host\n");
+  }
+  printf("Host Port Number : %i\n\n", ntohs(servaddr->sin6_port));
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+void print_Listeners(struct server_config *config){
+  char address[MAX_ADDRESS_TEXT];
+  int i;
+  for(i = 1; i < config->listenerCount; i++) {
+    format_Address(&config->listeners[i].sin6_addr, ntohs(config->listeners[i].sin6_port), address, sizeof(address));
+    printf("Also Listening On : %s\n", address);
+  }
+  if(config->listenerCount > 1)
+    printf("\n");
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Returns -1 instead of stopping the server when the state cannot be allocated
+ **************************************************
+ */
+int init_Worker(struct server_worker *worker, int id, struct server_config *config){
+  memset(worker, 0, sizeof(struct server_worker));
+  worker->id = id;
+  worker->cpu = -1;
+  worker->config = config;
+  worker->log = log_Ring(config->log, id);
+  worker->stats = &config->stats->worker[id];
+  worker->reassembly = malloc(sizeof(struct reassembly_table));
+  worker->fragments = malloc(sizeof(struct fragment_set));
+  if(worker->reassembly == NULL || worker->fragments == NULL) {
+    free(worker->reassembly);
+    worker->reassembly = NULL;
+    return printErrorMessage("Cannot Allocate Worker");
+  }
+  init_Reassembly(worker->reassembly, config->maxMessage);
+  if(config->limits != NULL && (worker->clients = create_Client_Table(config->limits->clients)) == NULL)
+    return -1;
+  return 0;
+}
+
+
+/*
+ **************************************************
+ *	MODIFIED ON 10/17/2026
+ *	Also closes the sockets, run_Server leaves them open so nothing is lost before the server finished
+ **************************************************
+ */
+void free_Worker(struct server_worker *worker){
+  int i;
+  if(worker->reassembly != NULL)
+    free_Reassembly(worker->reassembly);
+  free(worker->reassembly);
+  free(worker->fragments);
+  free_Client_Table(worker->clients);
+  free_Dispatch(worker->dispatch);
+  worker->dispatch = NULL;
+  free_Packets(&worker->packets);
+  for(i = 0; i < worker->socketCount; i++)
+    close(worker->sockets[i]);
+  worker->socketCount = 0;
 }
 
 
@@ -180,31 +450,489 @@ void print_Server_info(int sockfd, struct hostent *hostptr, struct sockaddr_in s
  *	REMOVED "accept", "pthread_create", "pthreada_detach", "pthread_exit.
  *	Combined this function with the original "run_Server" and "receiveMessage" function from the TCPserver program since we do not have threads
  *	Used Bzero rather than memset
+ *	MODIFIED ON 10/17/2026
+ *	Stops on the shared shutdown flag so every worker thread leaves its loop
+ *	No longer prints while waiting, requests are logged through the log ring of the worker
+ *	Waits in an epoll event loop on every listening socket of the worker instead of blocking in recvfrom,
+ *	the first worker also handles the signals and runs the timers that are shared by the whole server
+ *	Hands the worker to the io_uring loop when that backend was chosen
+ *	The event loop ends when a drain starts, what is still queued on the sockets is answered before
+ *	leaving and the sockets stay open until free_Worker. A failure stops every loop instead of the process.
+ *	MODIFIED ON 10/17/2026
+ *	With handler threads the loop only receives and sends, its request slots are freed by free_Worker
+ *	once the handlers stopped. The drain also waits for the replies to what it handed out.
+ *	MODIFIED ON 10/17/2026
+ *	Every buffer the loop receives into and sends from is mapped up front in its packet pool,
+ *	a request slot takes one for its datagram and one for its reply. The pool is freed by free_Worker.
  **************************************************
  */
+int run_Server(struct server_worker *worker){
+  struct server_config *config = worker->config;
+  struct event_loop loop;
+  event_callback serve = config->batchSize > 1 ? serve_Batch : serve_Socket;
+  int i, result = -1, packets = config->handlers != NULL ? 2 * config->queueDepth + 1 : config->batchSize;
+  
+  if(config->backend != BACKEND_EPOLL)
+    return run_Server_Uring(worker);
+  if(init_Packets(&worker->packets, packets, control_Size(config), config->datagramSize + 1) == -1) { //room for the terminating null character
+    stop_Server(config);
+    return -1;
+  }
+  worker->recvPacket = PACKET_NONE;
+  if(config->handlers != NULL) {
+    worker->dispatch = create_Dispatch(worker);
+    serve = serve_Dispatch;
+  }
+  else if(config->batchSize > 1)
+    worker->batch = create_Batch(&worker->packets, config->batchSize, config->datagramSize, control_Size(config));
+  else
+    worker->recvPacket = take_Packet(&worker->packets);
+  
+  if((worker->batch != NULL || worker->recvPacket != PACKET_NONE || worker->dispatch != NULL) && init_Event_Loop(&loop, &config->draining, config->wakefd) == 0) {
+    for(i = 0; i < worker->socketCount; i++)
+      if(add_Socket_Event(&loop, worker->sockets[i], serve, worker) == NULL)
+        break;
+    if(worker->dispatch != NULL && i == worker->socketCount && add_Socket_Event(&loop, worker->dispatch->wakefd, replies_Ready, worker) == NULL)
+      i = -1;
+    //continue receiving until a shutdown command or a signal starts the drain
+    if(i == worker->socketCount && add_Server_Events(worker, &loop) == 0)
+      result = run_Event_Loop(&loop);
+    free_Event_Loop(&loop);
+  }
+  if(result == 0) {
+    drain_Sockets(worker);
+    if(worker->dispatch != NULL)
+      wait_Dispatch(worker);
+  }
+  else
+    stop_Server(config);
+  
+  if(worker->batch != NULL)
+    free_Batch(worker->batch);
+  worker->batch = NULL;
+  count_Packets(&config->packets, &worker->packets);
+  return result;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The serve functions read until the socket is empty or the drain deadline passes.
+ **************************************************
+ */
+void drain_Sockets(struct server_worker *worker){
+  struct event_source source = { .kind = EVENT_SOCKET, .arg = worker };
+  int i;
+  for(i = 0; i < worker->socketCount && !server_Stopped(worker->config); i++) {
+    source.fd = worker->sockets[i];
+    if(worker->dispatch != NULL)
+      serve_Dispatch(&source, EPOLLIN);
+    else if(worker->batch != NULL)
+      serve_Batch(&source, EPOLLIN);
+    else
+      serve_Socket(&source, EPOLLIN);
+  }
+}
+
 
-void run_Server(int sockfd){
-  char recvMesg[MAX_MESSAGE];
-  int shutdown = 0;
-  struct sockaddr_in cliaddr; //used for storing client information
-  socklen_t clilen = sizeof(cliaddr);
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+int add_Server_Events(struct server_worker *worker, struct event_loop *loop){
+  struct server_config *config = worker->config;
+  if(worker->id != 0)
+    return 0;
+  if(add_Signal_Event(loop, &config->signals, signal_Received, config) == NULL)
+    return -1;
+  if(config->loadavg != NULL && add_Timer_Event(loop, config->loadavg->interval, 1, refresh_Loadavg, config->loadavg) == NULL)
+    return -1;
+  if(config->runTime > 0 && add_Timer_Event(loop, config->runTime * 1000, 0, run_Time_Over, config) == NULL)
+    return -1;
+  if(config->stats->file != NULL && add_Timer_Event(loop, config->stats->interval, 1, refresh_Stats, config->stats) == NULL)
+    return -1;
+  return 0;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The socket is edge triggered, so every queued datagram is read before going back to epoll_wait
+ *	MSG_TRUNC returns the real size of a datagram that did not fit so it is not cut off silently
+ *	MODIFIED ON 10/17/2026
+ *	recvmsg replaces recvfrom so the kernel receive timestamp comes with the datagram
+ *	and so does the count of datagrams the socket dropped
+ *	MODIFIED ON 10/17/2026
+ *	The datagram and its control messages go into the packet buffer of the loop
+ **************************************************
+ */
+void serve_Socket(struct event_source *source, uint64_t events){
+  struct server_worker *worker = source->arg;
+  struct server_config *config = worker->config;
+  struct sockaddr_in6 cliaddr; //used for storing client information
+  char *recvMesg = packet_Data(&worker->packets, worker->recvPacket);
+  struct iovec iov = { .iov_base = recvMesg, .iov_len = config->datagramSize };
+  struct msghdr header = { .msg_name = &cliaddr, .msg_iov = &iov, .msg_iovlen = 1 };
+  struct request_trace trace;
+  int received, controlSize = control_Size(config), index = socket_Index(worker, source->fd);
+  uint64_t started;
   
-  //continue receiving from the currently connected client 
-  while(!shutdown) 
+  worker->sockfd = source->fd; //replies leave through the socket the request came in on
+  while(!server_Stopped(config)) {
+    header.msg_namelen = sizeof(cliaddr);
+    header.msg_control = packet_Headroom(&worker->packets, worker->recvPacket);
+    header.msg_controllen = controlSize;
+    received = recvmsg(worker->sockfd, &header, MSG_TRUNC);
+    if(received == -1) {
+      if(errno == EINTR)
+        continue;
+      return; //EAGAIN, the socket is drained
+    }
+    started = log_Clock();
+    hold_Packet(&worker->packets, (received < config->datagramSize ? received : config->datagramSize) + header.msg_controllen);
+    count_Overflow(worker, index, header.msg_control, header.msg_controllen);
+    start_Trace(&trace, config->timestamps, header.msg_control, header.msg_controllen, started, trace_Realtime(config->timestamps));
+    handleMessage(worker, cliaddr, recvMesg, received, &trace);
+    release_Packets(&worker->packets, 1);
+  }
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Batched version of serve_Socket. Each recvmmsg call returns up to batchSize queued datagrams
+ *	and the calls repeat until the socket is drained.
+ *	Fragments that do not complete a message get no reply, and replies too large for one
+ *	datagram are sent as their own fragment set, the rest go out together in one sendmmsg.
+ *	MODIFIED ON 10/17/2026
+ *	A traced datagram that waited behind others of its batch counts that wait as queue time
+ *	MODIFIED ON 10/17/2026
+ *	The drops the socket reported with each datagram are counted
+ *	MODIFIED ON 10/17/2026
+ *	The replies sendmmsg did not take are logged as failed sends
+ **************************************************
+ */
+void serve_Batch(struct event_source *source, uint64_t events){
+  struct server_worker *worker = source->arg;
+  struct server_config *config = worker->config;
+  struct message_batch *batch = worker->batch;
+  int received, sent, flushed, replies, length, i, j, index = socket_Index(worker, source->fd);
+  uint64_t started, realtime;
+  
+  worker->sockfd = source->fd; //replies leave through the socket the request came in on
+  while(!server_Stopped(config)) 
   {
-      bzero(recvMesg, MAX_MESSAGE);
-      printf("Waiting for Connection ......\n");
-      fflush(stdout);
+      //the kernel overwrites the address and control lengths of every slot, reset them before each call
+      for(i = 0; i < batch->size; i++) {
+        batch->recvHdr[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+        batch->recvHdr[i].msg_hdr.msg_controllen = batch->controlSize;
+      }
+      
+      //receive as many queued messages as fit in the batch
+      received = recvmmsg(worker->sockfd, batch->recvHdr, batch->size, 0, NULL);
+      if(received == -1) {
+        if(errno == EINTR)
+          continue;
+        return; //EAGAIN, the socket is drained
+      }
+      started = log_Clock();
+      realtime = trace_Realtime(config->timestamps);
       
-      //receive message from client 
-      recvfrom(sockfd, recvMesg, MAX_MESSAGE, 0,(struct sockaddr *) &cliaddr, &clilen);
+      //build every reply before sending any of them
+      for(i = 0, replies = 0; i < received; i++) {
+        length = batch->recvHdr[i].msg_len;
+        hold_Packet(batch->packets, batch->recvHdr[i].msg_len + batch->recvHdr[i].msg_hdr.msg_controllen);
+        if(batch->recvHdr[i].msg_hdr.msg_flags & MSG_TRUNC)
+          length = config->datagramSize + 1;
+        count_Overflow(worker, index, batch->recvHdr[i].msg_hdr.msg_control, batch->recvHdr[i].msg_hdr.msg_controllen);
+        start_Trace(&batch->trace[i], config->timestamps, batch->recvHdr[i].msg_hdr.msg_control,
+                    batch->recvHdr[i].msg_hdr.msg_controllen, started, realtime);
+        batch->opcode[i] = prepareReply(worker, &batch->cliaddr[i], batch_Buffer(batch, i), length,
+                                        &batch->reply[i], &batch->message[i], &batch->messageLength[i]);
+        if(batch->opcode[i] == -1)
+          continue;
+        end_Handler(&batch->trace[i]);
+        if(batch->reply[i].length > fragment_Payload(config->mtu)) {
+          sent = sendReply(worker, &batch->cliaddr[i], &batch->reply[i]);
+          count_Request(worker, batch->opcode[i], batch->messageLength[i], sent, &batch->trace[i]);
+          log_Request(worker, &batch->cliaddr[i], batch->opcode[i], batch->messageLength[i], sent, &batch->trace[i]);
+          continue;
+        }
+        batch->sendSlot[replies] = i;
+        batch->sendHdr[replies].msg_hdr.msg_iov = batch->reply[i].iov;
+        batch->sendHdr[replies].msg_hdr.msg_iovlen = batch->reply[i].iovlen;
+        batch->sendHdr[replies].msg_hdr.msg_name = &batch->cliaddr[i];
+        batch->sendHdr[replies].msg_hdr.msg_namelen = batch->recvHdr[i].msg_hdr.msg_namelen;
+        replies++;
+      }
       
-      shutdown = handleMessage(sockfd, cliaddr, recvMesg);
+      //flush the replies, sendmmsg may stop early so keep going until all are out
+      for(flushed = 0; flushed < replies; flushed += sent) {
+        sent = sendmmsg(worker->sockfd, batch->sendHdr + flushed, replies - flushed, 0);
+        if(sent <= 0)
+          break;
+      }
+      
+      log_Batch(worker, received, flushed);
+      for(j = 0; j < replies; j++) {
+        i = batch->sendSlot[j];
+        sent = j < flushed ? (int) batch->sendHdr[j].msg_len : -1;
+        count_Request(worker, batch->opcode[i], batch->messageLength[i], sent, &batch->trace[i]);
+        log_Request(worker, &batch->cliaddr[i], batch->opcode[i], batch->messageLength[i], sent, &batch->trace[i]);
+      }
+      
+      //reassembled messages are only needed until their reply is sent
+      for(i = 0; i < received; i++) {
+        free(batch->message[i]);
+        batch->message[i] = NULL;
+      }
+      release_Packets(batch->packets, received);
+  }
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Every loop waits on the wake eventfd, writing it ends all of their waits at once
+ *	MODIFIED ON 10/17/2026
+ *	Also ends a drain that is under way
+ **************************************************
+ */
+void stop_Server(struct server_config *config){
+  uint64_t one = 1;
+  atomic_store(&config->shutdown, 1);
+  atomic_store(&config->draining, 1); //the event loops end on draining, they leave without answering anything more
+  if(config->wakefd >= 0 && write(config->wakefd, &one, sizeof(one)) != sizeof(one))
+    fprintf(stderr, "ERROR: Cannot Wake the Server Loops\n");
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The compare and swap makes sure the deadline is set once and before any loop can see draining,
+ *	a second shutdown or signal does not move it.
+ **************************************************
+ */
+void start_Drain(struct server_config *config, const char *reason){
+  uint64_t one = 1, now = log_Clock(), none = 0;
+  if(!atomic_compare_exchange_strong(&config->drainDeadline, &none, now + (uint64_t) config->drainTime * 1000000ULL))
+    return;
+  config->drainStarted = now;
+  printf("\n%s, draining the server for up to %d ms\n", reason, config->drainTime);
+  printShutdownMessage();
+  atomic_store(&config->draining, 1);
+  if(config->wakefd >= 0 && write(config->wakefd, &one, sizeof(one)) != sizeof(one))
+    fprintf(stderr, "ERROR: Cannot Wake the Server Loops\n");
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The clock is only read once a drain started.
+ **************************************************
+ */
+int server_Stopped(struct server_config *config){
+  uint64_t deadline;
+  if(atomic_load_explicit(&config->shutdown, memory_order_relaxed))
+    return 1;
+  deadline = atomic_load_explicit(&config->drainDeadline, memory_order_relaxed);
+  if(deadline == 0 || log_Clock() < deadline)
+    return 0;
+  stop_Server(config);
+  return 1;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The log thread is stopped here, no server loop writes to its ring any more.
+ *	MODIFIED ON 10/17/2026
+ *	Stops the handler threads before the request slots of the server loops are freed
+ *	MODIFIED ON 10/17/2026
+ *	Prints the packet buffers the server loops mapped and used
+ **************************************************
+ */
+void finish_Server(struct server_config *config){
+  stop_Handlers(config->handlers);
+  if(config->drainStarted != 0)
+    printf("Drained in %.1f ms%s\n", (log_Clock() - config->drainStarted) / 1e6,
+           atomic_load(&config->shutdown) ? ", stopped at the deadline" : "");
+  print_Packets(&config->packets);
+  if(config->stats != NULL && config->stats->file != NULL)
+    flush_Stats(config->stats);
+  stop_Log(config->log);
+  config->log = NULL;
+  fflush(stdout);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+int read_Shutdown_Token(struct server_config *config, const char *path){
+  FILE *file = fopen(path, "r");
+  int length;
+  if(file == NULL)
+    return printErrorMessage("Cannot Open Shutdown Token File");
+  if(fgets(config->token, MAX_SHUTDOWN_TOKEN, file) == NULL)
+    config->token[0] = '\0';
+  fclose(file);
+  length = strcspn(config->token, "\r\n");
+  config->token[length] = '\0';
+  if(length == 0)
+    return printErrorMessage("Shutdown Token File Is Empty");
+  return 0;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	A second signal means the drain takes too long for whoever sent it.
+ **************************************************
+ */
+void signal_Received(struct event_source *source, uint64_t signal){
+  struct server_config *config = source->arg;
+  char reason[32];
+  if(atomic_load(&config->draining)) {
+    printf("\nSignal %d received again, stopping the server\n", (int) signal);
+    stop_Server(config);
+    return;
+  }
+  snprintf(reason, sizeof(reason), "Signal %d received", (int) signal);
+  start_Drain(config, reason);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+void refresh_Loadavg(struct event_source *source, uint64_t expirations){
+  sample_Loadavg(source->arg);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+void run_Time_Over(struct event_source *source, uint64_t expirations){
+  struct server_config *config = source->arg;
+  char reason[48];
+  snprintf(reason, sizeof(reason), "Ran for %d seconds", config->runTime);
+  start_Drain(config, reason);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+void refresh_Stats(struct event_source *source, uint64_t expirations){
+  flush_Stats(source->arg);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The receive iovecs and message headers point into the packet buffers once, 
+ *	so the server loop only has to reset the address lengths and attach the replies.
+ **************************************************
+ */
+struct message_batch *create_Batch(struct packet_pool *packets, int batchSize, int datagramSize, int controlSize){
+  int i;
+  struct message_batch *batch = calloc(1, sizeof(struct message_batch));
+  if(batch == NULL) {
+	printErrorMessage("Cannot Allocate Message Batch");
+    return NULL;
+  }
+  batch->size = batchSize;
+  batch->packets = packets;
+  if((batch->packet = malloc(batchSize * sizeof(uint32_t))) != NULL)
+    for(i = 0; i < batchSize; i++)
+      batch->packet[i] = take_Packet(packets);
+  batch->reply = calloc(batchSize, sizeof(struct message_reply));
+  batch->cliaddr = calloc(batchSize, sizeof(struct sockaddr_in6));
+  batch->opcode = calloc(batchSize, sizeof(int));
+  batch->message = calloc(batchSize, sizeof(char *));
+  batch->messageLength = calloc(batchSize, sizeof(int));
+  batch->sendSlot = calloc(batchSize, sizeof(int));
+  batch->recvIov = calloc(batchSize, sizeof(struct iovec));
+  batch->recvHdr = calloc(batchSize, sizeof(struct mmsghdr));
+  batch->sendHdr = calloc(batchSize, sizeof(struct mmsghdr));
+  batch->trace = calloc(batchSize, sizeof(struct request_trace));
+  batch->controlSize = controlSize;
+  if(batch->packet == NULL || batch->packet[batchSize - 1] == PACKET_NONE || batch->reply == NULL || batch->cliaddr == NULL || batch->opcode == NULL
+     || batch->message == NULL || batch->messageLength == NULL || batch->sendSlot == NULL
+     || batch->recvIov == NULL || batch->recvHdr == NULL || batch->sendHdr == NULL || batch->trace == NULL) {
+	printErrorMessage("Cannot Allocate Message Batch");
+    free_Batch(batch);
+    return NULL;
+  }
+  
+  for(i = 0; i < batchSize; i++) {
+    batch->recvIov[i].iov_base = batch_Buffer(batch, i);
+    batch->recvIov[i].iov_len = datagramSize;
+    batch->recvHdr[i].msg_hdr.msg_name = &batch->cliaddr[i];
+    batch->recvHdr[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+    batch->recvHdr[i].msg_hdr.msg_iov = &batch->recvIov[i];
+    batch->recvHdr[i].msg_hdr.msg_iovlen = 1;
+    if(controlSize > 0)
+      batch->recvHdr[i].msg_hdr.msg_control = packet_Headroom(packets, batch->packet[i]);
   }
-  close(sockfd);
+  return batch;
 }
 
 
+/*
+ **************************************************
+ **************************************************
+ */
+char *batch_Buffer(struct message_batch *batch, int slot){
+  return packet_Data(batch->packets, batch->packet[slot]);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void free_Batch(struct message_batch *batch){
+  int i;
+  for(i = 0; batch->packet != NULL && i < batch->size; i++)
+    if(batch->packet[i] != PACKET_NONE)
+      give_Packet(batch->packets, batch->packet[i]);
+  free(batch->packet);
+  free(batch->reply);
+  free(batch->cliaddr);
+  free(batch->opcode);
+  free(batch->message);
+  free(batch->messageLength);
+  free(batch->sendSlot);
+  free(batch->recvIov);
+  free(batch->recvHdr);
+  free(batch->sendHdr);
+  free(batch->trace);
+  free(batch);
+}
+
+
+
 
 
 /*
@@ -216,37 +944,356 @@ void run_Server(int sockfd){
  * 	Put if-else for handling sending messages to the client only when the shutdown command is not given. 
  *	Returns a 1 if the shutdown command is given.
  *	Line 249: Modified to print a message when the shutdown command is given and do not send a message to the client. 
+ *	MODIFIED ON 10/17/2026
+ *	Building the reply moved to processMessage, the request is logged through the log ring instead of printf
+ *	Sends the reply parts with sendmsg so the echoed text does not have to be copied into a send buffer
+ *	Sends only the length of the reply unless padded frames were asked for
+ *	Fragments are reassembled before the message is handled and large replies are fragmented
+ *	The shutdown command starts a drain in its handler, the server is no longer stopped from here
+ *	Takes the trace of the request and stamps the end of building the reply
+ **************************************************
+ */
+int handleMessage(struct server_worker *worker, struct sockaddr_in6 cliaddr, char *recvMesg, int length, struct request_trace *trace){
+  int opcode, sent, messageLength; 
+  char *message;
+  struct message_reply reply;
+  
+  //modify the incoming message, a fragment is only answered once its message is complete
+  opcode = prepareReply(worker, &cliaddr, recvMesg, length, &reply, &message, &messageLength);
+  if(opcode == -1)
+    return 0;
+  end_Handler(trace);
+
+  //send the client the modified message
+  sent = sendReply(worker, &cliaddr, &reply);
+  count_Request(worker, opcode, messageLength, sent, trace);
+  log_Request(worker, &cliaddr, opcode, messageLength, sent, trace);
+  free(message);
+  return opcode;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	A message longer than the configured maximum is answered with an error instead of being cut off.
+ *	Requests over the rate limit of their client are dropped once their command is known.
+ *	MODIFIED ON 10/17/2026
+ *	Checking and reassembling the datagram moved to read_Message, the handler threads only get complete messages
+ *	The rate limit is checked on the command the message names before its handler runs
+ *	MODIFIED ON 10/17/2026
+ *	The client address is kept in the worker for commands that depend on who sent them
  **************************************************
  */
-int handleMessage(int sockfd, struct sockaddr_in cliaddr, char *recvMesg){
-  int shutdown = 0; 
-  char sendMesg[MAX_MESSAGE];
-  socklen_t clilen = sizeof(cliaddr);
-  bzero(sendMesg, MAX_MESSAGE);
+int prepareReply(struct server_worker *worker, struct sockaddr_in6 *cliaddr, char *datagram, int length,
+                 struct message_reply *reply, char **message, int *messageLength){
+  int opcode, result = read_Message(worker, cliaddr, datagram, length, reply, message, messageLength);
+  char *request = *message != NULL ? *message : datagram;
+  
+  worker->client = cliaddr;
+  if(result == MESSAGE_PENDING)
+    return -1;
+  //a client over its budget for the command gets no reply at all and its command is not run
+  if(worker->clients != NULL && !allow_Request(worker, cliaddr, result == MESSAGE_READY ? request_Opcode(request, *messageLength) : OPCODE_ERROR)) {
+    count_Drop(worker);
+    free(*message);
+    *message = NULL;
+    return -1;
+  }
+  if(result == MESSAGE_READY)
+    opcode = processMessage(worker, request, *messageLength, reply);
+  else
+    opcode = OPCODE_ERROR;
+  if(worker->config->padReplies && reply->iov[0].iov_base != &reply->header) //binary replies are never padded
+    pad_Reply(reply);
+  return opcode;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+int read_Message(struct server_worker *worker, struct sockaddr_in6 *cliaddr, char *datagram, int length,
+                 struct message_reply *reply, char **message, int *messageLength){
+  struct binary_header header;
+  *message = NULL;
+  *messageLength = length;
+  
+  if(length > worker->config->datagramSize || (length > worker->config->maxMessage && !is_Fragment(datagram, length))) {
+    set_Reply_Text(reply, "<error>message too long</error>");
+    tag_Reply(reply, datagram, correlation_Length(datagram, worker->config->datagramSize < length ? worker->config->datagramSize : length));
+    if(is_Binary(datagram, length)) {
+      read_Binary_Header(datagram, length, &header); //the length field does not match a truncated message
+      binaryError(reply, header.id, "message too long");
+    }
+    return MESSAGE_REJECTED;
+  }
+  if(is_Fragment(datagram, length))
+    return reassemble_Fragment(worker->reassembly, cliaddr, datagram, length, message, messageLength) == 1 ? MESSAGE_READY : MESSAGE_PENDING;
+  datagram[length] = '\0'; //only the received bytes are terminated, the buffer is not cleared
+  return MESSAGE_READY;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The request is not parsed beyond its correlation envelope or binary header, shedding it has to stay cheap.
+ **************************************************
+ */
+void busy_Reply(struct message_reply *reply, char *request, int length){
+  struct binary_header header;
+  if(is_Binary(request, length)) {
+    read_Binary_Header(request, length, &header);
+    binaryError(reply, header.id, "busy");
+    return;
+  }
+  set_Reply_Text(reply, "<error>busy</error>");
+  tag_Reply(reply, request, correlation_Length(request, length));
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The parts of the reply are gathered by the kernel, a reply that does not fit in one
+ *	datagram of the path MTU is split into fragments that point into the same parts.
+ **************************************************
+ */
+int sendReply(struct server_worker *worker, struct sockaddr_in6 *cliaddr, struct message_reply *reply){
+  struct msghdr header = { .msg_name = cliaddr, .msg_namelen = sizeof(*cliaddr) };
+  if(reply->length > fragment_Payload(worker->config->mtu)) {
+    if(split_Fragments(worker->fragments, reply->iov, reply->iovlen, worker->config->mtu, worker->nextMessageId++) == -1)
+      return -1;
+    return send_Fragments(worker->sockfd, (struct sockaddr *) cliaddr, sizeof(*cliaddr), worker->fragments);
+  }
+  header.msg_iov = reply->iov;
+  header.msg_iovlen = reply->iovlen;
+  return sendmsg(worker->sockfd, &header, 0);
+}
+
+
+/*
+ **************************************************
+ *	MODIFIED ON 10/17/2026
+ *	Split out of handleMessage so the batched loop can build replies without sending them
+ *	The per request printing was replaced by log_Request records written by the log thread
+ *	Works on the message length and builds a reply of parts instead of clearing and filling a send buffer
+ *	Strips the optional correlation envelope before dispatching and puts it back in front of the reply
+ *	Binary messages are handed to binaryMessage before anything treats them as text
+ **************************************************
+ */
+int processMessage(struct server_worker *worker, char *recvMesg, int length, struct message_reply *reply){
+  int opcode, tagLength;
+  reset_Reply(reply);
+  
+  //a binary message has its length in the header and may hold null characters
+  if(is_Binary(recvMesg, length))
+    return binaryMessage(worker, recvMesg, length, reply);
+  
+  //clients that pad their request to a full frame end the message with a null character
+  length = strnlen(recvMesg, length);
   
   //remove newline character at ending if present
-  if(recvMesg[ ( strlen(recvMesg) - NEW_LINE ) ]  == '\n') 
-	recvMesg[ ( strlen(recvMesg) - NEW_LINE ) ] = '\0';
+  if(length > 0 && recvMesg[length - NEW_LINE] == '\n') 
+	recvMesg[--length] = '\0';
   
-  //print client message
-  printf("***************************************************\n");
-  printf("Received the following message from : %s\n%s\n", inet_ntoa(((struct sockaddr_in *) &(cliaddr))->sin_addr), recvMesg);
+  //a correlation ID in front of the command goes back in front of the reply
+  tagLength = correlation_Length(recvMesg, length);
   
   //modify the incoming message 
-  shutdown = modifyMessage(recvMesg, sendMesg);
+  opcode = modifyMessage(worker, recvMesg + tagLength, length - tagLength, reply);
+  tag_Reply(reply, recvMesg, tagLength);
+  return opcode;
+}
 
-  //send the client the modified message
-  sendto(sockfd, sendMesg, MAX_MESSAGE, 0, (struct sockaddr *) &cliaddr, clilen);
-  printf("Sent the following message to : %s\n%s", inet_ntoa(((struct sockaddr_in *) &(cliaddr))->sin_addr), sendMesg);
-  printf("\n***************************************************\n\n");
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The header is put in front of the parts the handler built, like a correlation envelope.
+ *	A handler can set BINARY_FLAG bits in the flags of the reply header before it is written.
+ **************************************************
+ */
+int binaryMessage(struct server_worker *worker, char *recvMesg, int length, struct message_reply *reply){
+  struct binary_header request;
+  int opcode, text;
   
-  //do shutdown
-  if(shutdown == -1) {
-    printf("\n***************************************************\n");
-    printf("The Server Is Being Powered OFF !!");
-    printf("\n***************************************************\n\n");
+  if(read_Binary_Header(recvMesg, length, &request) == -1) {
+    binaryError(reply, request.id, "length does not match");
+    return OPCODE_ERROR;
+  }
+  reply->header.flags = 0;
+  opcode = dispatch_Binary(worker, request.opcode, recvMesg + BINARY_HEADER_SIZE, request.length, reply, &text);
+  if(opcode == -1) {
+    binaryError(reply, request.id, "unknown opcode");
+    return OPCODE_ERROR;
+  }
+  if(text)
+    reply->header.flags |= BINARY_FLAG_TEXT;
+  write_Binary_Header(&reply->header, opcode, reply->header.flags | BINARY_FLAG_REPLY, request.id, reply->length);
+  tag_Reply(reply, (char *) &reply->header, BINARY_HEADER_SIZE);
+  return opcode;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+void binaryError(struct message_reply *reply, uint64_t id, const char *text){
+  int length = strlen(text);
+  reset_Reply(reply);
+  write_Binary_Header(&reply->header, BINARY_ERROR, BINARY_FLAG_REPLY | BINARY_FLAG_ERROR, id, length);
+  add_Reply_Part(reply, &reply->header, BINARY_HEADER_SIZE);
+  add_Reply_Part(reply, text, length);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void reset_Reply(struct message_reply *reply){
+  reply->iovlen = 0;
+  reply->length = 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void add_Reply_Part(struct message_reply *reply, const void *base, int length){
+  if(reply->iovlen == REPLY_IOV || length <= 0)
+    return;
+  reply->iov[reply->iovlen].iov_base = (void *) base;
+  reply->iov[reply->iovlen].iov_len = length;
+  reply->iovlen++;
+  reply->length += length;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void set_Reply_Text(struct message_reply *reply, const char *text){
+  reset_Reply(reply);
+  add_Reply_Part(reply, text, strlen(text));
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	A piece that does not fit is not kept cut short, the caller sees -1 and sends an error instead.
+ **************************************************
+ */
+int append_Text(char *text, int length, int size, const char *format, ...){
+  va_list arguments;
+  int written;
+  if(length < 0 || length >= size)
+    return -1;
+  va_start(arguments, format);
+  written = vsnprintf(text + length, size - length, format, arguments);
+  va_end(arguments);
+  if(written < 0 || written >= size - length)
     return -1;
+  return length + written;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+int correlation_Length(const char *message, int length){
+  int i;
+  if(length < 3 || message[0] != CORRELATION_MARK)
+    return 0;
+  for(i = 1; i < length && i <= MAX_CORRELATION_ID && isalnum((unsigned char) message[i]); i++);
+  if(i == 1 || i == length || message[i] != ' ')
+    return 0;
+  return i + 1;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The envelope becomes the first part, the parts already in the reply move back by one
+ **************************************************
+ */
+void tag_Reply(struct message_reply *reply, const char *tag, int length){
+  if(length <= 0 || reply->iovlen == REPLY_IOV)
+    return;
+  memmove(&reply->iov[1], &reply->iov[0], reply->iovlen * sizeof(struct iovec));
+  reply->iov[0].iov_base = (void *) tag;
+  reply->iov[0].iov_len = length;
+  reply->iovlen++;
+  reply->length += length;
+}
+
+
+/*
+ **************************************************
+ *	The padding is one shared block of zeros so nothing is cleared per request.
+ **************************************************
+ */
+void pad_Reply(struct message_reply *reply){
+  static const char padding[MAX_MESSAGE];
+  if(reply->length < MAX_MESSAGE)
+    add_Reply_Part(reply, padding, MAX_MESSAGE - reply->length);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+void gather_Reply(struct message_reply *reply, char *buffer){
+  int i;
+  for(i = 0; i < reply->iovlen; i++) {
+    memcpy(buffer, reply->iov[i].iov_base, reply->iov[i].iov_len);
+    buffer += reply->iov[i].iov_len;
   }
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void printShutdownMessage(void){
+  printf("\n***************************************************\n");
+  printf("The Server Is Being Powered OFF !!");
+  printf("\n***************************************************\n\n");
+  fflush(stdout);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Adds the server commands to the dispatch table, a new command only needs a handler and a line here
+ **************************************************
+ */
+int register_Commands(void){
+  if(register_Command("echo", COMMAND_CONTAINER, OPCODE_ECHO, echoMessage) == -1
+     || register_Command("loadavg", COMMAND_EMPTY, OPCODE_LOADAVG, loadavgMessage) == -1
+     || register_Command("shutdown", COMMAND_EITHER, OPCODE_SHUTDOWN, shutdownMessage) == -1
+     || register_Command("limits", COMMAND_EMPTY, OPCODE_LIMITS, limitsMessage) == -1
+     || register_Command("stats", COMMAND_EMPTY, OPCODE_STATS, statsMessage) == -1
+     || register_Command("trace", COMMAND_EMPTY, OPCODE_TRACE, traceMessage) == -1
+     || register_Binary("echo", echoBinary) == -1
+     || register_Binary("loadavg", loadavgBinary) == -1)
+    return -1;
   return 0;
 }
 
@@ -257,25 +1304,19 @@ int handleMessage(int sockfd, struct sockaddr_in cliaddr, char *recvMesg){
  *	Line 266: Change to use case sensitiive string compares
  *	Line 272: Include code for handling the shutdown command
  *	returns a -1 when the shutdown command is given. 
+ *	MODIFIED ON 10/17/2026
+ *	Returns the opcode of the command so it can be logged, OPCODE_SHUTDOWN replaces the -1
+ *	The chain of string compares is replaced by one lookup in the dispatch table
  **************************************************
  */
-int modifyMessage(char *recvMesg, char *send){
-  char *sendMesg = send;
-  //handle <echo> messages
-  if(!strncasecmp(recvMesg, "<echo>", ECHO_XML_START))
-	echoMessage(recvMesg, sendMesg); 
-  //handle <loadavg/> messages
-  else if(!strcasecmp(recvMesg, "<loadavg/>"))
-   	loadavgMessage(recvMesg, sendMesg); 
-  //handle <shutdown/> messages
-  else if(!strcasecmp(recvMesg, "<shutdown/>")){
-    strcpy(sendMesg, "<replyShutDown>Server is shutting down</replyShutDown>");
-    return -1;
-  }
+int modifyMessage(struct server_worker *worker, char *recvMesg, int length, struct message_reply *reply){
+  int opcode = dispatch_Message(worker, recvMesg, length, reply);
   //handle error messages
-  else
-	errorMessage(recvMesg, sendMesg); 
-  return 0;
+  if(opcode == -1) {
+    errorMessage(recvMesg, reply); 
+    return OPCODE_ERROR;
+  }
+  return opcode;
 }
 
 
@@ -283,24 +1324,93 @@ int modifyMessage(char *recvMesg, char *send){
  **************************************************
  *	MODIFIED ON 2/6/2014
  *	Line 289: Changed MEMSET of reverseMesg and modifiedReceiveMessage to bzero
+ *	MODIFIED ON 10/17/2026
+ *	Replies with the echoed text as a slice of the message between two static tags so it is never copied,
+ *	the tags were already checked by the dispatcher
  **************************************************
  */
-void echoMessage(char *recvMesg, char *send){
-  char *sendMesg = send, reverseMesg[MAX_MESSAGE], modifiedReceiveMessage[MAX_MESSAGE];
-  bzero(reverseMesg, MAX_MESSAGE);
-  bzero(modifiedReceiveMessage, MAX_MESSAGE);
+void echoMessage(struct command_request *request, struct message_reply *reply){
+  static const char replyStart[] = "<reply>", replyEnd[] = "</reply>";
+  reset_Reply(reply);
+  add_Reply_Part(reply, replyStart, sizeof(replyStart) - 1);
+  add_Reply_Part(reply, request->body, request->bodyLength);
+  add_Reply_Part(reply, replyEnd, sizeof(replyEnd) - 1);
+}
 
-  strcpy(reverseMesg, recvMesg);
-  reverseString(reverseMesg); //reverse the string for the final 
-  if((!strncasecmp(recvMesg, "<echo>", ECHO_XML_START)) && (!strncasecmp(reverseMesg, ">ohce/<", ECHO_XML_END))) //compare beginning and ending ECHO
-  {
-	strcpy(sendMesg, "<reply>");
-	strncpy(modifiedReceiveMessage, recvMesg + ECHO_XML_START, strlen(recvMesg) - (ECHO_XML_START + ECHO_XML_END));
-	strcat(sendMesg, modifiedReceiveMessage);
-	strcat(sendMesg, "</reply>");
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The shutdown reply was built in modifyMessage, it is now the handler of the shutdown command
+ *	Checks the token and starts the drain, the reply is still sent since the loop drains what it has
+ **************************************************
+ */
+void shutdownMessage(struct command_request *request, struct message_reply *reply){
+  if(!shutdown_Authorized(request->worker->config, request->worker->client, request->body, request->bodyLength)) {
+    set_Reply_Text(reply, "<error>not authorized</error>");
+    return;
+  }
+  set_Reply_Text(reply, "<replyShutDown>Server is shutting down</replyShutDown>");
+  start_Drain(request->worker->config, "Shutdown command received");
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Every byte is compared whatever the first difference, so the time taken does not give the token away.
+ *	MODIFIED ON 10/17/2026
+ *	Without a token only the host itself can shut the server down. The whole token is compared
+ *	whatever the length of the body, so the time taken does not give its length away either.
+ **************************************************
+ */
+int shutdown_Authorized(struct server_config *config, struct sockaddr_in6 *client, const char *token, int length){
+  int expected = strlen(config->token), i;
+  unsigned char difference = length != expected;
+  if(expected == 0)
+    return client != NULL && (IN6_IS_ADDR_LOOPBACK(&client->sin6_addr)
+                              || (IN6_IS_ADDR_V4MAPPED(&client->sin6_addr) && client->sin6_addr.s6_addr[12] == 127));
+  for(i = 0; i < expected; i++)
+    difference |= (unsigned char) (i < length ? token[i] : 0) ^ (unsigned char) config->token[i];
+  return difference == 0;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+void limitsMessage(struct command_request *request, struct message_reply *reply){
+  struct rate_limits *limits = request->worker->config->limits;
+  if(limits == NULL) {
+    set_Reply_Text(reply, "<replyLimits/>");
+    return;
   }
-  else	
-	errorMessage(recvMesg, sendMesg); 
+  reset_Reply(reply);
+  add_Reply_Part(reply, reply->text, render_Limits(limits, reply->text));
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+void statsMessage(struct command_request *request, struct message_reply *reply){
+  reset_Reply(reply);
+  add_Reply_Part(reply, reply->text, render_Stats(request->worker->config->stats, reply->text));
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ **************************************************
+ */
+void traceMessage(struct command_request *request, struct message_reply *reply){
+  reset_Reply(reply);
+  add_Reply_Part(reply, reply->text, render_Trace(request->worker->config->stats, reply->text));
 }
 
 
@@ -308,52 +1418,50 @@ void echoMessage(char *recvMesg, char *send){
  **************************************************
  *	MODIFIED ON 2/6/2014
  *	Line 315: Changed to error check getloadavg
+ *	MODIFIED ON 10/17/2026
+ *	The load average is read and formatted by the sampler timer, a request only picks up its latest reply
  **************************************************
  */
-void loadavgMessage(char *recvMesg, char *send){
-  char *sendMesg = send, time[MAX_MESSAGE];
-  double loadAvg[LOAD_AVG_FUNCTION] = {0.0, 0.0, 0.0}; 
-  if( getloadavg(loadAvg, LOAD_AVG_FUNCTION) < 0 ) {
-  		strcpy(sendMesg, "<error>unable to obtain load average</error>");
-		return;
-  }
-  strcpy(sendMesg, "<replyLoadAvg>");
-  sprintf(time, "%f", loadAvg[LOAD_AVG_1_MIN_INDEX]);
-  strcat(sendMesg, time);
-  strcat(sendMesg, ":");
-  sprintf(time, "%f", loadAvg[LOAD_AVG_5_MIN_INDEX]);
-  strcat(sendMesg, time);
-  strcat(sendMesg, ":");
-  sprintf(time, "%f", loadAvg[LOAD_AVG_15_MIN_INDEX]);
-  strcat(sendMesg, time);
-  strcat(sendMesg, "</replyLoadAvg>");
+void loadavgMessage(struct command_request *request, struct message_reply *reply){
+  struct loadavg_slot *slot = current_Loadavg(request->worker->config->loadavg);
+  reset_Reply(reply);
+  add_Reply_Part(reply, slot->text, slot->length);
 }
 
 
 /*
  **************************************************
+ *	ADDED ON 10/17/2026
  **************************************************
  */
-void errorMessage(char *recvMesg, char *send){
-  char *sendMesg = send;
-  strcpy(sendMesg, "<error>unknown format</error>");
+void echoBinary(struct command_request *request, struct message_reply *reply){
+  reset_Reply(reply);
+  add_Reply_Part(reply, request->body, request->bodyLength);
 }
 
 
 /*
  **************************************************
+ *	ADDED ON 10/17/2026
+ *	A failed sample has no binary payload, the text error is sent instead and flagged as text.
  **************************************************
  */
-void reverseString(char *original){
-  char temp;
-  int i = 0, j = strlen(original) - NEW_LINE;
-  for(i = 0; i < j; i++, j--)
-  {	
-	temp = original[i];
-	original[i] = original[j];
-	original[j] = temp;
+void loadavgBinary(struct command_request *request, struct message_reply *reply){
+  struct loadavg_slot *slot = current_Loadavg(request->worker->config->loadavg);
+  reset_Reply(reply);
+  if(slot->binaryLength == 0) {
+    reply->header.flags = BINARY_FLAG_TEXT;
+    add_Reply_Part(reply, slot->text, slot->length);
   }
+  else
+    add_Reply_Part(reply, slot->binary, slot->binaryLength);
 }
 
 
-
+/*
+ **************************************************
+ **************************************************
+ */
+void errorMessage(char *recvMesg, struct message_reply *reply){
+  set_Reply_Text(reply, "<error>unknown format</error>");
+}
@@ -5,6 +5,13 @@
  * 	@author Daniel Davis
  * 	@bug No known bugs!
  */
+
+#ifndef UDPSERVER_H
+#define UDPSERVER_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE	//needed for recvmmsg and sendmmsg
+#endif
  
 #include <stdio.h>
 #include <unistd.h>
@@ -17,6 +24,16 @@
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <stdlib.h>
+#include <ctype.h>
+#include <sys/uio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <ifaddrs.h>
+#include <limits.h>
+#include <signal.h>
+#include "UDPfragment.h"
+#include "UDPbinary.h"
+#include "UDPpool.h"
 
 /*
  **************************************************
@@ -24,17 +41,224 @@
  **************************************************
  */
  
-#define INTERFACE "eth0"
 #define MAX_MESSAGE 256
-#define IP_4 32
-#define ECHO_XML_START 6
-#define ECHO_XML_END 7
-#define LOADAVG_XML 10
+#define MAX_REPLY_TEXT 1024	//formatted replies, the longest is <stats/> with every counter at its widest
+#define MAX_HOST_ADDRESSES 32		//interface addresses printed at startup
+#define MAX_ADDRESS_TEXT (INET6_ADDRSTRLEN + 8)	//"[address]:port" and a null character
 #define NEW_LINE 1
 #define LOAD_AVG_FUNCTION 3
 #define LOAD_AVG_1_MIN_INDEX 0
 #define LOAD_AVG_5_MIN_INDEX 1
 #define LOAD_AVG_15_MIN_INDEX 2
+#define DEFAULT_BATCH_SIZE 1
+#define MAX_BATCH_SIZE 1024
+#define DEFAULT_WORKERS 1
+#define MAX_WORKERS 256
+#define MAX_LISTENERS 16
+#define BACKEND_EPOLL 0	//server loop chosen with -u, io_uring falls back to epoll on kernels without it
+#define BACKEND_URING 1
+#define BACKEND_URING_FIXED 2	//io_uring that can send from registered buffers
+#define REPLY_IOV 6		//room for a correlation ID, an echo and padding
+#define CORRELATION_MARK '#'
+#define MAX_CORRELATION_ID 16
+#define DEFAULT_DRAIN_MIL_SEC 2000	//time the server loops get to answer what is queued once a shutdown starts
+#define MAX_DRAIN_MIL_SEC 60000
+#define MAX_SHUTDOWN_TOKEN 128
+#define TRACE_UNKNOWN UINT64_MAX	//the time a datagram spent in the socket queue when the kernel did not stamp it
+#define MESSAGE_PENDING 0	//read_Message got a fragment of a message that is not complete yet
+#define MESSAGE_READY 1		//the message is complete and can be handled
+#define MESSAGE_REJECTED 2	//the message was answered with an error without handling it
+
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+/**	@brief 	The command a client message was recognised as, returned by modifyMessage.
+*/
+enum message_opcode {
+  OPCODE_ERROR,
+  OPCODE_ECHO,
+  OPCODE_LOADAVG,
+  OPCODE_SHUTDOWN,
+  OPCODE_LIMITS,
+  OPCODE_STATS,
+  OPCODE_TRACE
+};
+
+struct server_log;
+struct log_ring;
+struct loadavg_sampler;
+struct rate_limits;
+struct client_table;
+struct server_stats;
+struct worker_stats;
+struct event_source;
+struct event_loop;
+struct message_batch;
+struct handler_pool;
+struct dispatch_loop;
+
+/**	@brief 	The stamps of one request on its way through a server loop, all log_Clock times.
+*			received is when the round that read the datagram started, the request latency is measured from it.
+*			dispatched and handled are when building the reply started and ended, both 0 when tracing is off.
+*			queued is the nano seconds from the kernel receive timestamp to dispatched, TRACE_UNKNOWN without one.
+*/
+struct request_trace {
+  uint64_t received;
+  uint64_t dispatched;
+  uint64_t handled;
+  uint64_t queued;
+};
+
+/**	@brief 	One address of a network interface of the host, found once at startup.
+*/
+struct host_address {
+  char interface[IF_NAMESIZE];
+  int family;
+  char text[INET6_ADDRSTRLEN];
+};
+
+/**	@brief 	Settings chosen on the command line that are shared by every server loop.
+*			shutdown is set by stop_Server, which also writes wakefd so every event loop sees it.
+*			draining is set by start_Drain, the loops then answer what is queued on their sockets and leave,
+*			drainDeadline is the log_Clock time they are stopped at if they are still busy, 0 before a drain.
+*			drainTime is that time in milli seconds from the start of the drain.
+*			token is the secret a <shutdown> has to carry, empty when only the host itself can shut the server down.
+*			listeners are the addresses every server loop receives on, the first is the main port.
+*			They are IPv6 addresses of dual stack sockets, an IPv4 address is given v4 mapped.
+*			hostname and addresses describe the host, read once by discover_Host.
+*			runTime is the number of seconds after which the server stops, 0 runs until it is shut down.
+*			signals are the signals blocked in every thread and handled by the first event loop.
+*			backend is BACKEND_EPOLL or the io_uring backend uring_Supported found.
+*			padReplies is set for old clients that expect every reply NUL padded to MAX_MESSAGE bytes.
+*			maxMessage is the largest message accepted, larger ones arrive as fragments of at most mtu bytes.
+*			datagramSize is the receive buffer size, big enough for either form.
+*			log is NULL when request logging is turned off.
+*			loadavg holds the pre rendered <loadavg/> reply.
+*			limits is NULL when no command is rate limited.
+*			stats holds the request counters of every server loop.
+*			timestamps is how requests are traced, TIMESTAMPS_OFF unless -T was given.
+*			receiveBuffer and sendBuffer are the socket buffer sizes, 0 keeps the size the kernel picks.
+*			maxReceiveBuffer is how far a receive buffer grows when its socket drops datagrams, 0 never grows it.
+*			handlers is NULL when the server loops answer their requests themselves, otherwise the handlerCount
+*			threads they hand requests to through queues of queueDepth requests.
+*			packets adds up the packet buffers every server loop mapped and used.
+*/
+struct server_config {
+  int port;
+  int maxMessage;
+  int mtu;
+  int datagramSize;
+  int batchSize;
+  int workers;
+  int pinWorkers;
+  int padReplies;
+  int backend;
+  atomic_int shutdown;
+  atomic_int draining;
+  _Atomic uint64_t drainDeadline;
+  uint64_t drainStarted;
+  int drainTime;
+  char token[MAX_SHUTDOWN_TOKEN];
+  int wakefd;
+  int runTime;
+  sigset_t signals;
+  struct sockaddr_in6 listeners[MAX_LISTENERS];
+  int listenerCount;
+  char hostname[HOST_NAME_MAX + 1];
+  struct host_address addresses[MAX_HOST_ADDRESSES];
+  int addressCount;
+  struct server_log *log;
+  struct loadavg_sampler *loadavg;
+  struct rate_limits *limits;
+  struct server_stats *stats;
+  int timestamps;
+  int receiveBuffer;
+  int sendBuffer;
+  int maxReceiveBuffer;
+  int handlerCount;
+  int queueDepth;
+  struct handler_pool *handlers;
+  struct packet_usage packets;
+};
+
+/**	@brief 	One server loop and everything it owns. The single threaded server runs one of these
+*			on the main thread, the worker pool runs one per thread with its own SO_REUSEPORT sockets.
+*			sockets holds one socket per listener and sockfd is the one the current request came in on,
+*			client is the address the current request came from.
+*			packets holds every buffer the loop receives into and sends from. recvPacket or batch is the
+*			receive buffer, depending on the batch size, dispatch holds the request slots instead when
+*			the requests are handed to handler threads.
+*			clients holds the token buckets of the clients this loop has seen, NULL without rate limits.
+*			stats is the request counters of this loop.
+*			cpu is the processor the thread is pinned to or -1 when it is not pinned.
+*			log is the ring this loop writes its request records to, NULL when logging is off.
+*			reassembly holds the fragmented messages this loop is receiving and fragments is 
+*			where it splits replies that are too large for one datagram.
+*			overflows is the drop count each socket last reported and receiveBuffer its receive buffer size.
+*/
+struct server_worker {
+  int id;
+  int sockfd;
+  struct sockaddr_in6 *client;
+  int sockets[MAX_LISTENERS];
+  int socketCount;
+  int cpu;
+  pthread_t thread;
+  struct server_config *config;
+  struct log_ring *log;
+  struct reassembly_table *reassembly;
+  struct fragment_set *fragments;
+  uint32_t nextMessageId;
+  struct packet_pool packets;
+  uint32_t recvPacket;
+  struct message_batch *batch;
+  struct dispatch_loop *dispatch;
+  struct client_table *clients;
+  struct worker_stats *stats;
+  uint32_t overflows[MAX_LISTENERS];
+  int receiveBuffer[MAX_LISTENERS];
+};
+
+/**	@brief 	A reply to a client described as a list of parts that sendmsg gathers into one datagram.
+*			A part can point at a static string, at a slice of the received message or at text,
+*			the buffer of MAX_REPLY_TEXT bytes replies that have to be formatted are written to. length is the sum of all parts.
+*			header is put in front of the reply to a binary request, a binary handler may set its flags.
+*/
+struct message_reply {
+  struct iovec iov[REPLY_IOV];
+  int iovlen;
+  int length;
+  char text[MAX_REPLY_TEXT];
+  struct binary_header header;
+};
+
+/**	@brief 	Holds the ring of receive buffers and replies used by the batched server loop.
+*			Every slot i is a datagram: the packet buffer packet[i] at batch_Buffer(batch, i) is filled by recvmmsg 
+*			and reply[i] is flushed by sendmmsg back to cliaddr[i]. message[i] is the reassembled message 
+*			when slot i completed a fragmented one. sendSlot maps the sendmmsg headers back to their slots.
+*			The headroom of packet[i] holds controlSize bytes for the control messages of slot i
+*			and trace[i] is the stamps of slot i.
+*			The buffers are taken from the pool of the server loop once and reused.
+*/
+struct message_batch {
+  int size;
+  struct packet_pool *packets;
+  uint32_t *packet;
+  struct message_reply *reply;
+  struct sockaddr_in6 *cliaddr;
+  int *opcode;
+  char **message;
+  int *messageLength;
+  int *sendSlot;
+  struct iovec *recvIov;
+  struct mmsghdr *recvHdr;
+  struct mmsghdr *sendHdr;
+  int controlSize;
+  struct request_trace *trace;
+};
 
 /*
  **************************************************
@@ -42,43 +266,277 @@
  **************************************************
  */
  
+/**	@brief 	Is a function that takes in a error message and outputs the message to the display.
+*			The caller hands the error back up, only main decides to stop the server.
+*	@param 	Is the error message that should be outputted to the screen.
+*	@return returns a -1 integer. 
+*/
+int printErrorMessage( char *message );
+
 /**	@brief	Function create a UDP socket by calling the "socket" function.
 *	@param 	no parameter is passed. 
+*			The socket is IPv6 with IPV6_V6ONLY turned off, so it also receives IPv4 datagrams.
 *	@return a integer representing the socket number.
 */
 int create_UDP_Socket(void);
 
-/**	@brief 	Get the host that the server is running on and returns it in the stuct hostent.
-*	@param 	no parameter is passed. 
-*	@return returns a pointer to a hostent structure containing information about the server's host.
+/**	@brief 	Reads the host name and the address of every network interface once at startup.
+*			Neither is needed to serve, a host without a name or interfaces is only reported.
+*	@param 	config is the server configuration the host is written to.
+*	@return returns nothing.
 */
-struct hostent *info_Host();
+void discover_Host(struct server_config *config);
 
 /**	@brief 	Set the program host address and port number to be able to connect the server.
-*	@param 	hostptr is a pointer to the hostent structure that contains the server host information.
 *   @param  SERVER_PORT is the port number
-*	@return return a sockaddr_in structure that can be used to link the server program to the host computer. 
+*	@return return a sockaddr_in6 structure of every address of the host, IPv4 and IPv6, and the port. 
 */
-struct sockaddr_in destination_Address( struct hostent *hostptr, int SERVER_PORT);
+struct sockaddr_in6 destination_Address(int SERVER_PORT);
+
+/**	@brief 	Writes an address as text, an IPv4 address in dotted form and an IPv6 address in brackets.
+*	@param 	addr is the address, IPv4 addresses are v4 mapped.
+*			port is the port number.
+*			text is where the text is written.
+*			size is the size of text, MAX_ADDRESS_TEXT is enough for any address.
+*	@return returns the length of the text.
+*/
+int format_Address(const struct in6_addr *addr, int port, char *text, int size);
 
 /**	@brief 	binds the socket with the host that will run the server program. 
 *	@param 	listensockfd is the socket that the server will listen on. 
-*			servaddr is a sockaddr_in structure that contains information about the host running the server. 
-*	@return returns a sockaddr_in structure that can be used to link the server program to the host computer. 
+*			servaddr is a sockaddr_in6 structure that contains information about the host running the server. 
+*	@return returns 0 on success, -1 if the address cannot be bound. 
 */
-struct sockaddr_in bind_Socket(int listensockfd, struct sockaddr_in servaddr);
+int bind_Socket(int listensockfd, struct sockaddr_in6 servaddr);
 
-/**	@brief 	Prints the host name, IP address, and port number that the server is running on. 
-*	@param 	listensockfd is the socket that the server will listen on. 
-*			hostptr contains information about the host the server is running on.
-*			servaddr is a sockaddr_in structure that contains information about the host running the server. 
+/**	@brief 	Prints the host name, the IP addresses the main port is bound to, and the port number. 
+*	@param 	config is the server configuration with the host found by discover_Host and the main port.
 *	@return returns nothing. 
 */
-void print_Server_info(int listensockfd, struct hostent *hostptr, struct sockaddr_in servaddr);
+void print_Server_info(struct server_config *config);
+
+/**	@brief 	Registers the server commands in the dispatch table, called once before any server loop starts.
+*	@param 	no parameter is passed. 
+*	@return returns 0 on success, -1 if a command cannot be registered. 
+*/
+int register_Commands(void);
+
+/**	@brief 	Sets up a server loop and the state it owns apart from its socket.
+*	@param 	worker is the server loop to set up.
+*			id is the number of the server loop.
+*			config is the shared configuration.
+*	@return returns 0 on success, -1 if the state cannot be allocated, free_Worker frees what was set up. 
+*/
+int init_Worker(struct server_worker *worker, int id, struct server_config *config);
+
+/**	@brief 	Frees the state set up by init_Worker and closes the sockets of the server loop,
+*			which is left until the server loop has drained and the final statistics are written.
+*	@param 	worker is the server loop to clean up.
+*	@return returns nothing. 
+*/
+void free_Worker(struct server_worker *worker);
 
 /**	@brief 	Function to accept connections and wait if the server is full of request. 
-*	@param 	sockfd is the socket that the server will listen on. 
-*   @return returns nothing.
+*			Waits in an event loop on every socket of the worker until the server drains or is stopped.
+*	@param 	worker holds the sockets that the server will listen on, the shared configuration
+*			and the log ring of this loop.
+*   @return returns 0 when the server loop was shut down, -1 when it failed and stopped the server.
+*/
+int run_Server(struct server_worker *worker);
+
+/**	@brief 	Adds what the first server loop handles for the whole server to its event loop:
+*			the signals, the load average timer and the run time timer. Other loops add nothing.
+*	@param 	worker is the server loop.
+*			loop is its event loop.
+*	@return returns 0 on success, -1 if a timer or the signals cannot be added.
+*/
+int add_Server_Events(struct server_worker *worker, struct event_loop *loop);
+
+/**	@brief 	Turns a received datagram into a reply. Fragments are added to the reassembly table of the
+*			worker and the reply is built once the message is complete.
+*	@param 	worker is the server loop that received the datagram.
+*			cliaddr is the client that sent the datagram.
+*			datagram is the received datagram, it must have room for a terminating null character.
+*			length is the size of the datagram, more than the configured datagram size if it was truncated.
+*			reply is the reply that is built.
+*			message is set to the reassembled message the reply may point into, or NULL. 
+*			The caller frees it after the reply was sent.
+*			messageLength is set to the size of the complete message.
+*	@return returns the message_opcode of the reply or -1 if there is nothing to reply yet.
+*/
+int prepareReply(struct server_worker *worker, struct sockaddr_in6 *cliaddr, char *datagram, int length,
+                 struct message_reply *reply, char **message, int *messageLength);
+
+/**	@brief 	Checks the size of a received datagram and adds it to the reassembly table of the worker
+*			when it is a fragment, the first half of prepareReply.
+*	@param 	worker is the server loop that received the datagram.
+*			cliaddr is the client that sent the datagram.
+*			datagram is the received datagram, it must have room for a terminating null character.
+*			length is the size of the datagram, more than the configured datagram size if it was truncated.
+*			reply is set to the error reply when the message is too long.
+*			message is set to the reassembled message or NULL, the caller frees it.
+*			messageLength is set to the size of the complete message.
+*	@return returns MESSAGE_READY when the message is in message or datagram, MESSAGE_PENDING
+*			when more fragments are needed and MESSAGE_REJECTED when reply holds the error.
+*/
+int read_Message(struct server_worker *worker, struct sockaddr_in6 *cliaddr, char *datagram, int length,
+                 struct message_reply *reply, char **message, int *messageLength);
+
+/**	@brief 	Builds the reply for a client message without sending it. 
+*			This is shared by handleMessage, the batched server loop and the handler threads. 
+*	@param 	worker is the server loop that received the message.
+*			recvMesg is a char array containing the client message that was sent to the server,
+*			it must be null terminated at the received length. 
+*			length is the number of bytes received.
+*			reply is the reply that is built, it may point into recvMesg.
+*	@return returns the message_opcode the message was recognised as.
+*/
+int processMessage(struct server_worker *worker, char *recvMesg, int length, struct message_reply *reply);
+
+/**	@brief 	Makes the reply to a request that is shed because the handlers are busy, <error>busy</error>
+*			with the correlation envelope of the request, or a binary error for a binary request.
+*	@param 	reply is the reply to set.
+*			request is the complete message.
+*			length is the length of the message.
+*	@return returns nothing.
+*/
+void busy_Reply(struct message_reply *reply, char *request, int length);
+
+/**	@brief 	Sends a reply to a client, as fragments if it does not fit in one datagram. 
+*	@param 	worker is the server loop that sends the reply.
+*			cliaddr is the client to send to.
+*			reply is the reply to send.
+*	@return returns the number of bytes sent or -1 on error.
+*/
+int sendReply(struct server_worker *worker, struct sockaddr_in6 *cliaddr, struct message_reply *reply);
+
+/**	@brief 	Prints that the server is being powered off. 
+*	@param 	no parameter is passed. 
+*	@return returns nothing. 
+*/
+void printShutdownMessage(void);
+
+/**	@brief 	Stops every server loop right away, safe to call from any thread.
+*	@param 	config is the shared configuration.
+*	@return returns nothing.
+*/
+void stop_Server(struct server_config *config);
+
+/**	@brief 	Starts a graceful shutdown, safe to call from any thread. Every server loop answers
+*			the datagrams queued on its sockets and the replies it has in flight and then leaves,
+*			those still busy after drainTime milli seconds are stopped. Only the first call counts.
+*	@param 	config is the shared configuration.
+*			reason is printed with the start of the drain.
+*	@return returns nothing.
+*/
+void start_Drain(struct server_config *config, const char *reason);
+
+/**	@brief 	Checks if a server loop has to stop taking datagrams, stops every loop once the drain
+*			deadline has passed.
+*	@param 	config is the shared configuration.
+*	@return returns 1 if the server loop has to leave now, 0 otherwise.
+*/
+int server_Stopped(struct server_config *config);
+
+/**	@brief 	Called once every server loop has left and before their sockets are closed,
+*			prints how the drain went, flushes the metrics file and writes out the remaining log records.
+*	@param 	config is the shared configuration.
+*	@return returns nothing.
+*/
+void finish_Server(struct server_config *config);
+
+/**	@brief 	Reads the shutdown token from the first line of a file.
+*	@param 	config is the shared configuration the token is kept in.
+*			path is the file, it should only be readable by the user running the server.
+*	@return returns 0 on success, -1 if the file cannot be read or holds no token.
+*/
+int read_Shutdown_Token(struct server_config *config, const char *path);
+
+/**	@brief 	Prints every address the server listens on after the first one.
+*	@param 	config is the shared configuration.
+*	@return returns nothing.
+*/
+void print_Listeners(struct server_config *config);
+
+/**	@brief 	Empties a reply so parts can be added to it.
+*	@param 	reply is the reply to reset.
+*	@return returns nothing.
+*/
+void reset_Reply(struct message_reply *reply);
+
+/**	@brief 	Adds a part to the end of a reply without copying it, the memory has to stay valid until the reply is sent.
+*	@param 	reply is the reply to add to.
+*			base is the start of the bytes to send.
+*			length is the number of bytes to send.
+*	@return returns nothing.
+*/
+void add_Reply_Part(struct message_reply *reply, const void *base, int length);
+
+/**	@brief 	Makes a reply out of a single string.
+*	@param 	reply is the reply to set.
+*			text is the string to send, it is not copied.
+*	@return returns nothing.
+*/
+void set_Reply_Text(struct message_reply *reply, const char *text);
+
+/**	@brief 	Formats text onto the end of a reply that is written in pieces.
+*	@param 	text is the buffer the reply is written to.
+*			length is the length written so far, -1 once a piece did not fit.
+*			size is the size of text.
+*			format and the arguments after it are passed to vsnprintf.
+*	@return returns the new length, or -1 if this or an earlier piece did not fit.
+*/
+int append_Text(char *text, int length, int size, const char *format, ...) __attribute__((format(printf, 4, 5)));
+
+/**	@brief 	Finds the optional correlation envelope in front of a message, a '#', an ID of 1 to 
+*			MAX_CORRELATION_ID letters and digits and a space, as in "#1f <echo>hi</echo>".
+*	@param 	message is the message as received.
+*			length is the length of the message.
+*	@return returns the length of the envelope including the space, 0 when there is none.
+*/
+int correlation_Length(const char *message, int length);
+
+/**	@brief 	Puts the correlation envelope of a request in front of its reply so the client can match them.
+*	@param 	reply is the reply to the request.
+*			tag is the envelope, it is not copied and usually points into the request.
+*			length is the length of the envelope, nothing is added when it is 0.
+*	@return returns nothing.
+*/
+void tag_Reply(struct message_reply *reply, const char *tag, int length);
+
+/**	@brief 	Pads a reply with null characters up to MAX_MESSAGE bytes, the fixed frame size old clients read.
+*	@param 	reply is the reply to pad.
+*	@return returns nothing.
+*/
+void pad_Reply(struct message_reply *reply);
+
+/**	@brief 	Copies the parts of a reply one after another into a buffer.
+*	@param 	reply is the reply.
+*			buffer is where the reply is written, at least reply->length bytes.
+*	@return returns nothing.
+*/
+void gather_Reply(struct message_reply *reply, char *buffer);
+
+/**	@brief 	Allocates a batch of datagrams and takes a packet buffer for every slot.
+*	@param 	packets is the pool of the server loop, with room for controlSize bytes in front of every buffer.
+*			batchSize is the number of datagram slots in the batch.
+*			datagramSize is the largest datagram a slot receives.
+*			controlSize is the room for control messages per slot, 0 for none.
+*	@return returns a pointer to the batch, NULL if it cannot be allocated or the pool has too few buffers.
+*/
+struct message_batch *create_Batch(struct packet_pool *packets, int batchSize, int datagramSize, int controlSize);
+
+/**	@brief 	Get the receive buffer of a batch slot.
+*	@param 	batch is the batch.
+*			slot is the slot number.
+*	@return returns a pointer to the buffer.
+*/
+char *batch_Buffer(struct message_batch *batch, int slot);
+
+/**	@brief 	Frees a batch created by create_Batch.
+*	@param 	batch is the batch to free.
+*	@return returns nothing.
 */
-void run_Server(int sockfd);
+void free_Batch(struct message_batch *batch);
 
+#endif
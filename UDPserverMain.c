@@ -8,30 +8,279 @@
  */
  
 #include "UDPserver.h"
+#include "UDPworkers.h"
+#include "UDPlog.h"
+#include "UDPloadavg.h"
+#include "UDPevent.h"
+#include "UDPuring.h"
+#include "UDPlimit.h"
+#include "UDPstats.h"
+#include "UDPtrace.h"
+#include "UDPbuffer.h"
+#include "UDPhandlers.h"
+#include <sys/eventfd.h>
+
+/**	@brief 	Prints how the server program should be started.
+*	@param 	no parameter is passed. 
+*	@return returns nothing. 
+*/
+void printUsage(void);
+
+/**	@brief 	Reads an extra listener given as [Address:]Port, every address of the host is used without an address.
+*			An IPv6 address is written in brackets, [::1]:9001, an IPv4 address as it is.
+*	@param 	text is the listener as given on the command line.
+*			listener is where the address is written.
+*	@return returns 0 on success, -1 when the text is not a valid listener. 
+*/
+int parse_Listener(char *text, struct sockaddr_in6 *listener);
 
 /**	@brief 	The main program for running the TCP server.
 *	@param 	argc is the number of command line arguments 
 *			argv is the matrix array containing the command line arguments 
-*	@return returns 0 to the OS when main completes. 
+*	@return returns 0 to the OS when main completes, 1 if the server could not start or failed. 
 */
 int main(int argc, char **argv){
 
-  int sockfd;
-  struct hostent *hostptr; 
-  struct sockaddr_in servaddr;
-
-  if(argc == 2){
-    sockfd = create_UDP_Socket();  //create the UDP socket
-    hostptr = info_Host(); //get the server host
-    servaddr = destination_Address(hostptr, atoi(argv[1])); //get the server IP address and argv[1] = server port number 
-    servaddr = bind_Socket(sockfd, servaddr); //bind a socket for the server program 
-    print_Server_info(sockfd, hostptr, servaddr); //print the server info
-	run_Server(sockfd); //run the server program and wait for incoming client connections
+  int option;
+  int verbosity = DEFAULT_LOG_VERBOSITY, binaryLog = 0;
+  int loadInterval = DEFAULT_LOADAVG_MIL_SEC, loadStamp = 0, statsInterval = DEFAULT_STATS_MIL_SEC;
+  int i, extraCount = 0, ruleCount = 0, limitClients = DEFAULT_LIMIT_CLIENTS, status = 0;
+  char *logPath = NULL, *statsPath = NULL, *extra[MAX_LISTENERS - 1], *rules[LIMIT_OPCODES];
+  struct server_config config = { .maxMessage = MAX_MESSAGE, .mtu = DEFAULT_MTU, .batchSize = DEFAULT_BATCH_SIZE, .workers = DEFAULT_WORKERS,
+                                 .drainTime = DEFAULT_DRAIN_MIL_SEC, .handlerCount = DEFAULT_HANDLERS, .queueDepth = DEFAULT_QUEUE_DEPTH };
+  struct server_worker worker;
+
+  //-b <Batch Size> is the number of datagrams moved per system call
+  //-w <Workers> is the number of threads each with its own SO_REUSEPORT socket, -p pins them to CPUs
+  //-v <Verbosity>, -o <Log File> and -f <text|binary> control the request log
+  //-c pads every reply to MAX_MESSAGE bytes for clients that still read fixed frames
+  //-m <Max Message> is the largest message accepted and -M <MTU> the largest datagram sent
+  //-l <Load Interval> is how often the load average is sampled, -s adds the sample time to the reply
+  //-a <[Address:]Port> adds a listener and can be repeated, -t <Run Time> stops the server after that many seconds
+  //-u serves the sockets with io_uring instead of epoll when the kernel supports it
+  //-r <Command>=<Rate>[/<Burst>] limits the requests per second of each client, -R <Clients> is how many are remembered
+  //-S <Stats File> publishes the request counters in a memory mapped file every -i <Stats Interval> milli seconds
+  //-k <Token File> holds the token a <shutdown> has to carry, -d <Drain Time> bounds the drain after it or SIGTERM
+  //-T <Timestamps> traces the stages of every request, with the kernel receive timestamp for ns and software
+  //-q <Receive Buffer> and -Q <Send Buffer> size the socket buffers, -A <Max Receive Buffer> grows them on drops
+  //-H <Handlers> answers the requests on that many handler threads, fed through queues of -D <Queue Depth> requests
+  while((option = getopt(argc, argv, "b:w:pv:o:f:cm:M:l:sa:t:ur:R:S:i:k:d:T:q:Q:A:H:D:")) != -1) {
+    if(option == 'b' && atoi(optarg) >= 1 && atoi(optarg) <= MAX_BATCH_SIZE)
+      config.batchSize = atoi(optarg);
+    else if(option == 'w' && atoi(optarg) >= 1 && atoi(optarg) <= MAX_WORKERS)
+      config.workers = atoi(optarg);
+    else if(option == 'p')
+      config.pinWorkers = 1;
+    else if(option == 'c')
+      config.padReplies = 1;
+    else if(option == 'm' && atoi(optarg) >= MAX_MESSAGE && atoi(optarg) <= MAX_MESSAGE_LIMIT)
+      config.maxMessage = atoi(optarg);
+    else if(option == 'M' && atoi(optarg) >= MIN_MTU && atoi(optarg) <= MAX_MTU)
+      config.mtu = atoi(optarg);
+    else if(option == 'l' && atoi(optarg) >= MIN_LOADAVG_MIL_SEC && atoi(optarg) <= MAX_LOADAVG_MIL_SEC)
+      loadInterval = atoi(optarg);
+    else if(option == 's')
+      loadStamp = 1;
+    else if(option == 'a' && extraCount < MAX_LISTENERS - 1)
+      extra[extraCount++] = optarg;
+    else if(option == 't' && atoi(optarg) >= 1)
+      config.runTime = atoi(optarg);
+    else if(option == 'u')
+      config.backend = BACKEND_URING;
+    else if(option == 'r' && ruleCount < LIMIT_OPCODES)
+      rules[ruleCount++] = optarg;
+    else if(option == 'R' && atoi(optarg) >= MIN_LIMIT_CLIENTS && atoi(optarg) <= MAX_LIMIT_CLIENTS)
+      limitClients = atoi(optarg);
+    else if(option == 'S')
+      statsPath = optarg;
+    else if(option == 'i' && atoi(optarg) >= MIN_STATS_MIL_SEC && atoi(optarg) <= MAX_STATS_MIL_SEC)
+      statsInterval = atoi(optarg);
+    else if(option == 'k' && read_Shutdown_Token(&config, optarg) == 0)
+      ;
+    else if(option == 'd' && atoi(optarg) >= 0 && atoi(optarg) <= MAX_DRAIN_MIL_SEC)
+      config.drainTime = atoi(optarg);
+    else if(option == 'T' && parse_Timestamps(optarg) != -1)
+      config.timestamps = parse_Timestamps(optarg);
+    else if(option == 'q' && atoi(optarg) >= MIN_SOCKET_BUFFER && atoi(optarg) <= MAX_SOCKET_BUFFER)
+      config.receiveBuffer = atoi(optarg);
+    else if(option == 'Q' && atoi(optarg) >= MIN_SOCKET_BUFFER && atoi(optarg) <= MAX_SOCKET_BUFFER)
+      config.sendBuffer = atoi(optarg);
+    else if(option == 'A' && atoi(optarg) >= MIN_SOCKET_BUFFER && atoi(optarg) <= MAX_SOCKET_BUFFER)
+      config.maxReceiveBuffer = atoi(optarg);
+    else if(option == 'H' && atoi(optarg) >= 1 && atoi(optarg) <= MAX_HANDLERS)
+      config.handlerCount = atoi(optarg);
+    else if(option == 'D' && atoi(optarg) >= MIN_QUEUE_DEPTH && atoi(optarg) <= MAX_QUEUE_DEPTH)
+      config.queueDepth = atoi(optarg);
+    else if(option == 'v' && atoi(optarg) >= LOG_OFF && atoi(optarg) <= LOG_REQUESTS)
+      verbosity = atoi(optarg);
+    else if(option == 'o')
+      logPath = optarg;
+    else if(option == 'f' && (!strcmp(optarg, "text") || !strcmp(optarg, "binary")))
+      binaryLog = !strcmp(optarg, "binary");
+    else {
+      printUsage();
+      return 0;
+    }
+  }
+
+  if(argc - optind == 1){
+    config.port = atoi(argv[optind]); //argv[optind] = server port number
+    if(register_Commands() == -1) //fill the dispatch table before any server loop reads it
+      return 1;
+    if(ruleCount > 0 && (config.limits = create_Limits(limitClients, config.workers)) == NULL)
+      return 1;
+    for(i = 0; i < ruleCount; i++) {
+      if(add_Limit(config.limits, rules[i]) == -1) {
+        printf("Invalid Rate Limit %s\n", rules[i]);
+        printUsage();
+        return 0;
+      }
+    }
+    //counters of every server loop and handler thread and the metrics file
+    if((config.stats = create_Stats(config.workers + config.handlerCount, statsPath, statsInterval)) == NULL)
+      return 1;
+    //a datagram is either a whole message or one fragment of at most the MTU
+    config.datagramSize = config.mtu - UDP_IPV4_OVERHEAD > config.maxMessage ? config.mtu - UDP_IPV4_OVERHEAD : config.maxMessage;
+    discover_Host(&config); //the host name and interface addresses, only printed
+    config.listeners[0] = destination_Address(config.port); //every address of the host on the server port
+    for(config.listenerCount = 1, i = 0; i < extraCount; i++) {
+      if(parse_Listener(extra[i], &config.listeners[config.listenerCount++]) == -1) {
+        printf("Invalid Listener %s\n", extra[i]);
+        printUsage();
+        return 0;
+      }
+    }
+    if(config.backend != BACKEND_EPOLL && config.handlerCount > 0) {
+      printf("The handler threads are fed from epoll server loops, io_uring is not used\n");
+      config.backend = BACKEND_EPOLL;
+    }
+    if(config.backend != BACKEND_EPOLL && (config.backend = uring_Supported()) == BACKEND_EPOLL)
+      printf("io_uring is not supported by this kernel, using epoll\n");
+    else if(config.backend == BACKEND_URING)
+      printf("Using io_uring, replies are sent from ordinary buffers\n");
+    else if(config.backend == BACKEND_URING_FIXED)
+      printf("Using io_uring with registered reply buffers\n");
+    if(config.timestamps != TIMESTAMPS_OFF)
+      printf("Tracing requests with %s timestamps, <trace/> replies with the stages\n", timestamps_Name(config.timestamps));
+    if(config.receiveBuffer > 0 || config.sendBuffer > 0)
+      printf("Socket buffers of %d bytes for receiving and %d for sending, 0 is the kernel default\n", config.receiveBuffer, config.sendBuffer);
+    if(config.maxReceiveBuffer > 0)
+      printf("Receive buffers double on dropped datagrams up to %d bytes\n", config.maxReceiveBuffer);
+    if(block_Signals(&config.signals) == -1) //SIGINT and SIGTERM are read from a signalfd, block them before any thread starts
+      return 1;
+    if((config.wakefd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1) {
+      printErrorMessage("Cannot Create the Wake Event");
+      return 1;
+    }
+    config.log = start_Log(verbosity, binaryLog, logPath, config.workers); //start the background log thread
+    config.loadavg = start_Loadavg(loadInterval, loadStamp); //start sampling the load average
+    if(config.handlerCount > 0 && (config.handlers = start_Handlers(&config)) != NULL)
+      printf("Answering on %d handler threads, %d requests per queue before replying busy\n", config.handlerCount, config.queueDepth);
+    if((config.log == NULL && verbosity != LOG_OFF) || config.loadavg == NULL || (config.handlerCount > 0 && config.handlers == NULL))
+      status = 1;
+    else if(config.workers > 1) 
+      status = run_Workers(&config) == 0 ? 0 : 1; //run one server loop per worker thread on the same port
+    else {
+      //set up the state of the only server loop, then create and bind a UDP socket for every listener
+      if(init_Worker(&worker, 0, &config) == 0 && open_Sockets(&worker, 0) == 0) {
+        print_Server_info(&config); //print the server info
+        print_Listeners(&config);
+        status = run_Server(&worker) == 0 ? 0 : 1; //run the server program and wait for incoming client connections
+        finish_Server(&config); //flush the statistics and the log before the sockets are closed
+      }
+      else
+        status = 1;
+      free_Worker(&worker);
+    }
+    free_Handlers(config.handlers);
+    print_Limits(config.limits);
+    free_Limits(config.limits);
+    print_Stats(config.stats);
+    free_Stats(config.stats); //the metrics file keeps the final counters
+    stop_Loadavg(config.loadavg);
+    stop_Log(config.log); //write out the remaining log records
+    close(config.wakefd);
   }
   else {
   	printf("Incorrect Number of Command Line Arguments\n");
-	printf("./server <Port Number>\n");
+	printUsage();
   }
-  return 0;
+  return status;
 }
 
+/*
+ **************************************************
+ **************************************************
+ */
+void printUsage(void){
+  printf("./server [-b <Batch Size>] [-w <Workers>] [-p] [-v <Verbosity>] [-o <Log File>] [-f <Log Format>] [-c] [-m <Max Message>] [-M <MTU>] [-l <Load Interval>] [-s] [-a <[Address:]Port>] [-t <Run Time>] [-u] [-r <Command>=<Rate>[/<Burst>]] [-R <Clients>] [-S <Stats File>] [-i <Stats Interval>] [-k <Token File>] [-d <Drain Time>] [-T <Timestamps>] [-q <Receive Buffer>] [-Q <Send Buffer>] [-A <Max Receive Buffer>] [-H <Handlers>] [-D <Queue Depth>] <Port Number>\n");
+  printf("  -b  number of datagrams received and sent per system call (1 - %d, default %d)\n", MAX_BATCH_SIZE, DEFAULT_BATCH_SIZE);
+  printf("  -w  number of worker threads sharing the port with SO_REUSEPORT (1 - %d, default %d)\n", MAX_WORKERS, DEFAULT_WORKERS);
+  printf("  -p  pin each worker thread to its own CPU\n");
+  printf("  -v  log verbosity, %d off, %d batch sizes, %d every request (default %d)\n", LOG_OFF, LOG_BATCHES, LOG_REQUESTS, DEFAULT_LOG_VERBOSITY);
+  printf("  -o  file the log is written to (default stdout)\n");
+  printf("  -f  log format, text or binary (default text)\n");
+  printf("  -c  compatibility mode, pad every reply with null characters to %d bytes\n", MAX_MESSAGE);
+  printf("  -m  largest message accepted in bytes (%d - %d, default %d)\n", MAX_MESSAGE, MAX_MESSAGE_LIMIT, MAX_MESSAGE);
+  printf("  -M  path MTU, larger messages are sent as fragments (%d - %d, default %d)\n", MIN_MTU, MAX_MTU, DEFAULT_MTU);
+  printf("  -l  milli seconds between load average samples (%d - %d, default %d)\n", MIN_LOADAVG_MIL_SEC, MAX_LOADAVG_MIL_SEC, DEFAULT_LOADAVG_MIL_SEC);
+  printf("  -s  add the time the load average was sampled to the reply as sampled=\"<ms>\"\n");
+  printf("  -a  also listen on [Address:]Port, an IPv6 address in brackets, can be given up to %d times\n", MAX_LISTENERS - 1);
+  printf("  -t  stop the server after this many seconds (default runs until shut down)\n");
+  printf("  -r  answer at most Rate requests per second of the command from each IPv4 client address or IPv6 /64, with bursts of\n");
+  printf("      up to Burst (default Rate, at most %d), the command error limits messages that are not a command, can be repeated\n", MAX_LIMIT_BURST);
+  printf("  -R  number of client addresses each server loop remembers for -r (%d - %d, default %d)\n", MIN_LIMIT_CLIENTS, MAX_LIMIT_CLIENTS, DEFAULT_LIMIT_CLIENTS);
+  printf("  -S  file the request counters are published in, memory mapped so other programs can read it\n");
+  printf("  -i  milli seconds between updates of the stats file (%d - %d, default %d)\n", MIN_STATS_MIL_SEC, MAX_STATS_MIL_SEC, DEFAULT_STATS_MIL_SEC);
+  printf("  -k  file whose first line is the token <shutdown>token</shutdown> has to carry (default only the loopback address can shut down)\n");
+  printf("  -d  milli seconds a shutdown or SIGTERM waits for queued requests to be answered (0 - %d, default %d)\n", MAX_DRAIN_MIL_SEC, DEFAULT_DRAIN_MIL_SEC);
+  printf("  -u  receive and send with io_uring, falls back to epoll on kernels without it (-b is not used)\n");
+  printf("  -T  trace the queue, service and send time of every request into histograms read with <trace/> and into\n");
+  printf("      the request log, stages only stamps the server loop, ns (SO_TIMESTAMPNS) and software (SO_TIMESTAMPING)\n");
+  printf("      also stamp the datagram in the kernel to measure the socket queue (default off)\n");
+  printf("  -q  receive buffer of every socket in bytes (%d - %d, default the kernel default, net.core.rmem_default)\n", MIN_SOCKET_BUFFER, MAX_SOCKET_BUFFER);
+  printf("  -Q  send buffer of every socket in bytes (%d - %d, default the kernel default, net.core.wmem_default)\n", MIN_SOCKET_BUFFER, MAX_SOCKET_BUFFER);
+  printf("  -A  double the receive buffer of a socket that dropped datagrams, up to this many bytes (%d - %d, default off)\n", MIN_SOCKET_BUFFER, MAX_SOCKET_BUFFER);
+  printf("      the datagrams dropped because a receive buffer was full are counted as overflow in <stats/>\n");
+  printf("  -H  answer the requests on this many handler threads, the server loops only receive and send (1 - %d, default off)\n", MAX_HANDLERS);
+  printf("  -D  requests each server loop can hand out and each handler can queue, more are answered <error>busy</error>\n");
+  printf("      and counted as busy in <stats/> (%d - %d, default %d)\n", MIN_QUEUE_DEPTH, MAX_QUEUE_DEPTH, DEFAULT_QUEUE_DEPTH);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	MODIFIED ON 10/17/2026
+ *	IPv6 addresses in brackets, an IPv4 address is stored v4 mapped for the dual stack socket
+ **************************************************
+ */
+int parse_Listener(char *text, struct sockaddr_in6 *listener){
+  char address[INET6_ADDRSTRLEN];
+  char *colon = strrchr(text, ':'), *start = text, *end;
+  struct in_addr v4;
+  int port = atoi(colon == NULL ? text : colon + 1);
+  if(port < 1 || port > 65535)
+    return -1;
+  *listener = destination_Address(port);
+  if(colon == NULL)
+    return 0;
+  end = colon;
+  if(*text == '[') {
+    start = text + 1;
+    end = colon - 1;
+    if(end < start || *end != ']')
+      return -1;
+  }
+  if(end - start >= INET6_ADDRSTRLEN)
+    return -1;
+  memcpy(address, start, end - start);
+  address[end - start] = '\0';
+  if(start != text)
+    return inet_pton(AF_INET6, address, &listener->sin6_addr) == 1 ? 0 : -1;
+  if(inet_pton(AF_INET, address, &v4) != 1)
+    return -1;
+  listener->sin6_addr.s6_addr[10] = listener->sin6_addr.s6_addr[11] = 0xFF; //::ffff:a.b.c.d
+  memcpy(&listener->sin6_addr.s6_addr[12], &v4, sizeof(v4));
+  return 0;
+}
@@ -0,0 +1,401 @@
+/**	@file UDPstats.c
+ * 	@brief Contains the function implementations of the request statistics.
+ *	Every server loop counts its requests, bytes, drops and latencies in its own cache lines.
+ *	A <stats/> request adds up the counters of every loop, and a timer of the first loop copies them
+ *	into a memory mapped file so other programs can read them without asking the server.
+ *	The loops never write to the mapping themselves, a store to a shared file page can fault
+ *	after the kernel wrote it back to disk.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPstats.h"
+#include "UDPdispatch.h"
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Adds to a counter only its server loop writes.
+*	@param 	counter is the counter.
+*			amount is added to it.
+*	@return returns nothing.
+*/
+void add_Stat(atomic_ulong *counter, unsigned long amount);
+
+/**	@brief 	Copies the counters of one server loop.
+*	@param 	stats is the counters.
+*			counts is where they are copied to.
+*	@return returns nothing.
+*/
+void read_Counts(struct worker_stats *stats, struct stats_counts *counts);
+
+/**	@brief 	Adds up the counters of every server loop.
+*	@param 	stats is the statistics.
+*			total is where the sum is written.
+*	@return returns nothing.
+*/
+void sum_Counts(struct server_stats *stats, struct stats_counts *total);
+
+/**	@brief 	Finds the latency below which a share of the requests completed.
+*	@param 	histogram is the STATS_LATENCY_BUCKETS buckets of a latency histogram.
+*			permille is the share in thousandths.
+*	@return returns the upper bound of the histogram bucket in nano seconds, 0 without requests.
+*/
+uint64_t latency_Percentile(const uint64_t *histogram, int permille);
+
+/**	@brief 	Adds up the requests in a latency histogram.
+*	@param 	histogram is the STATS_LATENCY_BUCKETS buckets of a latency histogram.
+*	@return returns the number of requests.
+*/
+uint64_t histogram_Count(const uint64_t *histogram);
+
+/**	@brief 	Get the histogram bucket of a latency.
+*	@param 	latency is the time in nano seconds.
+*	@return returns the bucket of its highest set bit, the last bucket for anything slower.
+*/
+int latency_Bucket(uint64_t latency);
+
+/*
+ **************************************************
+ *		STATS FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The file is sized and mapped once, the flush timer only copies into it.
+ **************************************************
+ */
+struct server_stats *create_Stats(int workers, const char *path, int interval){
+  struct server_stats *stats = calloc(1, sizeof(struct server_stats));
+  const char *name;
+  int opcode;
+  if(stats == NULL) {
+	printErrorMessage("Cannot Allocate Statistics");
+    return NULL;
+  }
+  stats->worker = aligned_alloc(CACHE_LINE, workers * sizeof(struct worker_stats));
+  if(stats->worker == NULL) {
+	printErrorMessage("Cannot Allocate Statistics");
+    free(stats);
+    return NULL;
+  }
+  memset(stats->worker, 0, workers * sizeof(struct worker_stats));
+  stats->workers = workers;
+  stats->interval = interval;
+  stats->fd = -1;
+  if(path == NULL)
+    return stats;
+
+  stats->fileSize = sizeof(struct stats_file) + workers * sizeof(struct stats_counts);
+  if((stats->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) == -1 || ftruncate(stats->fd, stats->fileSize) == -1) {
+	printErrorMessage("Cannot Create Statistics File");
+    free_Stats(stats);
+    return NULL;
+  }
+  stats->file = mmap(NULL, stats->fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, stats->fd, 0);
+  if(stats->file == MAP_FAILED) {
+	printErrorMessage("Cannot Map Statistics File");
+    stats->file = NULL;
+    free_Stats(stats);
+    return NULL;
+  }
+  stats->file->version = STATS_VERSION;
+  stats->file->workers = workers;
+  stats->file->opcodes = STATS_OPCODES;
+  stats->file->buckets = STATS_LATENCY_BUCKETS;
+  stats->file->headerSize = sizeof(struct stats_file);
+  stats->file->countsSize = sizeof(struct stats_counts);
+  for(opcode = 0; opcode < STATS_OPCODES; opcode++) {
+    name = opcode == OPCODE_ERROR ? "error" : command_Name(opcode);
+    if(name != NULL)
+      snprintf(stats->file->names[opcode], STATS_NAME, "%s", name);
+  }
+  flush_Stats(stats);
+  memcpy(stats->file->magic, STATS_MAGIC, sizeof(stats->file->magic)); //a reader sees the magic once the file is complete
+  return stats;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void free_Stats(struct server_stats *stats){
+  if(stats == NULL)
+    return;
+  if(stats->file != NULL) {
+    flush_Stats(stats);
+    munmap(stats->file, stats->fileSize);
+  }
+  if(stats->fd != -1)
+    close(stats->fd);
+  free(stats->worker);
+  free(stats);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The latency goes into the bucket of its highest set bit.
+ *	MODIFIED ON 10/17/2026
+ *	A traced request also counts its stages, the queue only when the kernel stamped the datagram
+ **************************************************
+ */
+void count_Request(struct server_worker *worker, int opcode, int requestLength, int replyLength, const struct request_trace *trace){
+  struct worker_stats *stats = worker->stats;
+  uint64_t now = log_Clock();
+
+  if(opcode >= 0 && opcode < STATS_OPCODES)
+    add_Stat(&stats->requests[opcode], 1);
+  add_Stat(&stats->bytesIn, requestLength);
+  if(replyLength < 0)
+    add_Stat(&stats->failed, 1);
+  else
+    add_Stat(&stats->bytesOut, replyLength);
+  add_Stat(&stats->latency[latency_Bucket(now - trace->received)], 1);
+  if(trace->handled == 0)
+    return;
+  if(trace->queued != TRACE_UNKNOWN)
+    add_Stat(&stats->stages[STAGE_QUEUE][latency_Bucket(trace->queued)], 1);
+  add_Stat(&stats->stages[STAGE_SERVICE][latency_Bucket(trace->handled - trace->dispatched)], 1);
+  add_Stat(&stats->stages[STAGE_SEND][latency_Bucket(now - trace->handled)], 1);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void count_Drop(struct server_worker *worker){
+  add_Stat(&worker->stats->dropped, 1);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void count_Overflows(struct server_worker *worker, unsigned long amount){
+  add_Stat(&worker->stats->overflows, amount);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void count_Busy(struct server_worker *worker){
+  add_Stat(&worker->stats->busy, 1);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	A sequence lock, the counts are copied between the two increments of sequence.
+ **************************************************
+ */
+void flush_Stats(struct server_stats *stats){
+  struct stats_counts *counts = (struct stats_counts *) ((char *) stats->file + sizeof(struct stats_file));
+  struct timespec now;
+  uint64_t sequence = stats->file->sequence;
+  int i;
+
+  __atomic_store_n(&stats->file->sequence, sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  for(i = 0; i < stats->workers; i++)
+    read_Counts(&stats->worker[i], &counts[i]);
+  clock_gettime(CLOCK_REALTIME, &now);
+  stats->file->updated = (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+  __atomic_store_n(&stats->file->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Commands nobody sent are left out.
+ *	MODIFIED ON 10/17/2026
+ *	The number of requests answered busy is added once there was one.
+ *	STATS_REPLY_MAX holds every attribute and command at 20 digits, a reply that still does not fit
+ *	is sent as an error rather than cut off before its closing tag.
+ **************************************************
+ */
+int render_Stats(struct server_stats *stats, char *text){
+  struct stats_counts total;
+  const char *name;
+  int length, opcode;
+
+  sum_Counts(stats, &total);
+  length = append_Text(text, 0, STATS_REPLY_MAX, "<replyStats in=\"%lu\" out=\"%lu\" dropped=\"%lu\" overflow=\"%lu\" failed=\"%lu\" p50=\"%lu\" p99=\"%lu\"",
+                       (unsigned long) total.bytesIn, (unsigned long) total.bytesOut, (unsigned long) total.dropped,
+                       (unsigned long) total.overflows, (unsigned long) total.failed, (unsigned long) latency_Percentile(total.latency, 500),
+                       (unsigned long) latency_Percentile(total.latency, 990));
+  if(total.busy > 0)
+    length = append_Text(text, length, STATS_REPLY_MAX, " busy=\"%lu\"", (unsigned long) total.busy);
+  length = append_Text(text, length, STATS_REPLY_MAX, ">");
+  for(opcode = 0; opcode < STATS_OPCODES; opcode++) {
+    if(total.requests[opcode] == 0)
+      continue;
+    name = opcode == OPCODE_ERROR ? "error" : command_Name(opcode);
+    length = append_Text(text, length, STATS_REPLY_MAX, "<%s>%lu</%s>", name, (unsigned long) total.requests[opcode], name);
+  }
+  length = append_Text(text, length, STATS_REPLY_MAX, "</replyStats>");
+  if(length == -1)
+    length = snprintf(text, STATS_REPLY_MAX, "<error>statistics do not fit in a reply</error>");
+  return length;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	traced is the number of requests with stages and stamped those the kernel stamped as well,
+ *	every stage is written as its median, 99th percentile and the bucket of the slowest request.
+ *	MODIFIED ON 10/17/2026
+ *	Written with append_Text like render_Stats
+ **************************************************
+ */
+int render_Trace(struct server_stats *stats, char *text){
+  static const char *names[TRACE_STAGES] = { "queue", "service", "send" };
+  struct stats_counts total;
+  int length, stage;
+
+  sum_Counts(stats, &total);
+  length = append_Text(text, 0, STATS_REPLY_MAX, "<replyTrace traced=\"%lu\" stamped=\"%lu\">",
+                       (unsigned long) histogram_Count(total.stages[STAGE_SERVICE]), (unsigned long) histogram_Count(total.stages[STAGE_QUEUE]));
+  for(stage = 0; stage < TRACE_STAGES; stage++)
+    length = append_Text(text, length, STATS_REPLY_MAX, "<%s p50=\"%lu\" p99=\"%lu\" max=\"%lu\"/>", names[stage],
+                         (unsigned long) latency_Percentile(total.stages[stage], 500),
+                         (unsigned long) latency_Percentile(total.stages[stage], 990),
+                         (unsigned long) latency_Percentile(total.stages[stage], 1000));
+  length = append_Text(text, length, STATS_REPLY_MAX, "</replyTrace>");
+  if(length == -1)
+    length = snprintf(text, STATS_REPLY_MAX, "<error>trace does not fit in a reply</error>");
+  return length;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void print_Stats(struct server_stats *stats){
+  struct stats_counts total;
+  char text[STATS_REPLY_MAX];
+  if(stats == NULL)
+    return;
+  render_Stats(stats, text);
+  printf("Statistics : %s\n", text);
+  sum_Counts(stats, &total);
+  if(histogram_Count(total.stages[STAGE_SERVICE]) == 0)
+    return;
+  render_Trace(stats, text);
+  printf("Trace : %s\n", text);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void add_Stat(atomic_ulong *counter, unsigned long amount){
+  atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void read_Counts(struct worker_stats *stats, struct stats_counts *counts){
+  int i;
+  for(i = 0; i < STATS_OPCODES; i++)
+    counts->requests[i] = atomic_load_explicit(&stats->requests[i], memory_order_relaxed);
+  counts->bytesIn = atomic_load_explicit(&stats->bytesIn, memory_order_relaxed);
+  counts->bytesOut = atomic_load_explicit(&stats->bytesOut, memory_order_relaxed);
+  counts->dropped = atomic_load_explicit(&stats->dropped, memory_order_relaxed);
+  counts->failed = atomic_load_explicit(&stats->failed, memory_order_relaxed);
+  counts->overflows = atomic_load_explicit(&stats->overflows, memory_order_relaxed);
+  counts->busy = atomic_load_explicit(&stats->busy, memory_order_relaxed);
+  for(i = 0; i < STATS_LATENCY_BUCKETS; i++)
+    counts->latency[i] = atomic_load_explicit(&stats->latency[i], memory_order_relaxed);
+  for(i = 0; i < TRACE_STAGES * STATS_LATENCY_BUCKETS; i++)
+    counts->stages[i / STATS_LATENCY_BUCKETS][i % STATS_LATENCY_BUCKETS] =
+      atomic_load_explicit(&stats->stages[i / STATS_LATENCY_BUCKETS][i % STATS_LATENCY_BUCKETS], memory_order_relaxed);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void sum_Counts(struct server_stats *stats, struct stats_counts *total){
+  struct stats_counts counts;
+  int i, j;
+  memset(total, 0, sizeof(struct stats_counts));
+  for(i = 0; i < stats->workers; i++) {
+    read_Counts(&stats->worker[i], &counts);
+    for(j = 0; j < STATS_OPCODES; j++)
+      total->requests[j] += counts.requests[j];
+    total->bytesIn += counts.bytesIn;
+    total->bytesOut += counts.bytesOut;
+    total->dropped += counts.dropped;
+    total->failed += counts.failed;
+    total->overflows += counts.overflows;
+    total->busy += counts.busy;
+    for(j = 0; j < STATS_LATENCY_BUCKETS; j++)
+      total->latency[j] += counts.latency[j];
+    for(j = 0; j < TRACE_STAGES * STATS_LATENCY_BUCKETS; j++)
+      total->stages[j / STATS_LATENCY_BUCKETS][j % STATS_LATENCY_BUCKETS] += counts.stages[j / STATS_LATENCY_BUCKETS][j % STATS_LATENCY_BUCKETS];
+  }
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+uint64_t latency_Percentile(const uint64_t *histogram, int permille){
+  uint64_t requests = histogram_Count(histogram), seen = 0, wanted;
+  int i;
+  if(requests == 0)
+    return 0;
+  wanted = (requests * permille + 999) / 1000;
+  for(i = 0; i < STATS_LATENCY_BUCKETS - 1; i++) {
+    seen += histogram[i];
+    if(seen >= wanted)
+      break;
+  }
+  return 1ULL << i;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int latency_Bucket(uint64_t latency){
+  int bucket = latency == 0 ? 0 : 64 - __builtin_clzll(latency);
+  return bucket < STATS_LATENCY_BUCKETS ? bucket : STATS_LATENCY_BUCKETS - 1;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+uint64_t histogram_Count(const uint64_t *histogram){
+  uint64_t requests = 0;
+  int i;
+  for(i = 0; i < STATS_LATENCY_BUCKETS; i++)
+    requests += histogram[i];
+  return requests;
+}
@@ -0,0 +1,183 @@
+/**	@file UDPstats.h
+ * 	@brief Contains the function prototypes for the request statistics of the UDP server
+ *	that are implemented in UDPstats.c
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPSTATS_H
+#define UDPSTATS_H
+
+#include "UDPserver.h"
+#include "UDPlog.h"
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define STATS_OPCODES 8			//message_opcode values that are counted
+#define STATS_LATENCY_BUCKETS 32	//bucket i counts latencies below 2^i nano seconds, the last one everything slower
+#define STATS_NAME 16
+#define STATS_MAGIC "UDPSTATS"
+#define STATS_VERSION 6
+#define DEFAULT_STATS_MIL_SEC 1000
+#define MIN_STATS_MIL_SEC 10
+#define MAX_STATS_MIL_SEC 60000
+#define STATS_REPLY_MAX MAX_REPLY_TEXT
+#define TRACE_STAGES 3
+#define STAGE_QUEUE 0		//kernel receive timestamp to the start of building the reply
+#define STAGE_SERVICE 1		//building the reply, parsing and the handler
+#define STAGE_SEND 2		//end of the handler to the send completing
+
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+/**	@brief 	The counters of one server loop. Only that loop writes them, so they need no locked updates,
+*			and every loop has its own cache lines so the loops never write to the same line.
+*			dropped counts the requests refused by the rate limits and failed the replies that could not be sent.
+*			overflows counts the datagrams the kernel dropped because a receive buffer of the loop was full.
+*			busy counts the requests the loop answered busy because the handler threads could not take them.
+*			stages are the histograms of the traced requests, one per STAGE, with the buckets of latency.
+*/
+struct worker_stats {
+  atomic_ulong requests[STATS_OPCODES];
+  atomic_ulong bytesIn;
+  atomic_ulong bytesOut;
+  atomic_ulong dropped;
+  atomic_ulong failed;
+  atomic_ulong overflows;
+  atomic_ulong busy;
+  atomic_ulong latency[STATS_LATENCY_BUCKETS];	//receive to send time
+  atomic_ulong stages[TRACE_STAGES][STATS_LATENCY_BUCKETS];
+} __attribute__((aligned(CACHE_LINE)));
+
+/**	@brief 	A copy of the counters of one server loop, or of their sum. The metrics file holds one per loop.
+*/
+struct stats_counts {
+  uint64_t requests[STATS_OPCODES];
+  uint64_t bytesIn;
+  uint64_t bytesOut;
+  uint64_t dropped;
+  uint64_t failed;
+  uint64_t overflows;
+  uint64_t busy;
+  uint64_t latency[STATS_LATENCY_BUCKETS];
+  uint64_t stages[TRACE_STAGES][STATS_LATENCY_BUCKETS];
+};
+
+/**	@brief 	The start of the metrics file, followed by workers stats_counts at headerSize bytes from the start.
+*			The file is only written by the flush timer. sequence is odd while a flush is in progress, a reader
+*			copies the counts when it is even and copies them again if sequence changed in the meantime.
+*			updated is the CLOCK_REALTIME time of the last flush in nano seconds, names the command of each opcode.
+*/
+struct stats_file {
+  char magic[8];
+  uint32_t version;
+  uint32_t workers;
+  uint32_t opcodes;
+  uint32_t buckets;
+  uint32_t headerSize;
+  uint32_t countsSize;
+  uint64_t sequence;
+  uint64_t updated;
+  char names[STATS_OPCODES][STATS_NAME];
+};
+
+/**	@brief 	The counters of every server loop and the metrics file they are published in.
+*			file is NULL when no metrics file was asked for, the counters are then only read by <stats/>.
+*/
+struct server_stats {
+  int workers;
+  struct worker_stats *worker;
+  int interval;
+  int fd;
+  struct stats_file *file;
+  size_t fileSize;
+};
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Allocates the counters and creates and maps the metrics file.
+*	@param 	workers is the number of server loops.
+*			path is the metrics file, NULL to publish nothing.
+*			interval is the time between flushes of the metrics file in milli seconds.
+*	@return returns the statistics, NULL if they cannot be allocated or the file cannot be created.
+*/
+struct server_stats *create_Stats(int workers, const char *path, int interval);
+
+/**	@brief 	Flushes the metrics file a last time and frees the statistics once no server loop is running.
+*			The file is left in place for readers.
+*	@param 	stats is the statistics returned by create_Stats, may be NULL.
+*	@return returns nothing.
+*/
+void free_Stats(struct server_stats *stats);
+
+/**	@brief 	Counts a request that was answered, and the time of each stage when it was traced.
+*	@param 	worker is the server loop that handled the request.
+*			opcode is the command the request was recognised as.
+*			requestLength and replyLength are the message sizes in bytes, replyLength is -1 if the send failed.
+*			trace is the stamps of the request, the send completed now.
+*	@return returns nothing.
+*/
+void count_Request(struct server_worker *worker, int opcode, int requestLength, int replyLength, const struct request_trace *trace);
+
+/**	@brief 	Counts a request that was dropped without a reply.
+*	@param 	worker is the server loop that dropped the request.
+*	@return returns nothing.
+*/
+void count_Drop(struct server_worker *worker);
+
+/**	@brief 	Counts the datagrams the kernel dropped before the server loop could receive them.
+*	@param 	worker is the server loop whose socket dropped them.
+*			amount is the number of datagrams.
+*	@return returns nothing.
+*/
+void count_Overflows(struct server_worker *worker, unsigned long amount);
+
+/**	@brief 	Counts a request that was answered busy instead of being handed to the handler threads.
+*	@param 	worker is the server loop that shed the request.
+*	@return returns nothing.
+*/
+void count_Busy(struct server_worker *worker);
+
+/**	@brief 	Copies the counters of every server loop into the metrics file, called from a timer of the first loop.
+*	@param 	stats is the statistics.
+*	@return returns nothing.
+*/
+void flush_Stats(struct server_stats *stats);
+
+/**	@brief 	Writes the sum of the counters of every server loop as a <replyStats> reply.
+*	@param 	stats is the statistics.
+*			text is where the reply is written, STATS_REPLY_MAX bytes.
+*	@return returns the length of the reply.
+*/
+int render_Stats(struct server_stats *stats, char *text);
+
+/**	@brief 	Writes the stage histograms of every server loop added up as a <replyTrace> reply.
+*	@param 	stats is the statistics.
+*			text is where the reply is written, STATS_REPLY_MAX bytes.
+*	@return returns the length of the reply.
+*/
+int render_Trace(struct server_stats *stats, char *text);
+
+/**	@brief 	Prints the counters of every server loop added up, and the stages when requests were traced.
+*	@param 	stats is the statistics, may be NULL.
+*	@return returns nothing.
+*/
+void print_Stats(struct server_stats *stats);
+
+#endif
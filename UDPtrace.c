@@ -0,0 +1,146 @@
+/**	@file UDPtrace.c
+ * 	@brief Contains the function implementations of tracing the stages of a request.
+ *	A traced request is stamped when the kernel queued its datagram, when the server loop started
+ *	building its reply, when the handler finished and when the send completed. The time between
+ *	two stamps goes into the histogram of that stage, so waiting in the socket queue shows up
+ *	apart from the time spent parsing and answering the request.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPtrace.h"
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Finds the receive timestamp in the control messages of a datagram.
+*	@param 	control and controlLength are the control messages.
+*	@return returns the CLOCK_REALTIME time in nano seconds, 0 if the datagram was not stamped.
+*/
+uint64_t read_Timestamp(void *control, size_t controlLength);
+
+/*
+ **************************************************
+ *		TRACE FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ **************************************************
+ */
+int parse_Timestamps(const char *text){
+  int mode;
+  for(mode = TIMESTAMPS_STAGES; mode <= TIMESTAMPS_SOFTWARE; mode++)
+    if(strcmp(text, timestamps_Name(mode)) == 0)
+      return mode;
+  return -1;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+const char *timestamps_Name(int mode){
+  static const char *names[] = { "off", "stages", "ns", "software" };
+  return mode >= TIMESTAMPS_OFF && mode <= TIMESTAMPS_SOFTWARE ? names[mode] : "unknown";
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	Software stamps have to be both generated on receive and reported, the hardware ones are
+ *	not asked for since they are taken in the clock of the network card.
+ **************************************************
+ */
+int enable_Timestamps(int sockfd, int mode){
+  int on = 1, flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+  if(mode == TIMESTAMPS_NS && setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == -1)
+	return printErrorMessage("Cannot Set SO_TIMESTAMPNS for socket");
+  if(mode == TIMESTAMPS_SOFTWARE && setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == -1)
+	return printErrorMessage("Cannot Set SO_TIMESTAMPING for socket");
+  return 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int trace_Control_Size(int mode){
+  return mode >= TIMESTAMPS_NS ? TRACE_CONTROL_SIZE : 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+uint64_t trace_Realtime(int mode){
+  struct timespec now;
+  if(mode < TIMESTAMPS_NS)
+    return 0;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+
+/*
+ **************************************************
+ *	ADDED ON 10/17/2026
+ *	The kernel stamps in CLOCK_REALTIME and the server loop in CLOCK_MONOTONIC, the realtime of
+ *	dispatched is the realtime of the round moved on by the monotonic time since it started.
+ *	A stamp from after dispatched means the clock was set back, the queue time is then unknown.
+ **************************************************
+ */
+void start_Trace(struct request_trace *trace, int mode, void *control, size_t controlLength, uint64_t received, uint64_t realtime){
+  uint64_t kernel, dispatched;
+  trace->received = received;
+  trace->dispatched = trace->handled = 0;
+  trace->queued = TRACE_UNKNOWN;
+  if(mode == TIMESTAMPS_OFF)
+    return;
+  trace->dispatched = log_Clock();
+  if(mode < TIMESTAMPS_NS || (kernel = read_Timestamp(control, controlLength)) == 0)
+    return;
+  dispatched = realtime + (trace->dispatched - received);
+  if(dispatched >= kernel)
+    trace->queued = dispatched - kernel;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void end_Handler(struct request_trace *trace){
+  if(trace->dispatched != 0)
+    trace->handled = log_Clock();
+}
+
+
+/*
+ **************************************************
+ *	SO_TIMESTAMPING reports software, deprecated and hardware stamps, the software one comes first.
+ **************************************************
+ */
+uint64_t read_Timestamp(void *control, size_t controlLength){
+  struct msghdr header = { .msg_control = control, .msg_controllen = controlLength };
+  struct cmsghdr *message;
+  struct timespec stamp;
+  if(control == NULL)
+    return 0;
+  for(message = CMSG_FIRSTHDR(&header); message != NULL; message = CMSG_NXTHDR(&header, message)) {
+    if(message->cmsg_level != SOL_SOCKET || (message->cmsg_type != SCM_TIMESTAMPNS && message->cmsg_type != SCM_TIMESTAMPING))
+      continue;
+    memcpy(&stamp, CMSG_DATA(message), sizeof(stamp));
+    return (uint64_t) stamp.tv_sec * 1000000000ULL + stamp.tv_nsec;
+  }
+  return 0;
+}
@@ -0,0 +1,84 @@
+/**	@file UDPtrace.h
+ * 	@brief Contains the function prototypes for tracing the stages of a request through the UDP server
+ *	that are implemented in UDPtrace.c
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPTRACE_H
+#define UDPTRACE_H
+
+#include "UDPserver.h"
+#include "UDPlog.h"
+#include <stdint.h>
+#include <time.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define TIMESTAMPS_OFF 0
+#define TIMESTAMPS_STAGES 1	//only the stamps of the server loop, the time in the socket queue is not known
+#define TIMESTAMPS_NS 2		//SO_TIMESTAMPNS, the kernel stamps a datagram when it is queued on the socket
+#define TIMESTAMPS_SOFTWARE 3	//SO_TIMESTAMPING with software receive stamps, taken when the packet reaches the stack
+#define TRACE_CONTROL_SIZE CMSG_SPACE(sizeof(struct scm_timestamping))	//room for either control message
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Reads the timestamp mode given with -T.
+*	@param 	text is stages, ns or software.
+*	@return returns the TIMESTAMPS mode, -1 if the text is not one.
+*/
+int parse_Timestamps(const char *text);
+
+/**	@brief 	Get the name of a timestamp mode.
+*	@param 	mode is the TIMESTAMPS mode.
+*	@return returns the name as given to -T.
+*/
+const char *timestamps_Name(int mode);
+
+/**	@brief 	Asks the kernel to stamp every datagram received on a socket.
+*	@param 	sockfd is the socket.
+*			mode is the TIMESTAMPS mode, the socket is left alone without kernel stamps.
+*	@return returns 0 on success, -1 if the socket option cannot be set.
+*/
+int enable_Timestamps(int sockfd, int mode);
+
+/**	@brief 	Get the room a receive needs for the control message of a timestamp mode.
+*	@param 	mode is the TIMESTAMPS mode.
+*	@return returns TRACE_CONTROL_SIZE with kernel stamps, 0 otherwise.
+*/
+int trace_Control_Size(int mode);
+
+/**	@brief 	Get the CLOCK_REALTIME time the kernel stamps are taken in, read once per receive round.
+*	@param 	mode is the TIMESTAMPS mode.
+*	@return returns the time in nano seconds, 0 without kernel stamps.
+*/
+uint64_t trace_Realtime(int mode);
+
+/**	@brief 	Starts the trace of a request just before its reply is built.
+*	@param 	trace is the trace to start.
+*			mode is the TIMESTAMPS mode.
+*			control and controlLength are the control messages received with the datagram, may be NULL.
+*			received is the log_Clock time of the receive round.
+*			realtime is the trace_Realtime time of the same round.
+*	@return returns nothing.
+*/
+void start_Trace(struct request_trace *trace, int mode, void *control, size_t controlLength, uint64_t received, uint64_t realtime);
+
+/**	@brief 	Stamps the end of building the reply of a traced request.
+*	@param 	trace is the trace started by start_Trace.
+*	@return returns nothing.
+*/
+void end_Handler(struct request_trace *trace);
+
+#endif
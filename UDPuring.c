@@ -0,0 +1,638 @@
+/**	@file UDPuring.c
+ * 	@brief Contains the function implementations of the io_uring server loop.
+ *	The rings are set up with the raw system calls so the server does not need liburing.
+ *	Every socket gets one multishot recvmsg that keeps receiving into buffers the kernel picks
+ *	from a provided buffer ring, and replies are copied into registered buffers and queued as
+ *	sends. One io_uring_enter per round submits all queued sends and waits for the next completions,
+ *	so a busy loop makes one system call for many datagrams in and out.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPuring.h"
+#include "UDPstats.h"
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Creates an io_uring instance and maps its rings.
+*	@param 	ring is the ring to set up.
+*			entries is the number of submission queue entries.
+*			flags are the IORING_SETUP flags to ask for.
+*	@return returns 0 on success, -1 if the kernel refused the ring.
+*/
+int setup_Uring(struct uring_loop *ring, unsigned entries, unsigned flags);
+
+/**	@brief 	Maps the receive and reply buffers in a packet pool and registers them with the ring.
+*			fixedSend is cleared when the reply buffers could not be registered.
+*	@param 	ring is the ring the buffers are for.
+*			packets is the pool to set up, freed by the caller after the ring.
+*			datagramSize is the largest datagram received.
+*			sendSize is the largest reply sent from a registered buffer.
+*			controlSize is the room for control messages in a receive buffer, 0 for none.
+*	@return returns 0 on success, -1 if the buffer ring could not be registered.
+*/
+int init_Buffers(struct uring_loop *ring, struct packet_pool *packets, int datagramSize, int sendSize, int controlSize);
+
+/**	@brief 	Unmaps the rings and closes the ring, which cancels anything still in flight.
+*	@param 	ring is the ring to free.
+*	@return returns nothing.
+*/
+void free_Uring(struct uring_loop *ring);
+
+/**	@brief 	Submits the queued entries and optionally waits for completions.
+*	@param 	ring is the ring.
+*			wait is the number of completions to wait for.
+*			timeout is the longest wait in milli seconds, -1 waits without a limit.
+*	@return returns the number of entries submitted, -1 with errno set on error or timeout.
+*/
+int enter_Uring(struct uring_loop *ring, int wait, int timeout);
+
+/**	@brief 	Get a cleared submission queue entry, submitting the queue first if it is full.
+*	@param 	ring is the ring.
+*			opcode is the IORING_OP of the entry.
+*			fd is the descriptor the entry works on.
+*			kind is the kind of completion and index its number, both come back in user_data.
+*	@return returns the entry, it is queued once filled in, NULL if the full queue cannot be submitted.
+*/
+struct io_uring_sqe *get_Sqe(struct uring_loop *ring, int opcode, int fd, unsigned kind, unsigned index);
+
+/**	@brief 	Hands the entry returned by the last get_Sqe to the kernel once it is filled in.
+*	@param 	ring is the ring.
+*	@return returns nothing.
+*/
+void queue_Sqe(struct uring_loop *ring);
+
+/**	@brief 	Get the oldest completion that was not handled yet.
+*	@param 	ring is the ring.
+*	@return returns the completion or NULL if there is none, seen_Completion releases it.
+*/
+struct io_uring_cqe *next_Completion(struct uring_loop *ring);
+
+/**	@brief 	Hands the oldest completion back to the kernel.
+*	@param 	ring is the ring.
+*	@return returns nothing.
+*/
+void seen_Completion(struct uring_loop *ring);
+
+/**	@brief 	Arms a multishot recvmsg that receives into the provided buffers until it fails.
+*	@param 	ring is the ring.
+*			fd is the socket.
+*			index is the number of the socket in the worker.
+*	@return returns nothing.
+*/
+void arm_Receive(struct uring_loop *ring, int fd, int index);
+
+/**	@brief 	Arms a multishot poll that completes every time a descriptor becomes readable.
+*	@param 	ring is the ring.
+*			fd is the descriptor.
+*	@return returns nothing.
+*/
+void arm_Poll(struct uring_loop *ring, int fd);
+
+/**	@brief 	Queues the send of a reply already written to a send buffer.
+*	@param 	ring is the ring.
+*			fd is the socket to send on.
+*			slot is the packet buffer sent, its uring_send holds the client address.
+*			length is the number of bytes to send.
+*	@return returns nothing.
+*/
+void queue_Send(struct uring_loop *ring, int fd, uint32_t slot, int length);
+
+/**	@brief 	Gives a receive buffer back to the kernel.
+*	@param 	ring is the ring.
+*			bid is the buffer ID the completion carried.
+*	@return returns nothing.
+*/
+void recycle_Buffer(struct uring_loop *ring, int bid);
+
+/**	@brief 	Answers the datagram of a recvmsg completion and re-arms the receive if it stopped.
+*	@param 	worker is the server loop.
+*			ring is the ring of the loop.
+*			cqe is the completion.
+*			started is the log_Clock time of this round.
+*			realtime is the trace_Realtime time of this round.
+*	@return returns 1 if a datagram was received, 0 if not.
+*/
+int receive_Completed(struct server_worker *worker, struct uring_loop *ring, struct io_uring_cqe *cqe, uint64_t started, uint64_t realtime);
+
+/**	@brief 	Logs a completed send and frees its send buffer.
+*	@param 	worker is the server loop.
+*			ring is the ring of the loop.
+*			cqe is the completion.
+*	@return returns nothing.
+*/
+void send_Completed(struct server_worker *worker, struct uring_loop *ring, struct io_uring_cqe *cqe);
+
+/*
+ **************************************************
+ *		URING FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ *	The test ring is a plain one so io_uring_enter can wait on it with a timeout,
+ *	the server rings ask for single issuer and deferred task running on top.
+ **************************************************
+ */
+int uring_Supported(void){
+  struct uring_loop ring;
+  struct packet_pool packets;
+  struct io_uring_cqe *cqe;
+  struct sockaddr_in6 address;
+  socklen_t length = sizeof(address);
+  int receiver, sender, received = 0, sent = 0, rounds, result = BACKEND_EPOLL;
+  uint32_t slot;
+
+  if(setup_Uring(&ring, 8, 0) == -1)
+    return BACKEND_EPOLL;
+  if(init_Buffers(&ring, &packets, MAX_MESSAGE, MAX_MESSAGE, 0) == -1) {
+    free_Uring(&ring);
+    free_Packets(&packets);
+    return BACKEND_EPOLL;
+  }
+  memset(&address, 0, sizeof(address));
+  address.sin6_family = AF_INET6;
+  address.sin6_addr = in6addr_loopback;
+  receiver = socket(AF_INET6, SOCK_DGRAM, 0);
+  sender = socket(AF_INET6, SOCK_DGRAM, 0);
+  if(receiver >= 0 && sender >= 0 && bind(receiver, (struct sockaddr *) &address, length) == 0
+     && getsockname(receiver, (struct sockaddr *) &address, &length) == 0) {
+    arm_Receive(&ring, receiver, 0);
+    slot = take_Packet(&packets);
+    memcpy(packet_Data(&packets, slot), "probe", 5);
+    ring.sends[slot].cliaddr = address;
+    queue_Send(&ring, sender, slot, 5);
+    for(rounds = 0; rounds < 4 && received >= 0 && sent >= 0 && (received == 0 || sent == 0); rounds++) {
+      if(enter_Uring(&ring, 1, URING_WAIT_MIL_SEC) == -1 && errno != ETIME && errno != EINTR)
+        break;
+      while((cqe = next_Completion(&ring)) != NULL) {
+        if(cqe->user_data >> 32 == URING_RECEIVE)
+          received = (cqe->res >= 0 && (cqe->flags & IORING_CQE_F_BUFFER) && (cqe->flags & IORING_CQE_F_MORE)) ? 1 : -1;
+        else if(cqe->res == -EINVAL && ring.fixedSend) {
+          ring.fixedSend = 0; //the kernel only sends from ordinary buffers
+          queue_Send(&ring, sender, slot, 5);
+        }
+        else
+          sent = cqe->res == 5 ? 1 : -1;
+        seen_Completion(&ring);
+      }
+    }
+    if(received == 1 && sent == 1)
+      result = ring.fixedSend ? BACKEND_URING_FIXED : BACKEND_URING;
+  }
+  free_Uring(&ring);
+  free_Packets(&packets);
+  if(receiver >= 0)
+    close(receiver);
+  if(sender >= 0)
+    close(sender);
+  return result;
+}
+
+
+/*
+ **************************************************
+ *	Replies that need fragments, or that find every send buffer in flight, are sent right
+ *	away with sendReply. Once the loop is stopped the sends still in flight are waited for,
+ *	so the reply to <shutdown/> reaches its client.
+ *	MODIFIED ON 10/17/2026
+ *	While draining the wait is bounded and the loop leaves after a round without requests,
+ *	the multishot receives keep the sockets read until then. The sockets are closed by free_Worker
+ **************************************************
+ */
+int run_Server_Uring(struct server_worker *worker){
+  struct server_config *config = worker->config;
+  struct uring_loop ring;
+  struct event_loop loop;
+  struct io_uring_cqe *cqe;
+  int i, received, sent, free, draining, result = 0;
+  uint64_t started, realtime;
+
+  if(setup_Uring(&ring, URING_ENTRIES, IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN) == -1
+     && setup_Uring(&ring, URING_ENTRIES, 0) == -1) {
+	printErrorMessage("Cannot Set Up io_uring");
+    stop_Server(config);
+    return -1;
+  }
+  if(init_Buffers(&ring, &worker->packets, config->datagramSize, fragment_Payload(config->mtu), control_Size(config)) == -1)
+	result = printErrorMessage("Cannot Register io_uring Buffers");
+  else if(init_Event_Loop(&loop, &config->draining, config->wakefd) == -1)
+    result = -1;
+  else if(add_Server_Events(worker, &loop) == -1) {
+    free_Event_Loop(&loop);
+    result = -1;
+  }
+  if(result == -1) {
+    free_Uring(&ring);
+    stop_Server(config);
+    return -1;
+  }
+  if(config->backend != BACKEND_URING_FIXED)
+    ring.fixedSend = 0;
+  arm_Poll(&ring, loop.epfd);
+  for(i = 0; i < worker->socketCount; i++)
+    arm_Receive(&ring, worker->sockets[i], i);
+
+  while(!server_Stopped(config)) {
+    draining = atomic_load(&config->draining);
+    if(enter_Uring(&ring, 1, draining ? URING_WAIT_MIL_SEC : -1) == -1
+       && errno != EINTR && errno != EBUSY && errno != EAGAIN && errno != ETIME) {
+	  printErrorMessage("Cannot Wait for io_uring Completions");
+      stop_Server(config);
+      result = -1;
+      break;
+    }
+    started = log_Clock();
+    realtime = trace_Realtime(config->timestamps);
+    received = sent = 0;
+    free = worker->packets.freeCount;
+    while((cqe = next_Completion(&ring)) != NULL) {
+      switch(cqe->user_data >> 32) {
+        case URING_RECEIVE:
+          received += receive_Completed(worker, &ring, cqe, started, realtime);
+          break;
+        case URING_SEND:
+          send_Completed(worker, &ring, cqe);
+          sent++;
+          break;
+        case URING_EVENTS:
+          poll_Event_Loop(&loop);
+          if(!(cqe->flags & IORING_CQE_F_MORE))
+            arm_Poll(&ring, loop.epfd);
+          break;
+      }
+      seen_Completion(&ring);
+    }
+    //replies queued this round are the send buffers taken, including those already completed
+    if(received > 0)
+      log_Batch(worker, received, free - (int) worker->packets.freeCount + sent);
+    else if(draining)
+      break;
+  }
+
+  //the sends are UDP, they complete right away unless the socket buffer is full
+  while(worker->packets.freeCount < URING_BUFFERS && (enter_Uring(&ring, 1, URING_WAIT_MIL_SEC) >= 0 || errno == EINTR)) {
+    while((cqe = next_Completion(&ring)) != NULL) {
+      if(cqe->user_data >> 32 == URING_SEND)
+        send_Completed(worker, &ring, cqe);
+      else if(cqe->user_data >> 32 == URING_RECEIVE && (cqe->flags & IORING_CQE_F_BUFFER))
+        recycle_Buffer(&ring, cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+      seen_Completion(&ring);
+    }
+  }
+  free_Uring(&ring);
+  free_Event_Loop(&loop);
+  count_Packets(&config->packets, &worker->packets);
+  return result;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int setup_Uring(struct uring_loop *ring, unsigned entries, unsigned flags){
+  struct io_uring_params params;
+
+  memset(ring, 0, sizeof(struct uring_loop));
+  memset(&params, 0, sizeof(params));
+  params.flags = flags | IORING_SETUP_CQSIZE;
+  params.cq_entries = entries * URING_CQ_FACTOR;
+  ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+  if(ring->fd < 0)
+    return -1;
+
+  ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if(params.features & IORING_FEAT_SINGLE_MMAP) {
+    if(ring->cqRingSize > ring->sqRingSize)
+      ring->sqRingSize = ring->cqRingSize;
+    ring->cqRingSize = 0; //shares the mapping of the submission ring
+  }
+  ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  ring->cqRing = ring->cqRingSize == 0 ? ring->sqRing
+                 : mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+  ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if(ring->sqRing == MAP_FAILED || ring->cqRing == MAP_FAILED || ring->sqes == MAP_FAILED) {
+    close(ring->fd);
+    return -1;
+  }
+
+  ring->sqHead = (unsigned *) ((char *) ring->sqRing + params.sq_off.head);
+  ring->sqTail = (unsigned *) ((char *) ring->sqRing + params.sq_off.tail);
+  ring->sqMask = *(unsigned *) ((char *) ring->sqRing + params.sq_off.ring_mask);
+  ring->sqArray = (unsigned *) ((char *) ring->sqRing + params.sq_off.array);
+  ring->cqHead = (unsigned *) ((char *) ring->cqRing + params.cq_off.head);
+  ring->cqTail = (unsigned *) ((char *) ring->cqRing + params.cq_off.tail);
+  ring->cqMask = *(unsigned *) ((char *) ring->cqRing + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *) ((char *) ring->cqRing + params.cq_off.cqes);
+  return 0;
+}
+
+
+/*
+ **************************************************
+ *	A receive buffer is the io_uring_recvmsg_out header, the client address and the datagram,
+ *	with one more byte so the datagram can be null terminated in place.
+ *	MODIFIED ON 10/17/2026
+ *	The control messages go between the address and the datagram, the kernel keeps room for
+ *	msg_controllen bytes whether or not the datagram was stamped
+ *	MODIFIED ON 10/17/2026
+ *	Receive and reply buffers are the packet buffers of one pool, the receive buffers are taken
+ *	for good and the rest stays on the free list for the replies
+ **************************************************
+ */
+int init_Buffers(struct uring_loop *ring, struct packet_pool *packets, int datagramSize, int sendSize, int controlSize){
+  struct io_uring_buf_reg registration;
+  struct iovec region;
+  int i;
+
+  ring->recvSize = sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_in6) + controlSize + datagramSize + 1;
+  ring->sendSize = sendSize;
+  ring->packets = packets;
+  if(init_Packets(packets, URING_PACKETS, 0, ring->recvSize > sendSize ? ring->recvSize : sendSize) == -1)
+    return -1;
+  ring->bufferRing = mmap(NULL, URING_BUFFERS * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  ring->sends = calloc(URING_PACKETS, sizeof(struct uring_send));
+  if(ring->bufferRing == MAP_FAILED || ring->sends == NULL)
+    return -1;
+
+  memset(&registration, 0, sizeof(registration));
+  registration.ring_addr = (uint64_t) (uintptr_t) ring->bufferRing;
+  registration.ring_entries = URING_BUFFERS;
+  registration.bgid = URING_BUFFER_GROUP;
+  if(syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0)
+    return -1;
+  for(i = 0; i < URING_BUFFERS; i++)
+    recycle_Buffer(ring, take_Packet(packets));
+
+  //registered buffers are pinned once instead of on every send, without them the same memory is sent as is
+  region.iov_base = packets->memory;
+  region.iov_len = packets->mapped;
+  ring->fixedSend = syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, &region, 1) == 0;
+
+  ring->recvHeader.msg_namelen = sizeof(struct sockaddr_in6);
+  ring->recvHeader.msg_controllen = controlSize;
+  return 0;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void free_Uring(struct uring_loop *ring){
+  close(ring->fd);
+  if(ring->cqRingSize != 0 && ring->cqRing != MAP_FAILED)
+    munmap(ring->cqRing, ring->cqRingSize);
+  if(ring->sqRing != MAP_FAILED)
+    munmap(ring->sqRing, ring->sqRingSize);
+  if(ring->sqes != MAP_FAILED)
+    munmap(ring->sqes, ring->sqesSize);
+  if(ring->bufferRing != NULL && ring->bufferRing != MAP_FAILED)
+    munmap(ring->bufferRing, URING_BUFFERS * sizeof(struct io_uring_buf));
+  free(ring->sends);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+int enter_Uring(struct uring_loop *ring, int wait, int timeout){
+  struct io_uring_getevents_arg argument;
+  struct __kernel_timespec limit;
+  unsigned flags = wait > 0 ? IORING_ENTER_GETEVENTS : 0;
+  void *extra = NULL;
+  size_t extraSize = 0;
+  int submitted;
+
+  if(timeout >= 0) {
+    limit.tv_sec = timeout / 1000;
+    limit.tv_nsec = (timeout % 1000) * 1000000L;
+    memset(&argument, 0, sizeof(argument));
+    argument.ts = (uint64_t) (uintptr_t) &limit;
+    flags |= IORING_ENTER_EXT_ARG;
+    extra = &argument;
+    extraSize = sizeof(argument);
+  }
+  submitted = syscall(__NR_io_uring_enter, ring->fd, ring->queued, wait, flags, extra, extraSize);
+  if(submitted > 0)
+    ring->queued -= submitted;
+  return submitted;
+}
+
+
+/*
+ **************************************************
+ *	Without a submission thread the kernel takes every entry during io_uring_enter,
+ *	so the queue is only full when that many entries were queued since the last call.
+ **************************************************
+ */
+struct io_uring_sqe *get_Sqe(struct uring_loop *ring, int opcode, int fd, unsigned kind, unsigned index){
+  struct io_uring_sqe *sqe;
+  unsigned tail = *ring->sqTail;
+
+  while(tail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) > ring->sqMask) {
+    if(enter_Uring(ring, 0, -1) == -1 && errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+	  printErrorMessage("Cannot Submit to io_uring");
+      return NULL;
+    }
+  }
+  sqe = &ring->sqes[tail & ring->sqMask];
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->user_data = (uint64_t) kind << 32 | index;
+  return sqe;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void queue_Sqe(struct uring_loop *ring){
+  unsigned tail = *ring->sqTail;
+  ring->sqArray[tail & ring->sqMask] = tail & ring->sqMask;
+  __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+  ring->queued++;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+struct io_uring_cqe *next_Completion(struct uring_loop *ring){
+  unsigned head = *ring->cqHead;
+  if(head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE))
+    return NULL;
+  return &ring->cqes[head & ring->cqMask];
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void seen_Completion(struct uring_loop *ring){
+  __atomic_store_n(ring->cqHead, *ring->cqHead + 1, __ATOMIC_RELEASE);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void arm_Receive(struct uring_loop *ring, int fd, int index){
+  struct io_uring_sqe *sqe = get_Sqe(ring, IORING_OP_RECVMSG, fd, URING_RECEIVE, index);
+  if(sqe == NULL)
+    return;
+  sqe->addr = (uint64_t) (uintptr_t) &ring->recvHeader;
+  sqe->len = 1;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = URING_BUFFER_GROUP;
+  queue_Sqe(ring);
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void arm_Poll(struct uring_loop *ring, int fd){
+  struct io_uring_sqe *sqe = get_Sqe(ring, IORING_OP_POLL_ADD, fd, URING_EVENTS, 0);
+  if(sqe == NULL)
+    return;
+  sqe->len = IORING_POLL_ADD_MULTI;
+  sqe->poll32_events = POLLIN;
+  queue_Sqe(ring);
+}
+
+
+/*
+ **************************************************
+ *	A registered buffer is named by its index and an address inside it, there is only the one region.
+ **************************************************
+ */
+void queue_Send(struct uring_loop *ring, int fd, uint32_t slot, int length){
+  struct io_uring_sqe *sqe = get_Sqe(ring, IORING_OP_SEND, fd, URING_SEND, slot);
+  if(sqe == NULL) {
+    release_Packets(ring->packets, 1);
+    give_Packet(ring->packets, slot);
+    return;
+  }
+  sqe->addr = (uint64_t) (uintptr_t) packet_Data(ring->packets, slot);
+  sqe->len = length;
+  sqe->addr2 = (uint64_t) (uintptr_t) &ring->sends[slot].cliaddr;
+  sqe->addr_len = sizeof(struct sockaddr_in6);
+  if(ring->fixedSend) {
+    sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+    sqe->buf_index = 0;
+  }
+  queue_Sqe(ring);
+}
+
+
+/*
+ **************************************************
+ *	The tail of the buffer ring shares its memory with the first buffer, so only
+ *	the address, length and ID fields of a buffer are written.
+ **************************************************
+ */
+void recycle_Buffer(struct uring_loop *ring, int bid){
+  unsigned short tail = ring->bufferRing->tail;
+  struct io_uring_buf *buffer = &ring->bufferRing->bufs[tail & (URING_BUFFERS - 1)];
+  buffer->addr = (uint64_t) (uintptr_t) packet_Data(ring->packets, bid);
+  buffer->len = ring->recvSize - 1;
+  buffer->bid = bid;
+  __atomic_store_n(&ring->bufferRing->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+
+/*
+ **************************************************
+ *	The multishot receive ends with -ENOBUFS when a burst used every buffer,
+ *	it is armed again after the buffers of this round went back to the kernel.
+ **************************************************
+ */
+int receive_Completed(struct server_worker *worker, struct uring_loop *ring, struct io_uring_cqe *cqe, uint64_t started, uint64_t realtime){
+  struct server_config *config = worker->config;
+  struct io_uring_recvmsg_out *header;
+  struct message_reply reply;
+  struct sockaddr_in6 cliaddr;
+  struct request_trace trace;
+  struct uring_send *send;
+  char *buffer, *control, *datagram, *message;
+  int index = (uint32_t) cqe->user_data, bid, length, opcode, messageLength, sent;
+  uint32_t slot;
+
+  if(!(cqe->flags & IORING_CQE_F_MORE) && !atomic_load(&config->shutdown))
+    arm_Receive(ring, worker->sockets[index], index);
+  if(cqe->res < 0 || !(cqe->flags & IORING_CQE_F_BUFFER))
+    return 0;
+  bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+  if(atomic_load(&config->shutdown)) {
+    recycle_Buffer(ring, bid);
+    return 0;
+  }
+
+  buffer = packet_Data(ring->packets, bid);
+  header = (struct io_uring_recvmsg_out *) buffer;
+  memcpy(&cliaddr, buffer + sizeof(*header), sizeof(cliaddr));
+  control = buffer + sizeof(*header) + sizeof(cliaddr);
+  datagram = control + ring->recvHeader.msg_controllen;
+  length = (header->flags & MSG_TRUNC) ? config->datagramSize + 1 : (int) header->payloadlen;
+  hold_Packet(ring->packets, sizeof(*header) + sizeof(cliaddr) + header->controllen + (length < config->datagramSize ? length : config->datagramSize));
+
+  worker->sockfd = worker->sockets[index]; //replies leave through the socket the request came in on
+  count_Overflow(worker, index, header->controllen > 0 ? control : NULL, header->controllen);
+  start_Trace(&trace, config->timestamps, header->controllen > 0 ? control : NULL, header->controllen, started, realtime);
+  opcode = prepareReply(worker, &cliaddr, datagram, length, &reply, &message, &messageLength);
+  if(opcode != -1) {
+    end_Handler(&trace);
+    if(reply.length > ring->sendSize || (slot = take_Packet(ring->packets)) == PACKET_NONE) {
+      sent = sendReply(worker, &cliaddr, &reply);
+      count_Request(worker, opcode, messageLength, sent, &trace);
+      log_Request(worker, &cliaddr, opcode, messageLength, sent, &trace);
+    }
+    else {
+      //the reply may point into the receive buffer or the reassembled message, copy it before both are reused
+      send = &ring->sends[slot];
+      send->cliaddr = cliaddr;
+      send->opcode = opcode;
+      send->messageLength = messageLength;
+      send->trace = trace;
+      gather_Reply(&reply, packet_Data(ring->packets, slot));
+      hold_Reply(ring->packets, reply.length);
+      queue_Send(ring, worker->sockfd, slot, reply.length);
+    }
+    free(message);
+  }
+  release_Packets(ring->packets, 1);
+  recycle_Buffer(ring, bid);
+  return 1;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void send_Completed(struct server_worker *worker, struct uring_loop *ring, struct io_uring_cqe *cqe){
+  uint32_t slot = cqe->user_data;
+  struct uring_send *send = &ring->sends[slot];
+  count_Request(worker, send->opcode, send->messageLength, cqe->res < 0 ? -1 : cqe->res, &send->trace);
+  log_Request(worker, &send->cliaddr, send->opcode, send->messageLength, cqe->res < 0 ? -1 : cqe->res, &send->trace);
+  release_Packets(ring->packets, 1);
+  give_Packet(ring->packets, slot);
+}
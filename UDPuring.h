@@ -0,0 +1,118 @@
+/**	@file UDPuring.h
+ * 	@brief Contains the function prototypes for the io_uring server loop of the UDP server
+ *	that are implemented in UDPuring.c
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPURING_H
+#define UDPURING_H
+
+#include "UDPserver.h"
+#include "UDPlog.h"
+#include "UDPevent.h"
+#include "UDPtrace.h"
+#include "UDPbuffer.h"
+#include <stdint.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/*
+ **************************************************
+ *		COMPILER PRE DEFINES
+ **************************************************
+ */
+
+#define URING_ENTRIES 256		//submission queue entries, the completion queue is URING_CQ_FACTOR times larger
+#define URING_CQ_FACTOR 8		//multishot receives post many completions for one submission
+#define URING_BUFFERS 512		//provided receive buffers and registered reply buffers, a power of two
+#define URING_PACKETS (2 * URING_BUFFERS)	//packet buffers of a ring, the receive buffers come first
+#define URING_BUFFER_GROUP 0
+#define URING_RECEIVE 1			//kinds of completion, kept in the high half of user_data
+#define URING_SEND 2
+#define URING_EVENTS 3
+#define URING_WAIT_MIL_SEC 100	//longest wait for the test datagram and for the last sends when stopping
+
+/*
+ **************************************************
+ *		STRUCTURES
+ **************************************************
+ */
+
+/**	@brief 	A reply waiting in a registered buffer for its send to complete.
+*			The fields are what log_Request needs once the kernel reported the bytes sent,
+*			the send stage of a traced request ends with the completion.
+*/
+struct uring_send {
+  struct sockaddr_in6 cliaddr;
+  int opcode;
+  int messageLength;
+  struct request_trace trace;
+};
+
+/**	@brief 	One io_uring instance with its mapped rings, used by one server loop.
+*			Every buffer of the ring is a packet buffer of packets, the pool of the server loop, which is
+*			registered as a whole and named by its handle. Datagrams are received by a multishot recvmsg
+*			per socket into the URING_BUFFERS buffers of bufferRing, their buffer IDs are their handles.
+*			Every buffer starts with the io_uring_recvmsg_out header, the client address and room for the
+*			msg_controllen bytes of the receive timestamp of recvHeader.
+*			Replies are gathered into a buffer taken from the free list of the pool and sent from there,
+*			sends holds what is needed once the send of a buffer completed, by handle.
+*			fixedSend is 0 when the kernel cannot send from a registered buffer, the same memory
+*			is then sent as an ordinary buffer.
+*/
+struct uring_loop {
+  int fd;
+  unsigned *sqHead;
+  unsigned *sqTail;
+  unsigned sqMask;
+  unsigned *sqArray;
+  struct io_uring_sqe *sqes;
+  unsigned *cqHead;
+  unsigned *cqTail;
+  unsigned cqMask;
+  struct io_uring_cqe *cqes;
+  void *sqRing;
+  void *cqRing;
+  size_t sqRingSize;
+  size_t cqRingSize;
+  size_t sqesSize;
+  unsigned queued;
+  struct io_uring_buf_ring *bufferRing;
+  struct packet_pool *packets;
+  int recvSize;
+  struct msghdr recvHeader;
+  int sendSize;
+  struct uring_send *sends;
+  int fixedSend;
+};
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Checks once at startup that the kernel has everything the io_uring loop uses:
+*			multishot recvmsg, provided buffer rings and sends from registered buffers.
+*			A datagram is sent to a loopback socket through a test ring to find out.
+*	@param 	no parameter is passed.
+*	@return returns 1 when the io_uring loop can be used, 0 to fall back to the epoll loop.
+*/
+int uring_Supported(void);
+
+/**	@brief 	io_uring version of run_Server. Each socket has one multishot recvmsg armed, replies are
+*			queued as sends and every round submits them and waits for completions in one io_uring_enter.
+*			The epoll event loop with the wake eventfd, the signals and the timers is watched by a
+*			multishot poll on the ring, so it still runs on this thread.
+*	@param 	worker holds the sockets that the server will listen on, the shared configuration
+*			and the log ring of this loop.
+*	@return returns 0 once the sockets were drained, -1 if the ring could not be set up or waiting failed.
+*/
+int run_Server_Uring(struct server_worker *worker);
+
+#endif
@@ -0,0 +1,135 @@
+/**	@file UDPworkers.c
+ * 	@brief Contains the function implementations of running the UDP server on several threads.
+ *	Every worker opens its own socket on the server port with SO_REUSEPORT so the kernel
+ *	spreads incoming datagrams over the workers, and each worker runs its own copy of run_Server.
+ *	A <shutdown/> received by any worker or a signal drains all of them through start_Drain,
+ *	and once every thread returned the statistics and the log are flushed before the sockets are closed.
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#include "UDPworkers.h"
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Thread entry point, pins the thread if requested and runs the server loop.
+*	@param 	arg is the server_worker structure of this thread.
+*	@return returns the result of run_Server as a pointer.
+*/
+void *worker_Thread(void *arg);
+
+/*
+ **************************************************
+ *		WORKER FUNCTIONS
+ **************************************************
+ */
+
+/*
+ **************************************************
+ **************************************************
+ */
+int create_Worker_Socket(void){
+  int sockfd = create_UDP_Socket(), reuse = 1;
+  if(sockfd != -1 && setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) == -1) {
+	printErrorMessage("Cannot Set SO_REUSEPORT for socket");
+    close(sockfd);
+    return -1;
+  }
+  return sockfd;
+}
+
+
+/*
+ **************************************************
+ *	The event loop reads a socket until EAGAIN, so every socket is non blocking
+ *	MODIFIED ON 10/17/2026
+ *	socketCount only counts the opened sockets, free_Worker closes them when one fails
+ *	The kernel is asked to stamp every datagram when requests are traced with kernel timestamps
+ *	The socket buffers are sized and every socket reports the datagrams it dropped
+ **************************************************
+ */
+int open_Sockets(struct server_worker *worker, int reusePort){
+  struct server_config *config = worker->config;
+  int i, sockfd;
+  for(i = 0; i < config->listenerCount; i++) {
+    if((sockfd = reusePort ? create_Worker_Socket() : create_UDP_Socket()) == -1)
+      return -1;
+    worker->sockets[worker->socketCount++] = sockfd;
+    if(set_Non_Blocking(sockfd) == -1 || enable_Timestamps(sockfd, config->timestamps) == -1 || set_Socket_Buffers(sockfd, config) == -1 ||
+       bind_Socket(sockfd, config->listeners[i]) == -1)
+      return -1;
+    worker->receiveBuffer[i] = receive_Buffer(sockfd);
+  }
+  worker->sockfd = worker->sockets[0];
+  return 0;
+}
+
+
+/*
+ **************************************************
+ *	All sockets are bound before any thread starts so a port that is already
+ *	taken stops the server right away instead of from inside a thread.
+ *	MODIFIED ON 10/17/2026
+ *	The sockets of every worker stay open until all threads drained, so a datagram that the kernel
+ *	steered to a worker that already finished is not dropped while the others are still answering
+ **************************************************
+ */
+int run_Workers(struct server_config *config){
+  int i, started, result = 0, cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  struct server_worker *workers = calloc(config->workers, sizeof(struct server_worker));
+  void *status;
+  if(workers == NULL)
+	return printErrorMessage("Cannot Allocate Workers");
+  
+  for(i = 0; i < config->workers && result == 0; i++) {
+    result = init_Worker(&workers[i], i, config);
+    workers[i].cpu = (config->pinWorkers && cpus > 0) ? i % cpus : -1;
+    if(result == 0)
+      result = open_Sockets(&workers[i], 1);
+  }
+  if(result == 0) {
+    print_Server_info(config);
+    print_Listeners(config);
+    printf("Running %d workers on SO_REUSEPORT sockets\n\n", config->workers);
+    
+    for(started = 0; started < config->workers; started++)
+      if(pthread_create(&workers[started].thread, NULL, worker_Thread, &workers[started]) != 0) {
+        result = printErrorMessage("Cannot Start Worker Thread");
+        stop_Server(config);
+        break;
+      }
+    for(i = 0; i < started; i++) {
+      pthread_join(workers[i].thread, &status);
+      if((intptr_t) status != 0)
+        result = -1;
+    }
+    finish_Server(config);
+  }
+  for(i = 0; i < config->workers; i++)
+    free_Worker(&workers[i]);
+  free(workers);
+  return result;
+}
+
+
+/*
+ **************************************************
+ **************************************************
+ */
+void *worker_Thread(void *arg){
+  struct server_worker *worker = arg;
+  cpu_set_t cpuset;
+  
+  if(worker->cpu >= 0) {
+    CPU_ZERO(&cpuset);
+    CPU_SET(worker->cpu, &cpuset);
+    if(pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0)
+      fprintf(stderr, "ERROR: Cannot Pin Worker %d to CPU %d\n", worker->id, worker->cpu);
+  }
+  return (void *) (intptr_t) run_Server(worker);
+}
@@ -0,0 +1,45 @@
+/**	@file UDPworkers.h
+ * 	@brief Contains the function prototypes for running the UDP server on several worker
+ *	threads that are implemented in UDPworkers.c
+ * 	@author Cole Amick
+ * 	@author Daniel Davis
+ * 	@bug No known bugs!
+ */
+
+#ifndef UDPWORKERS_H
+#define UDPWORKERS_H
+
+#include "UDPserver.h"
+#include "UDPlog.h"
+#include "UDPevent.h"
+#include "UDPtrace.h"
+#include "UDPbuffer.h"
+#include <sched.h>
+
+/*
+ **************************************************
+ *		FUNCTION PROTOTYPES
+ **************************************************
+ */
+
+/**	@brief 	Create a UDP socket with SO_REUSEPORT set so several sockets can be bound to the same port.
+*	@param 	no parameter is passed. 
+*	@return a integer representing the socket number, -1 on error.
+*/
+int create_Worker_Socket(void);
+
+/**	@brief 	Creates a non blocking socket for every listener of the server and binds it.
+*	@param 	worker is the server loop the sockets are opened for.
+*			reusePort is set when several workers share the listeners.
+*	@return returns 0 on success, -1 if a socket cannot be opened or bound, the opened ones are closed by free_Worker.
+*/
+int open_Sockets(struct server_worker *worker, int reusePort);
+
+/**	@brief 	Creates and binds one socket per worker and listener and starts a thread running run_Server on each.
+*			Returns once every worker has drained its sockets and the server was finished.
+*	@param 	config holds the number of workers, the CPU pinning choice and the shared shutdown flag.
+*	@return returns 0 after a clean shutdown, -1 if a worker could not be started or failed.
+*/
+int run_Workers(struct server_config *config);
+
+#endif